@@ -25,14 +25,35 @@
 #ifndef STIPP_HPP
 #define STIPP_HPP
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cmath>
 #include <compare>
+#include <concepts>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
 #include <functional>
+#include <initializer_list>
 #include <iostream>
+#include <iterator>
 #include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <span>
 #include <stdexcept>
+#include <string_view>
+#include <thread>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 #if __has_include(<format>)
 #include <format>
@@ -76,6 +97,50 @@
 #define STIPP_I64_MAX (::stipp::i64{INT64_MAX})
 #define STIPP_ISIZE_MAX (::stipp::isize{PTRDIFF_MAX})
 
+#if defined(_MSC_VER) && !defined(__clang__)
+#define STIPP_ASSUME(expr) __assume(expr)
+#elif defined(__GNUC__)
+#define STIPP_ASSUME(expr)           \
+    do {                             \
+        if (!(expr)) {               \
+            __builtin_unreachable(); \
+        }                            \
+    } while (0)
+#else
+#define STIPP_ASSUME(expr) static_cast<void>(0)
+#endif
+
+#if defined(__GNUC__)
+#define STIPP_VECTOR_EXT 1
+#else
+#define STIPP_VECTOR_EXT 0
+#endif
+
+#if defined(__GNUC__)
+#define STIPP_KERNEL __attribute__((always_inline))
+#else
+#define STIPP_KERNEL
+#endif
+
+#if !defined(STIPP_NO_DISPATCH) && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define STIPP_X86_DISPATCH 1
+#define STIPP_TARGET_SSE4_2 __attribute__((target("sse4.2,popcnt")))
+#define STIPP_TARGET_AVX2 __attribute__((target("avx2,bmi,bmi2,popcnt")))
+#define STIPP_TARGET_AVX512 \
+    __attribute__((target("avx512f,avx512bw,avx512dq,avx512vl,avx512vnni,bmi,bmi2,popcnt")))
+#include <immintrin.h>
+#else
+#define STIPP_X86_DISPATCH 0
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define STIPP_SSE2 1
+#include <emmintrin.h>
+#else
+#define STIPP_SSE2 0
+#endif
+
 namespace stipp {
 
 enum class u8 : std::uint8_t {};
@@ -89,15 +154,64 @@ enum class i32 : std::int32_t {};
 enum class i64 : std::int64_t {};
 enum class isize : std::ptrdiff_t {};
 
+#define STIPP_DEF_PACKED(type, wide, repr_type, size)                                    \
+    class type {                                                                         \
+      public:                                                                            \
+        type() = default;                                                                \
+                                                                                         \
+        constexpr explicit type(repr_type x) noexcept : bytes_{} {                       \
+            const auto bits = static_cast<std::make_unsigned_t<repr_type>>(x);           \
+            for (std::size_t i = 0; i < (size); ++i) {                                   \
+                bytes_[i] = static_cast<std::uint8_t>(bits >> (i * 8));                  \
+            }                                                                            \
+        }                                                                                \
+                                                                                         \
+        constexpr explicit type(wide x) noexcept : type(static_cast<repr_type>(x)) {}    \
+                                                                                         \
+        constexpr explicit operator repr_type() const noexcept {                         \
+            constexpr auto unused = std::numeric_limits<repr_type>::digits +             \
+                                    (std::is_signed_v<repr_type> ? 1 : 0) - (size) * 8;  \
+            std::make_unsigned_t<repr_type> bits{};                                      \
+            for (std::size_t i = 0; i < (size); ++i) {                                   \
+                bits |= static_cast<std::make_unsigned_t<repr_type>>(                    \
+                    static_cast<std::make_unsigned_t<repr_type>>(bytes_[i]) << (i * 8)); \
+            }                                                                            \
+            return static_cast<repr_type>(static_cast<repr_type>(bits << unused) >>      \
+                                          unused);                                       \
+        }                                                                                \
+                                                                                         \
+        constexpr explicit operator wide() const noexcept {                              \
+            return static_cast<wide>(static_cast<repr_type>(*this));                     \
+        }                                                                                \
+                                                                                         \
+      private:                                                                           \
+        std::array<std::uint8_t, (size)> bytes_;                                         \
+    };
+
+STIPP_DEF_PACKED(u24, u32, std::uint32_t, 3)
+STIPP_DEF_PACKED(u40, u64, std::uint64_t, 5)
+STIPP_DEF_PACKED(u48, u64, std::uint64_t, 6)
+STIPP_DEF_PACKED(i24, i32, std::int32_t, 3)
+STIPP_DEF_PACKED(i40, i64, std::int64_t, 5)
+STIPP_DEF_PACKED(i48, i64, std::int64_t, 6)
+
+#undef STIPP_DEF_PACKED
+
 namespace types {
 
 using stipp::i16;
+using stipp::i24;
 using stipp::i32;
+using stipp::i40;
+using stipp::i48;
 using stipp::i64;
 using stipp::i8;
 using stipp::isize;
 using stipp::u16;
+using stipp::u24;
 using stipp::u32;
+using stipp::u40;
+using stipp::u48;
 using stipp::u64;
 using stipp::u8;
 using stipp::usize;
@@ -243,6 +357,24 @@ struct is_shift_width<i64> : std::true_type {};
 template <>
 struct is_shift_width<isize> : std::true_type {};
 
+template <>
+struct is_shift_width<u24> : std::true_type {};
+
+template <>
+struct is_shift_width<u40> : std::true_type {};
+
+template <>
+struct is_shift_width<u48> : std::true_type {};
+
+template <>
+struct is_shift_width<i24> : std::true_type {};
+
+template <>
+struct is_shift_width<i40> : std::true_type {};
+
+template <>
+struct is_shift_width<i48> : std::true_type {};
+
 template <>
 struct is_shift_width<char> : std::true_type {};
 
@@ -317,6 +449,24 @@ struct repr<i64> : repr<std::int64_t> {};
 template <>
 struct repr<isize> : repr<std::ptrdiff_t> {};
 
+template <>
+struct repr<u24> : repr<std::uint32_t> {};
+
+template <>
+struct repr<u40> : repr<std::uint64_t> {};
+
+template <>
+struct repr<u48> : repr<std::uint64_t> {};
+
+template <>
+struct repr<i24> : repr<std::int32_t> {};
+
+template <>
+struct repr<i40> : repr<std::int64_t> {};
+
+template <>
+struct repr<i48> : repr<std::int64_t> {};
+
 template <typename T>
 using repr_t = typename repr<T>::type;
 
@@ -325,6 +475,16 @@ constexpr repr_t<T> to_repr(T x) noexcept {
     return static_cast<repr_t<T>>(x);
 }
 
+template <typename T>
+constexpr std::make_unsigned_t<repr_t<T>> to_bits(T x) noexcept {
+    return static_cast<std::make_unsigned_t<repr_t<T>>>(to_repr(x));
+}
+
+template <typename T>
+constexpr T from_bits(std::make_unsigned_t<repr_t<T>> bits) noexcept {
+    return static_cast<T>(static_cast<repr_t<T>>(bits));
+}
+
 } // namespace detail
 
 template <typename T>
@@ -410,6 +570,12 @@ STIPP_DEF_TRAITS(i16)
 STIPP_DEF_TRAITS(i32)
 STIPP_DEF_TRAITS(i64)
 STIPP_DEF_TRAITS(isize)
+STIPP_DEF_TRAITS(u24)
+STIPP_DEF_TRAITS(u40)
+STIPP_DEF_TRAITS(u48)
+STIPP_DEF_TRAITS(i24)
+STIPP_DEF_TRAITS(i40)
+STIPP_DEF_TRAITS(i48)
 
 template <>
 struct make_signed<u8> {
@@ -461,6 +627,36 @@ struct make_signed<isize> {
     using type = isize;
 };
 
+template <>
+struct make_signed<u24> {
+    using type = i24;
+};
+
+template <>
+struct make_signed<u40> {
+    using type = i40;
+};
+
+template <>
+struct make_signed<u48> {
+    using type = i48;
+};
+
+template <>
+struct make_signed<i24> {
+    using type = i24;
+};
+
+template <>
+struct make_signed<i40> {
+    using type = i40;
+};
+
+template <>
+struct make_signed<i48> {
+    using type = i48;
+};
+
 template <>
 struct make_unsigned<u8> {
     using type = u8;
@@ -511,6 +707,36 @@ struct make_unsigned<isize> {
     using type = usize;
 };
 
+template <>
+struct make_unsigned<u24> {
+    using type = u24;
+};
+
+template <>
+struct make_unsigned<u40> {
+    using type = u40;
+};
+
+template <>
+struct make_unsigned<u48> {
+    using type = u48;
+};
+
+template <>
+struct make_unsigned<i24> {
+    using type = u24;
+};
+
+template <>
+struct make_unsigned<i40> {
+    using type = u40;
+};
+
+template <>
+struct make_unsigned<i48> {
+    using type = u48;
+};
+
 #undef STIPP_DEF_TRAITS
 
 #define STIPP_DEF_OPS(type)                                                    \
@@ -665,6 +891,152 @@ STIPP_DEF_OPS(isize)
 
 #undef STIPP_DEF_OPS
 
+#define STIPP_DEF_PACKED_OPS(type)                                                   \
+    constexpr type operator+(type x) noexcept { return x; }                          \
+                                                                                     \
+    constexpr type operator-(type x) noexcept {                                      \
+        return detail::from_bits<type>(-detail::to_bits(x));                         \
+    }                                                                                \
+                                                                                     \
+    constexpr type operator~(type x) noexcept {                                      \
+        return detail::from_bits<type>(~detail::to_bits(x));                         \
+    }                                                                                \
+                                                                                     \
+    constexpr type& operator++(type& x) noexcept {                                   \
+        x = detail::from_bits<type>(detail::to_bits(x) + 1U);                        \
+        return x;                                                                    \
+    }                                                                                \
+                                                                                     \
+    constexpr type operator++(type& x, int) noexcept {                               \
+        const type ret = x;                                                          \
+        ++x;                                                                         \
+        return ret;                                                                  \
+    }                                                                                \
+                                                                                     \
+    constexpr type operator--(type& x) noexcept {                                    \
+        x = detail::from_bits<type>(detail::to_bits(x) - 1U);                        \
+        return x;                                                                    \
+    }                                                                                \
+                                                                                     \
+    constexpr type operator--(type& x, int) noexcept {                               \
+        const type ret = x;                                                          \
+        --x;                                                                         \
+        return ret;                                                                  \
+    }                                                                                \
+                                                                                     \
+    constexpr type operator+(type lhs, type rhs) noexcept {                          \
+        return detail::from_bits<type>(detail::to_bits(lhs) + detail::to_bits(rhs)); \
+    }                                                                                \
+                                                                                     \
+    constexpr type operator-(type lhs, type rhs) noexcept {                          \
+        return detail::from_bits<type>(detail::to_bits(lhs) - detail::to_bits(rhs)); \
+    }                                                                                \
+                                                                                     \
+    constexpr type operator*(type lhs, type rhs) noexcept {                          \
+        return detail::from_bits<type>(detail::to_bits(lhs) * detail::to_bits(rhs)); \
+    }                                                                                \
+                                                                                     \
+    constexpr type operator/(type lhs, type rhs) noexcept {                          \
+        return static_cast<type>(detail::to_repr(lhs) / detail::to_repr(rhs));       \
+    }                                                                                \
+                                                                                     \
+    constexpr type operator%(type lhs, type rhs) noexcept {                          \
+        return static_cast<type>(detail::to_repr(lhs) % detail::to_repr(rhs));       \
+    }                                                                                \
+                                                                                     \
+    constexpr type operator&(type lhs, type rhs) noexcept {                          \
+        return detail::from_bits<type>(detail::to_bits(lhs) & detail::to_bits(rhs)); \
+    }                                                                                \
+                                                                                     \
+    constexpr type operator|(type lhs, type rhs) noexcept {                          \
+        return detail::from_bits<type>(detail::to_bits(lhs) | detail::to_bits(rhs)); \
+    }                                                                                \
+                                                                                     \
+    constexpr type operator^(type lhs, type rhs) noexcept {                          \
+        return detail::from_bits<type>(detail::to_bits(lhs) ^ detail::to_bits(rhs)); \
+    }                                                                                \
+                                                                                     \
+    template <detail::shift_width T>                                                 \
+    constexpr type operator<<(type lhs, T rhs) noexcept {                            \
+        return detail::from_bits<type>(detail::to_bits(lhs)                          \
+                                       << static_cast<detail::repr_t<T>>(rhs));      \
+    }                                                                                \
+                                                                                     \
+    template <detail::shift_width T>                                                 \
+    constexpr type operator>>(type lhs, T rhs) noexcept {                            \
+        return static_cast<type>(detail::to_repr(lhs) >>                             \
+                                 static_cast<detail::repr_t<T>>(rhs));               \
+    }                                                                                \
+                                                                                     \
+    constexpr type operator+=(type& lhs, type rhs) noexcept {                        \
+        lhs = lhs + rhs;                                                             \
+        return lhs;                                                                  \
+    }                                                                                \
+                                                                                     \
+    constexpr type operator-=(type& lhs, type rhs) noexcept {                        \
+        lhs = lhs - rhs;                                                             \
+        return lhs;                                                                  \
+    }                                                                                \
+                                                                                     \
+    constexpr type operator*=(type& lhs, type rhs) noexcept {                        \
+        lhs = lhs * rhs;                                                             \
+        return lhs;                                                                  \
+    }                                                                                \
+                                                                                     \
+    constexpr type operator/=(type& lhs, type rhs) noexcept {                        \
+        lhs = lhs / rhs;                                                             \
+        return lhs;                                                                  \
+    }                                                                                \
+                                                                                     \
+    constexpr type operator%=(type& lhs, type rhs) noexcept {                        \
+        lhs = lhs % rhs;                                                             \
+        return lhs;                                                                  \
+    }                                                                                \
+                                                                                     \
+    constexpr type operator&=(type& lhs, type rhs) noexcept {                        \
+        lhs = lhs & rhs;                                                             \
+        return lhs;                                                                  \
+    }                                                                                \
+                                                                                     \
+    constexpr type operator|=(type& lhs, type rhs) noexcept {                        \
+        lhs = lhs | rhs;                                                             \
+        return lhs;                                                                  \
+    }                                                                                \
+                                                                                     \
+    constexpr type operator^=(type& lhs, type rhs) noexcept {                        \
+        lhs = lhs ^ rhs;                                                             \
+        return lhs;                                                                  \
+    }                                                                                \
+                                                                                     \
+    template <detail::shift_width T>                                                 \
+    constexpr type& operator<<=(type& lhs, T rhs) noexcept {                         \
+        lhs = lhs << rhs;                                                            \
+        return lhs;                                                                  \
+    }                                                                                \
+                                                                                     \
+    template <detail::shift_width T>                                                 \
+    constexpr type& operator>>=(type& lhs, T rhs) noexcept {                         \
+        lhs = lhs >> rhs;                                                            \
+        return lhs;                                                                  \
+    }                                                                                \
+                                                                                     \
+    constexpr bool operator==(type lhs, type rhs) noexcept {                         \
+        return detail::to_repr(lhs) == detail::to_repr(rhs);                         \
+    }                                                                                \
+                                                                                     \
+    constexpr std::strong_ordering operator<=>(type lhs, type rhs) noexcept {        \
+        return detail::to_repr(lhs) <=> detail::to_repr(rhs);                        \
+    }
+
+STIPP_DEF_PACKED_OPS(u24)
+STIPP_DEF_PACKED_OPS(u40)
+STIPP_DEF_PACKED_OPS(u48)
+STIPP_DEF_PACKED_OPS(i24)
+STIPP_DEF_PACKED_OPS(i40)
+STIPP_DEF_PACKED_OPS(i48)
+
+#undef STIPP_DEF_PACKED_OPS
+
 #define STIPP_DEF_IO(type)                                       \
     inline std::ostream& operator<<(std::ostream& os, type x) {  \
         os << detail::to_repr(x);                                \
@@ -686,6 +1058,12 @@ STIPP_DEF_IO(i16)
 STIPP_DEF_IO(i32)
 STIPP_DEF_IO(i64)
 STIPP_DEF_IO(isize)
+STIPP_DEF_IO(u24)
+STIPP_DEF_IO(u40)
+STIPP_DEF_IO(u48)
+STIPP_DEF_IO(i24)
+STIPP_DEF_IO(i40)
+STIPP_DEF_IO(i48)
 
 #undef STIPP_DEF_IO
 
@@ -790,6 +1168,56 @@ STIPP_DEF_STD(isize)
 
 #undef STIPP_DEF_STD
 
+#define STIPP_DEF_PACKED_STD(type, bits)                                                   \
+    template <>                                                                            \
+    struct std::hash<stipp::type> : std::hash<stipp::detail::repr_t<stipp::type>> {        \
+        std::size_t operator()(stipp::type x) const noexcept {                             \
+            return std::hash<stipp::detail::repr_t<stipp::type>>::operator()(              \
+                static_cast<stipp::detail::repr_t<stipp::type>>(x));                       \
+        }                                                                                  \
+    };                                                                                     \
+                                                                                           \
+    template <>                                                                            \
+    class std::numeric_limits<stipp::type>                                                 \
+        : public std::numeric_limits<stipp::detail::repr_t<stipp::type>> {                 \
+        using repr_limits = std::numeric_limits<stipp::detail::repr_t<stipp::type>>;       \
+        using bits_type = std::make_unsigned_t<stipp::detail::repr_t<stipp::type>>;        \
+                                                                                           \
+      public:                                                                              \
+        static constexpr int digits = (bits) - (repr_limits::is_signed ? 1 : 0);           \
+        static constexpr int digits10 = digits * 643 / 2136;                               \
+                                                                                           \
+        static constexpr stipp::type max /**/ () noexcept {                                \
+            return stipp::detail::from_bits<stipp::type>(                                  \
+                static_cast<bits_type>((bits_type{1} << digits) - 1U));                    \
+        }                                                                                  \
+        static constexpr stipp::type min /**/ () noexcept {                                \
+            return stipp::detail::from_bits<stipp::type>(                                  \
+                repr_limits::is_signed ? static_cast<bits_type>(bits_type{1} << digits)    \
+                                       : bits_type{0});                                    \
+        }                                                                                  \
+        static constexpr stipp::type lowest /**/ () noexcept { return (min)(); }           \
+        static constexpr stipp::type epsilon /**/ () noexcept { return stipp::type{}; }    \
+        static constexpr stipp::type round_error /**/ () noexcept {                        \
+            return stipp::type{};                                                          \
+        }                                                                                  \
+        static constexpr stipp::type infinity /**/ () noexcept { return stipp::type{}; }   \
+        static constexpr stipp::type quiet_NaN /**/ () noexcept { return stipp::type{}; }  \
+        static constexpr stipp::type signaling_NaN /**/ () noexcept {                      \
+            return stipp::type{};                                                          \
+        }                                                                                  \
+        static constexpr stipp::type denorm_min /**/ () noexcept { return stipp::type{}; } \
+    };
+
+STIPP_DEF_PACKED_STD(u24, 24)
+STIPP_DEF_PACKED_STD(u40, 40)
+STIPP_DEF_PACKED_STD(u48, 48)
+STIPP_DEF_PACKED_STD(i24, 24)
+STIPP_DEF_PACKED_STD(i40, 40)
+STIPP_DEF_PACKED_STD(i48, 48)
+
+#undef STIPP_DEF_PACKED_STD
+
 #if __has_include(<format>)
 
 #define STIPP_DEF_FMT(type)                                                    \
@@ -813,9 +1241,7083 @@ STIPP_DEF_FMT(i16)
 STIPP_DEF_FMT(i32)
 STIPP_DEF_FMT(i64)
 STIPP_DEF_FMT(isize)
+STIPP_DEF_FMT(u24)
+STIPP_DEF_FMT(u40)
+STIPP_DEF_FMT(u48)
+STIPP_DEF_FMT(i24)
+STIPP_DEF_FMT(i40)
+STIPP_DEF_FMT(i48)
 
 #undef STIPP_DEF_FMT
 
 #endif
 
+namespace stipp {
+
+enum class cpu_level : std::uint8_t { baseline, sse4_2, avx2, avx512 };
+
+namespace detail {
+
+inline constexpr std::array<std::string_view, 4> cpu_level_names{
+    "baseline", "sse4.2", "avx2", "avx512"};
+
+inline cpu_level detect_cpu_level() noexcept {
+#if STIPP_X86_DISPATCH
+    __builtin_cpu_init();
+    const bool popcnt = __builtin_cpu_supports("popcnt") != 0;
+    const bool sse4_2 = popcnt && __builtin_cpu_supports("sse4.2") != 0;
+    const bool avx2 = sse4_2 && __builtin_cpu_supports("avx2") != 0 &&
+                      __builtin_cpu_supports("bmi") != 0 &&
+                      __builtin_cpu_supports("bmi2") != 0;
+    const bool avx512 = avx2 && __builtin_cpu_supports("avx512f") != 0 &&
+                        __builtin_cpu_supports("avx512bw") != 0 &&
+                        __builtin_cpu_supports("avx512dq") != 0 &&
+                        __builtin_cpu_supports("avx512vl") != 0 &&
+                        __builtin_cpu_supports("avx512vnni") != 0;
+    if (avx512) {
+        return cpu_level::avx512;
+    }
+    if (avx2) {
+        return cpu_level::avx2;
+    }
+    if (sse4_2) {
+        return cpu_level::sse4_2;
+    }
+#endif
+    return cpu_level::baseline;
+}
+
+inline std::optional<cpu_level> parse_cpu_level(std::string_view name) noexcept {
+    for (std::size_t i = 0; i < cpu_level_names.size(); ++i) {
+        if (cpu_level_names[i] == name) {
+            return static_cast<cpu_level>(i);
+        }
+    }
+    return std::nullopt;
+}
+
+constexpr cpu_level min_level(cpu_level lhs, cpu_level rhs) noexcept {
+    return lhs < rhs ? lhs : rhs;
+}
+
+inline cpu_level initial_cpu_level(cpu_level detected) noexcept {
+#if STIPP_X86_DISPATCH
+    // NOLINTNEXTLINE(concurrency-mt-unsafe)
+    if (const char* env = std::getenv("STIPP_CPU_LEVEL")) {
+        if (const auto level = parse_cpu_level(env)) {
+            return min_level(*level, detected);
+        }
+    }
+#endif
+    return detected;
+}
+
+} // namespace detail
+
+inline cpu_level detected_cpu_level() noexcept {
+    static const cpu_level level = detail::detect_cpu_level();
+    return level;
+}
+
+namespace detail {
+
+inline std::atomic<cpu_level>& active_level() noexcept {
+    static std::atomic<cpu_level> level{initial_cpu_level(detected_cpu_level())};
+    return level;
+}
+
+} // namespace detail
+
+inline cpu_level active_cpu_level() noexcept {
+    return detail::active_level().load(std::memory_order_relaxed);
+}
+
+inline cpu_level set_cpu_level(cpu_level level) noexcept {
+    const cpu_level effective = detail::min_level(level, detected_cpu_level());
+    detail::active_level().store(effective, std::memory_order_relaxed);
+    return effective;
+}
+
+namespace detail {
+
+#if STIPP_X86_DISPATCH
+
+template <typename Kernel, typename... Args>
+STIPP_TARGET_SSE4_2 auto run_sse4_2(Kernel kernel, Args... args) noexcept {
+    return kernel(args...);
+}
+
+template <typename Kernel, typename... Args>
+STIPP_TARGET_AVX2 auto run_avx2(Kernel kernel, Args... args) noexcept {
+    if constexpr (requires { kernel.avx2(args...); }) {
+        return kernel.avx2(args...);
+    } else {
+        return kernel(args...);
+    }
+}
+
+template <typename Kernel, typename... Args>
+STIPP_TARGET_AVX512 auto run_avx512(Kernel kernel, Args... args) noexcept {
+    if constexpr (requires { kernel.avx512(args...); }) {
+        return kernel.avx512(args...);
+    } else {
+        return kernel(args...);
+    }
+}
+
+#endif
+
+template <typename Kernel, typename... Args>
+constexpr auto dispatch(Kernel kernel, Args... args) noexcept {
+#if STIPP_X86_DISPATCH
+    if (!std::is_constant_evaluated()) {
+        switch (active_cpu_level()) {
+            case cpu_level::avx512:
+                return run_avx512(kernel, args...);
+            case cpu_level::avx2:
+                return run_avx2(kernel, args...);
+            case cpu_level::sse4_2:
+                return run_sse4_2(kernel, args...);
+            case cpu_level::baseline:
+                break;
+        }
+    }
+#endif
+    return kernel(args...);
+}
+
+} // namespace detail
+
+template <stipp_int T, T Sentinel = (std::numeric_limits<T>::max)()>
+class niche_optional {
+  public:
+    using value_type = T;
+
+    static constexpr T sentinel = Sentinel;
+
+    constexpr niche_optional() noexcept = default;
+
+    constexpr niche_optional(std::nullopt_t /*unused*/) noexcept {}
+
+    constexpr niche_optional(T value) noexcept : value_(value) {}
+
+    constexpr niche_optional& operator=(std::nullopt_t /*unused*/) noexcept {
+        value_ = Sentinel;
+        return *this;
+    }
+
+    constexpr niche_optional& operator=(T value) noexcept {
+        value_ = value;
+        return *this;
+    }
+
+    [[nodiscard]] constexpr bool has_value() const noexcept { return value_ != Sentinel; }
+
+    constexpr explicit operator bool() const noexcept { return has_value(); }
+
+    constexpr T& operator*() noexcept { return value_; }
+
+    constexpr const T& operator*() const noexcept { return value_; }
+
+    constexpr T* operator->() noexcept { return &value_; }
+
+    constexpr const T* operator->() const noexcept { return &value_; }
+
+    constexpr T& value() {
+        if (!has_value()) {
+            throw std::bad_optional_access();
+        }
+        return value_;
+    }
+
+    [[nodiscard]] constexpr const T& value() const {
+        if (!has_value()) {
+            throw std::bad_optional_access();
+        }
+        return value_;
+    }
+
+    [[nodiscard]] constexpr T value_or(T default_value) const noexcept {
+        return has_value() ? value_ : default_value;
+    }
+
+    constexpr T& emplace(T value) noexcept {
+        value_ = value;
+        return value_;
+    }
+
+    constexpr void reset() noexcept { value_ = Sentinel; }
+
+    constexpr void swap(niche_optional& other) noexcept {
+        const T tmp = value_;
+        value_ = other.value_;
+        other.value_ = tmp;
+    }
+
+    friend constexpr bool operator==(niche_optional lhs, niche_optional rhs) noexcept {
+        return lhs.value_ == rhs.value_;
+    }
+
+    friend constexpr bool operator==(niche_optional lhs,
+                                     std::nullopt_t /*unused*/) noexcept {
+        return !lhs.has_value();
+    }
+
+    friend constexpr bool operator==(niche_optional lhs, T rhs) noexcept {
+        return lhs.has_value() && lhs.value_ == rhs;
+    }
+
+    friend constexpr std::strong_ordering operator<=>(niche_optional lhs,
+                                                      niche_optional rhs) noexcept {
+        if (lhs.has_value() && rhs.has_value()) {
+            return lhs.value_ <=> rhs.value_;
+        }
+        return lhs.has_value() <=> rhs.has_value();
+    }
+
+    friend constexpr std::strong_ordering operator<=>(
+        niche_optional lhs, std::nullopt_t /*unused*/) noexcept {
+        return lhs.has_value() <=> false;
+    }
+
+    friend constexpr std::strong_ordering operator<=>(niche_optional lhs, T rhs) noexcept {
+        return lhs.has_value() ? lhs.value_ <=> rhs : std::strong_ordering::less;
+    }
+
+  private:
+    T value_ = Sentinel;
+};
+
+template <stipp_int T, T Sentinel>
+constexpr std::size_t count_present(
+    std::span<const niche_optional<T, Sentinel>> values) noexcept {
+    const auto kernel = [](std::span<const niche_optional<T, Sentinel>> in) STIPP_KERNEL {
+        std::size_t count = 0;
+        for (const auto& value : in) {
+            count += static_cast<std::size_t>(value.has_value());
+        }
+        return count;
+    };
+    return detail::dispatch(kernel, values);
+}
+
+template <stipp_int T, T Sentinel>
+constexpr std::size_t compact_present(std::span<const niche_optional<T, Sentinel>> values,
+                                      std::span<T> out) {
+    if (out.size() < values.size()) {
+        throw std::length_error("compact_present output span is smaller than its input");
+    }
+    const auto kernel = [](std::span<const niche_optional<T, Sentinel>> in,
+                           std::span<T> dst) STIPP_KERNEL {
+        std::size_t count = 0;
+        for (const auto& value : in) {
+            dst[count] = *value;
+            count += static_cast<std::size_t>(value.has_value());
+        }
+        return count;
+    };
+    return detail::dispatch(kernel, values, out);
+}
+
+namespace detail {
+
+template <typename T, std::intmax_t Lo, std::intmax_t Hi>
+inline constexpr bool fits_range_v =
+    std::cmp_greater_equal(Lo, to_repr((std::numeric_limits<T>::min)())) &&
+    std::cmp_less_equal(Hi, to_repr((std::numeric_limits<T>::max)()));
+
+template <std::intmax_t Lo, std::intmax_t Hi>
+struct bounded_storage {
+    using type = std::conditional_t<
+        fits_range_v<u8, Lo, Hi>, u8,
+        std::conditional_t<
+            fits_range_v<i8, Lo, Hi>, i8,
+            std::conditional_t<
+                fits_range_v<u16, Lo, Hi>, u16,
+                std::conditional_t<
+                    fits_range_v<i16, Lo, Hi>, i16,
+                    std::conditional_t<
+                        fits_range_v<u32, Lo, Hi>, u32,
+                        std::conditional_t<
+                            fits_range_v<i32, Lo, Hi>, i32,
+                            std::conditional_t<fits_range_v<u64, Lo, Hi>, u64, i64>>>>>>>;
+};
+
+template <std::intmax_t Lo, std::intmax_t Hi>
+using bounded_storage_t = typename bounded_storage<Lo, Hi>::type;
+
+consteval std::intmax_t min_of(std::intmax_t a,
+                               std::intmax_t b,
+                               std::intmax_t c,
+                               std::intmax_t d) {
+    const std::intmax_t ab = a < b ? a : b;
+    const std::intmax_t cd = c < d ? c : d;
+    return ab < cd ? ab : cd;
+}
+
+consteval std::intmax_t max_of(std::intmax_t a,
+                               std::intmax_t b,
+                               std::intmax_t c,
+                               std::intmax_t d) {
+    const std::intmax_t ab = a > b ? a : b;
+    const std::intmax_t cd = c > d ? c : d;
+    return ab > cd ? ab : cd;
+}
+
+} // namespace detail
+
+template <std::intmax_t Lo, std::intmax_t Hi>
+    requires(Lo <= Hi)
+class bounded {
+  public:
+    using storage_type = detail::bounded_storage_t<Lo, Hi>;
+
+    static constexpr std::intmax_t lower = Lo;
+    static constexpr std::intmax_t upper = Hi;
+
+    constexpr bounded() noexcept
+        requires(Lo <= 0 && 0 <= Hi)
+    = default;
+
+    template <stipp_int T>
+    constexpr explicit bounded(T value) : value_(check(detail::to_repr(value))) {}
+
+    template <std::intmax_t OtherLo, std::intmax_t OtherHi>
+        requires(Lo <= OtherLo && OtherHi <= Hi)
+    constexpr bounded(bounded<OtherLo, OtherHi> other) noexcept
+        : value_(static_cast<storage_type>(other.get())) {}
+
+    static constexpr bounded from_unchecked(storage_type value) noexcept {
+        return bounded(value, unchecked_tag{});
+    }
+
+    [[nodiscard]] constexpr storage_type value() const noexcept {
+        STIPP_ASSUME(in_range(detail::to_repr(value_)));
+        return value_;
+    }
+
+    [[nodiscard]] constexpr std::intmax_t get() const noexcept {
+        return static_cast<std::intmax_t>(detail::to_repr(value()));
+    }
+
+    constexpr explicit operator storage_type() const noexcept { return value(); }
+
+  private:
+    struct unchecked_tag {};
+
+    constexpr bounded(storage_type value, unchecked_tag /*unused*/) noexcept
+        : value_(value) {}
+
+    template <typename R>
+    static constexpr bool in_range(R value) noexcept {
+        return std::cmp_greater_equal(value, Lo) && std::cmp_less_equal(value, Hi);
+    }
+
+    template <typename R>
+    static constexpr storage_type check(R value) {
+        if (!in_range(value)) {
+            throw std::out_of_range("value is outside the range of the bounded type");
+        }
+        return static_cast<storage_type>(static_cast<detail::repr_t<storage_type>>(value));
+    }
+
+    storage_type value_{};
+};
+
+template <std::intmax_t LLo, std::intmax_t LHi, std::intmax_t RLo, std::intmax_t RHi>
+constexpr auto operator+(bounded<LLo, LHi> lhs, bounded<RLo, RHi> rhs) noexcept {
+    using result = bounded<LLo + RLo, LHi + RHi>;
+    return result::from_unchecked(
+        static_cast<typename result::storage_type>(lhs.get() + rhs.get()));
+}
+
+template <std::intmax_t LLo, std::intmax_t LHi, std::intmax_t RLo, std::intmax_t RHi>
+constexpr auto operator-(bounded<LLo, LHi> lhs, bounded<RLo, RHi> rhs) noexcept {
+    using result = bounded<LLo - RHi, LHi - RLo>;
+    return result::from_unchecked(
+        static_cast<typename result::storage_type>(lhs.get() - rhs.get()));
+}
+
+template <std::intmax_t LLo, std::intmax_t LHi, std::intmax_t RLo, std::intmax_t RHi>
+constexpr auto operator*(bounded<LLo, LHi> lhs, bounded<RLo, RHi> rhs) noexcept {
+    using result = bounded<detail::min_of(LLo * RLo, LLo * RHi, LHi * RLo, LHi * RHi),
+                           detail::max_of(LLo * RLo, LLo * RHi, LHi * RLo, LHi * RHi)>;
+    return result::from_unchecked(
+        static_cast<typename result::storage_type>(lhs.get() * rhs.get()));
+}
+
+template <std::intmax_t LLo, std::intmax_t LHi, std::intmax_t RLo, std::intmax_t RHi>
+    requires(RLo > 0 || RHi < 0)
+constexpr auto operator/(bounded<LLo, LHi> lhs, bounded<RLo, RHi> rhs) noexcept {
+    using result = bounded<detail::min_of(LLo / RLo, LLo / RHi, LHi / RLo, LHi / RHi),
+                           detail::max_of(LLo / RLo, LLo / RHi, LHi / RLo, LHi / RHi)>;
+    return result::from_unchecked(
+        static_cast<typename result::storage_type>(lhs.get() / rhs.get()));
+}
+
+template <std::intmax_t LLo, std::intmax_t LHi, std::intmax_t RLo, std::intmax_t RHi>
+constexpr bool operator==(bounded<LLo, LHi> lhs, bounded<RLo, RHi> rhs) noexcept {
+    return lhs.get() == rhs.get();
+}
+
+template <std::intmax_t LLo, std::intmax_t LHi, std::intmax_t RLo, std::intmax_t RHi>
+constexpr std::strong_ordering operator<=>(bounded<LLo, LHi> lhs,
+                                           bounded<RLo, RHi> rhs) noexcept {
+    return lhs.get() <=> rhs.get();
+}
+
+namespace detail {
+
+#if defined(__SIZEOF_INT128__)
+__extension__ typedef __int128 int128_t;           // NOLINT(modernize-use-using)
+__extension__ typedef unsigned __int128 uint128_t; // NOLINT(modernize-use-using)
+#endif
+
+template <typename T>
+struct widen {};
+
+template <>
+struct widen<std::uint8_t> {
+    using type = std::uint16_t;
+};
+
+template <>
+struct widen<std::uint16_t> {
+    using type = std::uint32_t;
+};
+
+template <>
+struct widen<std::uint32_t> {
+    using type = std::uint64_t;
+};
+
+template <>
+struct widen<std::int8_t> {
+    using type = std::int16_t;
+};
+
+template <>
+struct widen<std::int16_t> {
+    using type = std::int32_t;
+};
+
+template <>
+struct widen<std::int32_t> {
+    using type = std::int64_t;
+};
+
+#if defined(__SIZEOF_INT128__)
+
+template <>
+struct widen<std::uint64_t> {
+    using type = uint128_t;
+};
+
+template <>
+struct widen<std::int64_t> {
+    using type = int128_t;
+};
+
+#endif
+
+template <typename T>
+using widen_t = typename widen<T>::type;
+
+template <typename T>
+inline constexpr bool is_signed_wide_v = std::is_signed_v<T>;
+
+#if defined(__SIZEOF_INT128__)
+
+template <>
+inline constexpr bool is_signed_wide_v<int128_t> = true;
+
+#endif
+
+// The unsigned type of the same width, in which arithmetic wraps instead of overflowing.
+template <typename T>
+struct unsigned_wide {
+    using type = std::make_unsigned_t<T>;
+};
+
+#if defined(__SIZEOF_INT128__)
+
+template <>
+struct unsigned_wide<int128_t> {
+    using type = uint128_t;
+};
+
+template <>
+struct unsigned_wide<uint128_t> {
+    using type = uint128_t;
+};
+
+#endif
+
+template <typename T>
+using unsigned_wide_t = typename unsigned_wide<T>::type;
+
+template <typename T>
+concept widenable = requires { typename widen_t<repr_t<T>>; };
+
+template <typename T, typename W>
+constexpr T narrow_wrap(W value) noexcept {
+    return static_cast<T>(static_cast<repr_t<T>>(value));
+}
+
+template <typename T, typename W>
+constexpr T narrow_sat(W value) noexcept {
+    constexpr auto lo = static_cast<W>(to_repr((std::numeric_limits<T>::min)()));
+    constexpr auto hi = static_cast<W>(to_repr((std::numeric_limits<T>::max)()));
+    return narrow_wrap<T>(value < lo ? lo : (value > hi ? hi : value));
+}
+
+template <int Shift, typename W>
+constexpr W round_shift(W value) noexcept {
+    if constexpr (Shift == 0) {
+        return value;
+    } else {
+        constexpr W half = static_cast<W>(W{1} << (Shift - 1));
+        if constexpr (is_signed_wide_v<W>) {
+            if (value < 0) {
+                // The magnitude is unsigned so that the most negative value has one.
+                using U = unsigned_wide_t<W>;
+                const auto magnitude = static_cast<U>(U{0} - static_cast<U>(value));
+                const auto rounded = static_cast<U>(magnitude + static_cast<U>(half));
+                return static_cast<W>(U{0} - static_cast<U>(rounded >> Shift));
+            }
+        }
+        return static_cast<W>(static_cast<W>(value + half) >> Shift);
+    }
+}
+
+template <typename W>
+constexpr W round_div(W num, W den) noexcept {
+    W quot = static_cast<W>(num / den);
+    const W rem = static_cast<W>(num % den);
+    if constexpr (is_signed_wide_v<W>) {
+        const W abs_rem = rem < 0 ? static_cast<W>(-rem) : rem;
+        const W abs_den = den < 0 ? static_cast<W>(-den) : den;
+        if (abs_rem >= static_cast<W>(abs_den - abs_rem)) {
+            quot = static_cast<W>((num < 0) != (den < 0) ? quot - 1 : quot + 1);
+        }
+    } else {
+        if (rem >= static_cast<W>(den - rem)) {
+            quot = static_cast<W>(quot + 1);
+        }
+    }
+    return quot;
+}
+
+} // namespace detail
+
+template <stipp_int Repr, int FracBits>
+    requires(detail::widenable<Repr> && FracBits >= 0 &&
+             FracBits < std::numeric_limits<Repr>::digits)
+class fixed {
+    using wide_type = detail::widen_t<detail::repr_t<Repr>>;
+
+  public:
+    using repr_type = Repr;
+
+    static constexpr int frac_bits = FracBits;
+
+    fixed() = default;
+
+    constexpr explicit fixed(Repr integer) noexcept : raw_(integer << FracBits) {}
+
+    template <std::floating_point F>
+    constexpr explicit fixed(F value) noexcept
+        : raw_(static_cast<Repr>(static_cast<detail::repr_t<Repr>>(
+              value < F{0} ? value * scale<F>() - F{0.5} : value * scale<F>() + F{0.5}))) {}
+
+    static constexpr fixed from_raw(Repr raw) noexcept {
+        fixed ret{};
+        ret.raw_ = raw;
+        return ret;
+    }
+
+    [[nodiscard]] constexpr Repr raw() const noexcept { return raw_; }
+
+    template <std::floating_point F>
+    constexpr explicit operator F() const noexcept {
+        return static_cast<F>(detail::to_repr(raw_)) / scale<F>();
+    }
+
+    constexpr explicit operator Repr() const noexcept {
+        return raw_ / static_cast<Repr>(detail::repr_t<Repr>{1} << FracBits);
+    }
+
+    friend constexpr fixed operator+(fixed x) noexcept { return x; }
+
+    friend constexpr fixed operator-(fixed x) noexcept { return from_raw(-x.raw_); }
+
+    friend constexpr fixed operator+(fixed lhs, fixed rhs) noexcept {
+        return from_raw(lhs.raw_ + rhs.raw_);
+    }
+
+    friend constexpr fixed operator-(fixed lhs, fixed rhs) noexcept {
+        return from_raw(lhs.raw_ - rhs.raw_);
+    }
+
+    friend constexpr fixed operator*(fixed lhs, fixed rhs) noexcept {
+        return from_raw(detail::narrow_wrap<Repr>(mul_wide(lhs, rhs)));
+    }
+
+    friend constexpr fixed operator/(fixed lhs, fixed rhs) noexcept {
+        return from_raw(detail::narrow_wrap<Repr>(div_wide(lhs, rhs)));
+    }
+
+    constexpr fixed& operator+=(fixed rhs) noexcept { return *this = *this + rhs; }
+
+    constexpr fixed& operator-=(fixed rhs) noexcept { return *this = *this - rhs; }
+
+    constexpr fixed& operator*=(fixed rhs) noexcept { return *this = *this * rhs; }
+
+    constexpr fixed& operator/=(fixed rhs) noexcept { return *this = *this / rhs; }
+
+    friend constexpr bool operator==(fixed lhs, fixed rhs) noexcept {
+        return lhs.raw_ == rhs.raw_;
+    }
+
+    friend constexpr std::strong_ordering operator<=>(fixed lhs, fixed rhs) noexcept {
+        return lhs.raw_ <=> rhs.raw_;
+    }
+
+    friend constexpr fixed add_sat(fixed lhs, fixed rhs) noexcept {
+        return from_raw(detail::narrow_sat<Repr>(
+            static_cast<wide_type>(wide(lhs.raw_) + wide(rhs.raw_))));
+    }
+
+    friend constexpr fixed sub_sat(fixed lhs, fixed rhs) noexcept {
+        if constexpr (is_unsigned_v<Repr>) {
+            if (lhs.raw_ < rhs.raw_) {
+                return from_raw((std::numeric_limits<Repr>::min)());
+            }
+        }
+        return from_raw(detail::narrow_sat<Repr>(
+            static_cast<wide_type>(wide(lhs.raw_) - wide(rhs.raw_))));
+    }
+
+    friend constexpr fixed mul_sat(fixed lhs, fixed rhs) noexcept {
+        return from_raw(detail::narrow_sat<Repr>(mul_wide(lhs, rhs)));
+    }
+
+    friend constexpr fixed div_sat(fixed lhs, fixed rhs) noexcept {
+        return from_raw(detail::narrow_sat<Repr>(div_wide(lhs, rhs)));
+    }
+
+    friend constexpr fixed dot(std::span<const fixed> lhs, std::span<const fixed> rhs) {
+        if (lhs.size() != rhs.size()) {
+            throw std::invalid_argument("dot requires spans of equal size");
+        }
+        const auto kernel = [](std::span<const fixed> a,
+                               std::span<const fixed> b) STIPP_KERNEL {
+            // Summed as unsigned so that overflow wraps, as the result does when narrowed.
+            using sum_type = detail::unsigned_wide_t<wide_type>;
+            sum_type acc{0};
+            for (std::size_t i = 0; i < a.size(); ++i) {
+                const auto product =
+                    static_cast<wide_type>(wide(a[i].raw_) * wide(b[i].raw_));
+                acc = static_cast<sum_type>(acc + static_cast<sum_type>(product));
+            }
+            return static_cast<wide_type>(acc);
+        };
+        const wide_type acc = detail::dispatch(kernel, lhs, rhs);
+        return from_raw(detail::narrow_wrap<Repr>(detail::round_shift<FracBits>(acc)));
+    }
+
+    friend constexpr void axpy(std::span<fixed> acc, std::span<const fixed> x, fixed k) {
+        if (acc.size() != x.size()) {
+            throw std::invalid_argument("axpy requires spans of equal size");
+        }
+        const auto kernel = [](std::span<fixed> out, std::span<const fixed> in, fixed scale)
+            STIPP_KERNEL {
+                for (std::size_t i = 0; i < out.size(); ++i) {
+                    out[i].raw_ += detail::narrow_wrap<Repr>(mul_wide(in[i], scale));
+                }
+            };
+        detail::dispatch(kernel, acc, x, k);
+    }
+
+  private:
+    template <std::floating_point F>
+    static constexpr F scale() noexcept {
+        return static_cast<F>(wide_type{1} << FracBits);
+    }
+
+    static constexpr wide_type wide(Repr x) noexcept {
+        return static_cast<wide_type>(detail::to_repr(x));
+    }
+
+    static constexpr wide_type mul_wide(fixed lhs, fixed rhs) noexcept {
+        return detail::round_shift<FracBits>(
+            static_cast<wide_type>(wide(lhs.raw_) * wide(rhs.raw_)));
+    }
+
+    static constexpr wide_type div_wide(fixed lhs, fixed rhs) noexcept {
+        return detail::round_div(
+            static_cast<wide_type>(wide(lhs.raw_) * (wide_type{1} << FracBits)),
+            wide(rhs.raw_));
+    }
+
+    Repr raw_;
+};
+
+namespace detail {
+
+template <typename From, typename To>
+using copy_const_t = std::conditional_t<std::is_const_v<From>, const To, To>;
+
+template <typename T>
+inline constexpr bool repr_layout_compatible_v =
+    sizeof(T) == sizeof(repr_t<T>) && alignof(T) == alignof(repr_t<T>) &&
+    std::is_trivially_copyable_v<T> && std::is_standard_layout_v<T>;
+
+} // namespace detail
+
+template <typename T, std::size_t Extent>
+    requires stipp_int<std::remove_const_t<T>>
+std::span<detail::copy_const_t<T, detail::repr_t<std::remove_const_t<T>>>, Extent>
+as_repr_span(std::span<T, Extent> values) noexcept {
+    using repr_type = detail::copy_const_t<T, detail::repr_t<std::remove_const_t<T>>>;
+    static_assert(detail::repr_layout_compatible_v<std::remove_const_t<T>>,
+                  "stipp type does not have the same layout as its representation type");
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    return std::span<repr_type, Extent>(reinterpret_cast<repr_type*>(values.data()),
+                                        values.size());
+}
+
+template <stipp_int T, typename R, std::size_t Extent>
+    requires std::is_same_v<std::remove_const_t<R>, detail::repr_t<T>>
+std::span<detail::copy_const_t<R, T>, Extent> from_repr_span(
+    std::span<R, Extent> values) noexcept {
+    static_assert(detail::repr_layout_compatible_v<T>,
+                  "stipp type does not have the same layout as its representation type");
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    return std::span<detail::copy_const_t<R, T>, Extent>(
+        reinterpret_cast<detail::copy_const_t<R, T>*>(values.data()), values.size());
+}
+
+template <typename Tag, stipp_int Repr = u32>
+class strong_id {
+  public:
+    using tag_type = Tag;
+    using repr_type = Repr;
+
+    strong_id() = default;
+
+    constexpr explicit strong_id(Repr value) noexcept : value_(value) {}
+
+    [[nodiscard]] constexpr Repr value() const noexcept { return value_; }
+
+    constexpr explicit operator Repr() const noexcept { return value_; }
+
+    constexpr strong_id& operator++() noexcept {
+        ++value_;
+        return *this;
+    }
+
+    constexpr strong_id operator++(int) noexcept {
+        const strong_id ret = *this;
+        ++value_;
+        return ret;
+    }
+
+    constexpr strong_id& operator--() noexcept {
+        --value_;
+        return *this;
+    }
+
+    constexpr strong_id operator--(int) noexcept {
+        const strong_id ret = *this;
+        --value_;
+        return ret;
+    }
+
+    constexpr strong_id& operator+=(Repr offset) noexcept {
+        value_ += offset;
+        return *this;
+    }
+
+    constexpr strong_id& operator-=(Repr offset) noexcept {
+        value_ -= offset;
+        return *this;
+    }
+
+    friend constexpr strong_id operator+(strong_id lhs, Repr rhs) noexcept {
+        return strong_id{lhs.value_ + rhs};
+    }
+
+    friend constexpr strong_id operator-(strong_id lhs, Repr rhs) noexcept {
+        return strong_id{lhs.value_ - rhs};
+    }
+
+    friend constexpr Repr operator-(strong_id lhs, strong_id rhs) noexcept {
+        return lhs.value_ - rhs.value_;
+    }
+
+    friend constexpr bool operator==(strong_id lhs, strong_id rhs) noexcept {
+        return lhs.value_ == rhs.value_;
+    }
+
+    friend constexpr std::strong_ordering operator<=>(strong_id lhs,
+                                                      strong_id rhs) noexcept {
+        return lhs.value_ <=> rhs.value_;
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, strong_id id) {
+        return os << id.value_;
+    }
+
+  private:
+    Repr value_{};
+};
+
+template <typename T>
+struct is_strong_id : std::false_type {};
+
+template <typename Tag, typename Repr>
+struct is_strong_id<strong_id<Tag, Repr>> : std::true_type {};
+
+template <typename T>
+inline constexpr bool is_strong_id_v = is_strong_id<T>::value;
+
+template <typename Id, typename T, typename Allocator = std::allocator<T>>
+    requires is_strong_id_v<Id>
+class index_vector {
+    using repr_type = typename Id::repr_type;
+
+    static constexpr std::size_t to_index(Id id) noexcept {
+        return static_cast<std::size_t>(detail::to_repr(id.value()));
+    }
+
+    static constexpr Id to_id(std::size_t index) noexcept {
+        return Id{static_cast<repr_type>(static_cast<detail::repr_t<repr_type>>(index))};
+    }
+
+    template <typename V>
+    class basic_iterator {
+      public:
+        using value_type = std::pair<Id, V&>;
+        using reference = value_type;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::input_iterator_tag;
+
+        basic_iterator() = default;
+
+        constexpr basic_iterator(Id id, V* ptr) noexcept : id_(id), ptr_(ptr) {}
+
+        constexpr reference operator*() const noexcept { return {id_, *ptr_}; }
+
+        constexpr basic_iterator& operator++() noexcept {
+            ++id_;
+            ++ptr_;
+            return *this;
+        }
+
+        constexpr basic_iterator operator++(int) noexcept {
+            const basic_iterator ret = *this;
+            ++*this;
+            return ret;
+        }
+
+        friend constexpr bool operator==(basic_iterator lhs, basic_iterator rhs) noexcept {
+            return lhs.ptr_ == rhs.ptr_;
+        }
+
+      private:
+        Id id_{};
+        V* ptr_{};
+    };
+
+  public:
+    using id_type = Id;
+    using value_type = T;
+    using allocator_type = Allocator;
+    using reference = T&;
+    using const_reference = const T&;
+    using iterator = basic_iterator<T>;
+    using const_iterator = basic_iterator<const T>;
+
+    index_vector() = default;
+
+    explicit index_vector(const Allocator& alloc) : data_(alloc) {}
+
+    explicit index_vector(std::size_t count,
+                          const T& value = T(),
+                          const Allocator& alloc = {})
+        : data_(checked_size(count), value, alloc) {}
+
+    index_vector(std::initializer_list<T> init, const Allocator& alloc = {})
+        : data_(init, alloc) {
+        checked_size(data_.size());
+    }
+
+    constexpr T& operator[](Id id) noexcept { return data_[to_index(id)]; }
+
+    constexpr const T& operator[](Id id) const noexcept { return data_[to_index(id)]; }
+
+    constexpr T& at(Id id) { return data_.at(to_index(id)); }
+
+    [[nodiscard]] constexpr const T& at(Id id) const { return data_.at(to_index(id)); }
+
+    [[nodiscard]] constexpr bool contains(Id id) const noexcept {
+        return to_index(id) < data_.size();
+    }
+
+    [[nodiscard]] constexpr Id next_id() const noexcept { return to_id(data_.size()); }
+
+    Id push_back(const T& value) {
+        const Id id = reserve_id();
+        data_.push_back(value);
+        return id;
+    }
+
+    Id push_back(T&& value) {
+        const Id id = reserve_id();
+        data_.push_back(std::move(value));
+        return id;
+    }
+
+    template <typename... Args>
+    Id emplace_back(Args&&... args) {
+        const Id id = reserve_id();
+        data_.emplace_back(std::forward<Args>(args)...);
+        return id;
+    }
+
+    void pop_back() { data_.pop_back(); }
+
+    void reserve(std::size_t count) { data_.reserve(checked_size(count)); }
+
+    void resize(std::size_t count) { data_.resize(checked_size(count)); }
+
+    void resize(std::size_t count, const T& value) {
+        data_.resize(checked_size(count), value);
+    }
+
+    void clear() noexcept { data_.clear(); }
+
+    [[nodiscard]] constexpr std::size_t size() const noexcept { return data_.size(); }
+
+    [[nodiscard]] constexpr bool empty() const noexcept { return data_.empty(); }
+
+    constexpr std::span<T> values() noexcept { return data_; }
+
+    [[nodiscard]] constexpr std::span<const T> values() const noexcept { return data_; }
+
+    constexpr T* data() noexcept { return data_.data(); }
+
+    [[nodiscard]] constexpr const T* data() const noexcept { return data_.data(); }
+
+    constexpr iterator begin() noexcept { return iterator{Id{}, data_.data()}; }
+
+    constexpr iterator end() noexcept { return iterator{next_id(), data_.data() + size()}; }
+
+    [[nodiscard]] constexpr const_iterator begin() const noexcept {
+        return const_iterator{Id{}, data_.data()};
+    }
+
+    [[nodiscard]] constexpr const_iterator end() const noexcept {
+        return const_iterator{next_id(), data_.data() + size()};
+    }
+
+    friend bool operator==(const index_vector& lhs, const index_vector& rhs) {
+        return lhs.data_ == rhs.data_;
+    }
+
+  private:
+    static constexpr std::size_t checked_size(std::size_t count) {
+        constexpr auto max_count = static_cast<std::size_t>(
+            detail::to_repr((std::numeric_limits<repr_type>::max)()));
+        if (count > max_count) {
+            throw std::length_error("index_vector size exceeds the range of its id type");
+        }
+        return count;
+    }
+
+    Id reserve_id() {
+        checked_size(data_.size() + 1);
+        return next_id();
+    }
+
+    std::vector<T, Allocator> data_;
+};
+
+// Passing wide vectors by value warns about the ABI when AVX is not enabled. The simd
+// functions are inline, so the ABI is only observable if they are mixed across
+// translation units built with different target flags.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+namespace detail {
+
+template <typename R, std::size_t N>
+struct simd_storage {
+#if STIPP_VECTOR_EXT
+    // NOLINTNEXTLINE(modernize-use-using)
+    typedef R type __attribute__((vector_size(sizeof(R) * N)));
+#else
+    using type = std::array<R, N>;
+#endif
+};
+
+template <typename R, std::size_t N>
+using simd_storage_t = typename simd_storage<R, N>::type;
+
+} // namespace detail
+
+template <stipp_int T, std::size_t N = 16 / sizeof(T)>
+    requires(detail::repr_layout_compatible_v<T> && std::has_single_bit(N))
+class simd;
+
+template <stipp_int T, std::size_t N = 16 / sizeof(T)>
+    requires(detail::repr_layout_compatible_v<T> && std::has_single_bit(N))
+class simd_mask {
+    using lane_type = std::make_signed_t<detail::repr_t<T>>;
+    using native_type = detail::simd_storage_t<lane_type, N>;
+
+  public:
+    simd_mask() = default;
+
+    explicit simd_mask(bool value) noexcept {
+        for (std::size_t i = 0; i < N; ++i) {
+            v_[i] = value ? lane_type{-1} : lane_type{0};
+        }
+    }
+
+    static constexpr std::size_t size() noexcept { return N; }
+
+    bool operator[](std::size_t i) const noexcept { return v_[i] != 0; }
+
+    friend simd_mask operator&(simd_mask lhs, simd_mask rhs) noexcept {
+        return zip(lhs, rhs, [](auto a, auto b) { return a & b; });
+    }
+
+    friend simd_mask operator|(simd_mask lhs, simd_mask rhs) noexcept {
+        return zip(lhs, rhs, [](auto a, auto b) { return a | b; });
+    }
+
+    friend simd_mask operator^(simd_mask lhs, simd_mask rhs) noexcept {
+        return zip(lhs, rhs, [](auto a, auto b) { return a ^ b; });
+    }
+
+    friend simd_mask operator!(simd_mask x) noexcept { return x ^ simd_mask{true}; }
+
+    friend bool operator==(simd_mask lhs, simd_mask rhs) noexcept {
+        return none_of(lhs ^ rhs);
+    }
+
+    friend bool any_of(simd_mask x) noexcept {
+        lane_type acc{0};
+        for (std::size_t i = 0; i < N; ++i) {
+            acc = static_cast<lane_type>(acc | x.v_[i]);
+        }
+        return acc != 0;
+    }
+
+    friend bool all_of(simd_mask x) noexcept {
+        lane_type acc{-1};
+        for (std::size_t i = 0; i < N; ++i) {
+            acc = static_cast<lane_type>(acc & x.v_[i]);
+        }
+        return acc != 0;
+    }
+
+    friend bool none_of(simd_mask x) noexcept { return !any_of(x); }
+
+    friend std::size_t popcount(simd_mask x) noexcept {
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < N; ++i) {
+            count += static_cast<std::size_t>(x.v_[i] != 0);
+        }
+        return count;
+    }
+
+  private:
+    template <stipp_int U, std::size_t M>
+        requires(detail::repr_layout_compatible_v<U> && std::has_single_bit(M))
+    friend class simd;
+
+    template <typename Op>
+    static simd_mask zip(simd_mask lhs, simd_mask rhs, Op op) noexcept {
+        simd_mask ret{};
+#if STIPP_VECTOR_EXT
+        ret.v_ = op(lhs.v_, rhs.v_);
+#else
+        for (std::size_t i = 0; i < N; ++i) {
+            ret.v_[i] = static_cast<lane_type>(op(lhs.v_[i], rhs.v_[i]));
+        }
+#endif
+        return ret;
+    }
+
+    native_type v_;
+};
+
+template <stipp_int T, std::size_t N>
+    requires(detail::repr_layout_compatible_v<T> && std::has_single_bit(N))
+class simd {
+    using repr_type = detail::repr_t<T>;
+    using native_type = detail::simd_storage_t<repr_type, N>;
+
+  public:
+    using value_type = T;
+    using mask_type = simd_mask<T, N>;
+
+    simd() = default;
+
+    explicit simd(T value) noexcept {
+        for (std::size_t i = 0; i < N; ++i) {
+            v_[i] = detail::to_repr(value);
+        }
+    }
+
+    static constexpr std::size_t size() noexcept { return N; }
+
+    static simd load(std::span<const T> src) {
+        if (src.size() < N) {
+            throw std::out_of_range("simd load from a span smaller than the simd width");
+        }
+        simd ret{};
+        std::memcpy(&ret.v_, src.data(), sizeof(native_type));
+        return ret;
+    }
+
+    void store(std::span<T> dst) const {
+        if (dst.size() < N) {
+            throw std::out_of_range("simd store to a span smaller than the simd width");
+        }
+        std::memcpy(dst.data(), &v_, sizeof(native_type));
+    }
+
+    T operator[](std::size_t i) const noexcept { return static_cast<T>(v_[i]); }
+
+    friend simd operator+(simd x) noexcept { return x; }
+
+    friend simd operator-(simd x) noexcept { return simd{} - x; }
+
+    friend simd operator~(simd x) noexcept {
+        return zip(x, x, [](auto a, auto /*unused*/) { return ~a; });
+    }
+
+    friend simd operator+(simd lhs, simd rhs) noexcept {
+        return zip_wrapping(lhs, rhs, [](auto a, auto b) { return a + b; });
+    }
+
+    friend simd operator-(simd lhs, simd rhs) noexcept {
+        return zip_wrapping(lhs, rhs, [](auto a, auto b) { return a - b; });
+    }
+
+    friend simd operator*(simd lhs, simd rhs) noexcept {
+        return zip_wrapping(lhs, rhs, [](auto a, auto b) { return a * b; });
+    }
+
+    friend simd operator&(simd lhs, simd rhs) noexcept {
+        return zip(lhs, rhs, [](auto a, auto b) { return a & b; });
+    }
+
+    friend simd operator|(simd lhs, simd rhs) noexcept {
+        return zip(lhs, rhs, [](auto a, auto b) { return a | b; });
+    }
+
+    friend simd operator^(simd lhs, simd rhs) noexcept {
+        return zip(lhs, rhs, [](auto a, auto b) { return a ^ b; });
+    }
+
+    template <detail::shift_width S>
+    friend simd operator<<(simd lhs, S rhs) noexcept {
+        const auto shift = static_cast<int>(static_cast<detail::repr_t<S>>(rhs));
+        return zip(lhs, lhs, [shift](auto a, auto /*unused*/) { return a << shift; });
+    }
+
+    template <detail::shift_width S>
+    friend simd operator>>(simd lhs, S rhs) noexcept {
+        const auto shift = static_cast<int>(static_cast<detail::repr_t<S>>(rhs));
+        return zip(lhs, lhs, [shift](auto a, auto /*unused*/) { return a >> shift; });
+    }
+
+    simd& operator+=(simd rhs) noexcept { return *this = *this + rhs; }
+
+    simd& operator-=(simd rhs) noexcept { return *this = *this - rhs; }
+
+    simd& operator*=(simd rhs) noexcept { return *this = *this * rhs; }
+
+    simd& operator&=(simd rhs) noexcept { return *this = *this & rhs; }
+
+    simd& operator|=(simd rhs) noexcept { return *this = *this | rhs; }
+
+    simd& operator^=(simd rhs) noexcept { return *this = *this ^ rhs; }
+
+    template <detail::shift_width S>
+    simd& operator<<=(S rhs) noexcept {
+        return *this = *this << rhs;
+    }
+
+    template <detail::shift_width S>
+    simd& operator>>=(S rhs) noexcept {
+        return *this = *this >> rhs;
+    }
+
+    friend mask_type operator==(simd lhs, simd rhs) noexcept {
+        return compare(lhs, rhs, [](auto a, auto b) { return a == b; });
+    }
+
+    friend mask_type operator!=(simd lhs, simd rhs) noexcept {
+        return compare(lhs, rhs, [](auto a, auto b) { return a != b; });
+    }
+
+    friend mask_type operator<(simd lhs, simd rhs) noexcept {
+        return compare(lhs, rhs, [](auto a, auto b) { return a < b; });
+    }
+
+    friend mask_type operator<=(simd lhs, simd rhs) noexcept {
+        return compare(lhs, rhs, [](auto a, auto b) { return a <= b; });
+    }
+
+    friend mask_type operator>(simd lhs, simd rhs) noexcept {
+        return compare(lhs, rhs, [](auto a, auto b) { return a > b; });
+    }
+
+    friend mask_type operator>=(simd lhs, simd rhs) noexcept {
+        return compare(lhs, rhs, [](auto a, auto b) { return a >= b; });
+    }
+
+    friend simd select(mask_type mask, simd if_true, simd if_false) noexcept {
+        return blend(mask, if_true, if_false);
+    }
+
+    friend simd min(simd lhs, simd rhs) noexcept {
+        return zip(lhs, rhs, [](auto a, auto b) { return b < a ? b : a; });
+    }
+
+    friend simd max(simd lhs, simd rhs) noexcept {
+        return zip(lhs, rhs, [](auto a, auto b) { return a < b ? b : a; });
+    }
+
+    friend T reduce_add(simd x) noexcept {
+        return reduce(x, [](auto a, auto b) { return a + b; });
+    }
+
+    friend T reduce_min(simd x) noexcept {
+        return reduce(x, [](auto a, auto b) { return min(a, b); });
+    }
+
+    friend T reduce_max(simd x) noexcept {
+        return reduce(x, [](auto a, auto b) { return max(a, b); });
+    }
+
+    friend T reduce_and(simd x) noexcept {
+        return reduce(x, [](auto a, auto b) { return a & b; });
+    }
+
+    friend T reduce_or(simd x) noexcept {
+        return reduce(x, [](auto a, auto b) { return a | b; });
+    }
+
+    friend T reduce_xor(simd x) noexcept {
+        return reduce(x, [](auto a, auto b) { return a ^ b; });
+    }
+
+  private:
+    template <stipp_int U, std::size_t M>
+        requires(detail::repr_layout_compatible_v<U> && std::has_single_bit(M))
+    friend class simd;
+
+    template <typename Op>
+    static simd zip(simd lhs, simd rhs, Op op) noexcept {
+        simd ret{};
+#if STIPP_VECTOR_EXT
+        ret.v_ = op(lhs.v_, rhs.v_);
+#else
+        for (std::size_t i = 0; i < N; ++i) {
+            ret.v_[i] = static_cast<repr_type>(op(lhs.v_[i], rhs.v_[i]));
+        }
+#endif
+        return ret;
+    }
+
+    // Applies op to the lanes as unsigned integers, which the scalar loop also widens to
+    // at least unsigned int, so that arithmetic wraps like the scalar stipp integers
+    // instead of overflowing.
+    template <typename Op>
+    static simd zip_wrapping(simd lhs, simd rhs, Op op) noexcept {
+        using unsigned_type = std::make_unsigned_t<repr_type>;
+        simd ret{};
+#if STIPP_VECTOR_EXT
+        using unsigned_native = detail::simd_storage_t<unsigned_type, N>;
+        ret.v_ = std::bit_cast<native_type>(op(std::bit_cast<unsigned_native>(lhs.v_),
+                                               std::bit_cast<unsigned_native>(rhs.v_)));
+#else
+        using wide_type = std::common_type_t<unsigned_type, unsigned>;
+        for (std::size_t i = 0; i < N; ++i) {
+            ret.v_[i] = static_cast<repr_type>(op(static_cast<wide_type>(lhs.v_[i]),
+                                                  static_cast<wide_type>(rhs.v_[i])));
+        }
+#endif
+        return ret;
+    }
+
+    static simd blend(mask_type mask, simd if_true, simd if_false) noexcept {
+        simd ret{};
+#if STIPP_VECTOR_EXT
+        const auto bits = std::bit_cast<native_type>(mask.v_);
+        ret.v_ = (if_true.v_ & bits) | (if_false.v_ & ~bits);
+#else
+        for (std::size_t i = 0; i < N; ++i) {
+            ret.v_[i] = mask.v_[i] != 0 ? if_true.v_[i] : if_false.v_[i];
+        }
+#endif
+        return ret;
+    }
+
+    template <typename Op>
+    static mask_type compare(simd lhs, simd rhs, Op op) noexcept {
+        mask_type ret{};
+#if STIPP_VECTOR_EXT
+        ret.v_ = op(lhs.v_, rhs.v_);
+#else
+        for (std::size_t i = 0; i < N; ++i) {
+            ret.v_[i] = op(lhs.v_[i], rhs.v_[i]) ? -1 : 0;
+        }
+#endif
+        return ret;
+    }
+
+    template <typename Op>
+    static T reduce(simd x, Op op) noexcept {
+        if constexpr (N == 1) {
+            return x[0];
+        } else {
+            using half_type = simd<T, N / 2>;
+            half_type lo{};
+            half_type hi{};
+            std::array<unsigned char, sizeof(native_type)> bytes{};
+            std::memcpy(bytes.data(), &x.v_, sizeof(native_type));
+            std::memcpy(&lo.v_, bytes.data(), sizeof(lo.v_));
+            std::memcpy(&hi.v_, bytes.data() + sizeof(lo.v_), sizeof(hi.v_));
+            return half_type::reduce(op(lo, hi), op);
+        }
+    }
+
+    native_type v_;
+};
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+template <stipp_int T>
+using sum_t = std::conditional_t<is_signed_v<T>, i64, u64>;
+
+namespace detail {
+
+inline constexpr std::size_t reduce_block_size = 1024;
+
+template <typename Acc, typename T>
+using sum_acc_t = std::conditional_t<std::is_void_v<Acc>, sum_t<T>, Acc>;
+
+template <typename Acc>
+concept sum_accumulator =
+    std::is_void_v<Acc> || (stipp_int<Acc> && repr_layout_compatible_v<Acc>);
+
+template <typename W>
+struct sum_kernel {
+    template <typename T>
+    STIPP_KERNEL constexpr W operator()(std::span<const T> values) const noexcept {
+        using bits_type = std::make_unsigned_t<W>;
+        bits_type acc{0};
+        for (const T value : values) {
+            const auto bits = static_cast<bits_type>(static_cast<W>(to_repr(value)));
+            acc = static_cast<bits_type>(acc + bits);
+        }
+        return static_cast<W>(acc);
+    }
+};
+
+template <typename A, typename W>
+constexpr bool checked_accumulate(A& acc, W value) noexcept {
+    constexpr auto lo = static_cast<std::uintmax_t>((std::numeric_limits<A>::min)());
+    constexpr auto hi = static_cast<std::uintmax_t>((std::numeric_limits<A>::max)());
+    const auto cur = static_cast<std::uintmax_t>(acc);
+    const auto bits = static_cast<std::uintmax_t>(value);
+    if constexpr (std::is_signed_v<W>) {
+        if (value < 0) {
+            const auto magnitude = static_cast<std::uintmax_t>(0U - bits);
+            if (magnitude > cur - lo) {
+                return false;
+            }
+            acc = static_cast<A>(cur - magnitude);
+            return true;
+        }
+    }
+    if (bits > hi - cur) {
+        return false;
+    }
+    acc = static_cast<A>(cur + bits);
+    return true;
+}
+
+struct fold_best_kernel {
+    template <typename T, typename Better>
+    STIPP_KERNEL constexpr repr_t<T> operator()(std::span<const T> values,
+                                                Better better) const noexcept {
+        auto ret = to_repr(values[0]);
+        for (const T value : values) {
+            const auto repr = to_repr(value);
+            ret = better(repr, ret) ? repr : ret;
+        }
+        return ret;
+    }
+};
+
+struct arg_best_kernel {
+    template <typename T, typename Better>
+    STIPP_KERNEL constexpr std::size_t operator()(std::span<const T> values,
+                                                  Better better) const noexcept {
+        auto best = to_repr(values[0]);
+        std::size_t best_block = 0;
+        for (std::size_t i = 0; i < values.size(); i += reduce_block_size) {
+            const auto block =
+                values.subspan(i, (std::min)(reduce_block_size, values.size() - i));
+            const auto candidate = fold_best_kernel{}(block, better);
+            if (better(candidate, best)) {
+                best = candidate;
+                best_block = i;
+            }
+        }
+        std::size_t ret = best_block;
+        while (to_repr(values[ret]) != best) {
+            ++ret;
+        }
+        return ret;
+    }
+};
+
+struct minmax_kernel {
+    template <typename T>
+    STIPP_KERNEL constexpr std::pair<T, T> operator()(
+        std::span<const T> values) const noexcept {
+        auto lo = to_repr(values[0]);
+        auto hi = lo;
+        for (const T value : values) {
+            const auto repr = to_repr(value);
+            lo = repr < lo ? repr : lo;
+            hi = hi < repr ? repr : hi;
+        }
+        return {static_cast<T>(lo), static_cast<T>(hi)};
+    }
+};
+
+constexpr void check_not_empty(std::size_t size, const char* msg) {
+    if (size == 0) {
+        throw std::invalid_argument(msg);
+    }
+}
+
+inline constexpr auto less_than = [](auto a, auto b) { return a < b; };
+inline constexpr auto greater_than = [](auto a, auto b) { return b < a; };
+
+} // namespace detail
+
+template <detail::sum_accumulator Acc = void, stipp_int T>
+    requires detail::repr_layout_compatible_v<T>
+constexpr detail::sum_acc_t<Acc, T> reduce_sum(std::span<const T> values) noexcept {
+    using acc_type = detail::sum_acc_t<Acc, T>;
+    using acc_repr = detail::repr_t<acc_type>;
+    return static_cast<acc_type>(detail::dispatch(detail::sum_kernel<acc_repr>{}, values));
+}
+
+template <detail::sum_accumulator Acc = void, stipp_int T>
+    requires detail::repr_layout_compatible_v<T>
+constexpr detail::sum_acc_t<Acc, T> reduce_sum_checked(std::span<const T> values) {
+    using acc_type = detail::sum_acc_t<Acc, T>;
+    using block_type = std::conditional_t<is_signed_v<T>, std::int64_t, std::uint64_t>;
+    detail::repr_t<acc_type> acc{0};
+    bool ok = true;
+    if constexpr (sizeof(T) <= sizeof(std::uint32_t)) {
+        for (std::size_t i = 0; ok && i < values.size(); i += detail::reduce_block_size) {
+            const auto block = values.subspan(
+                i, (std::min)(detail::reduce_block_size, values.size() - i));
+            const auto sum = detail::dispatch(detail::sum_kernel<block_type>{}, block);
+            ok = detail::checked_accumulate(acc, sum);
+        }
+    } else {
+        for (std::size_t i = 0; ok && i < values.size(); ++i) {
+            const auto value = static_cast<block_type>(detail::to_repr(values[i]));
+            ok = detail::checked_accumulate(acc, value);
+        }
+    }
+    if (!ok) {
+        throw std::overflow_error(
+            "reduce_sum_checked result does not fit in the accumulator type");
+    }
+    return static_cast<acc_type>(acc);
+}
+
+template <stipp_int T>
+    requires detail::repr_layout_compatible_v<T>
+constexpr T reduce_min(std::span<const T> values) {
+    detail::check_not_empty(values.size(), "reduce_min of an empty span");
+    return static_cast<T>(
+        detail::dispatch(detail::fold_best_kernel{}, values, detail::less_than));
+}
+
+template <stipp_int T>
+    requires detail::repr_layout_compatible_v<T>
+constexpr T reduce_max(std::span<const T> values) {
+    detail::check_not_empty(values.size(), "reduce_max of an empty span");
+    return static_cast<T>(
+        detail::dispatch(detail::fold_best_kernel{}, values, detail::greater_than));
+}
+
+template <stipp_int T>
+    requires detail::repr_layout_compatible_v<T>
+constexpr std::pair<T, T> reduce_minmax(std::span<const T> values) {
+    detail::check_not_empty(values.size(), "reduce_minmax of an empty span");
+    return detail::dispatch(detail::minmax_kernel{}, values);
+}
+
+template <stipp_int T>
+    requires detail::repr_layout_compatible_v<T>
+constexpr std::size_t argmin(std::span<const T> values) {
+    detail::check_not_empty(values.size(), "argmin of an empty span");
+    return detail::dispatch(detail::arg_best_kernel{}, values, detail::less_than);
+}
+
+template <stipp_int T>
+    requires detail::repr_layout_compatible_v<T>
+constexpr std::size_t argmax(std::span<const T> values) {
+    detail::check_not_empty(values.size(), "argmax of an empty span");
+    return detail::dispatch(detail::arg_best_kernel{}, values, detail::greater_than);
+}
+
+namespace detail {
+
+template <typename To, typename From>
+constexpr To convert_wrap(From value) noexcept {
+    return static_cast<To>(static_cast<repr_t<To>>(to_repr(value)));
+}
+
+constexpr void check_output_size(std::size_t in, std::size_t out, const char* msg) {
+    if (out < in) {
+        throw std::length_error(msg);
+    }
+}
+
+struct convert_kernel {
+    template <typename From, typename To>
+    STIPP_KERNEL constexpr void operator()(std::span<const From> src,
+                                           std::span<To> dst) const noexcept {
+        for (std::size_t i = 0; i < src.size(); ++i) {
+            dst[i] = convert_wrap<To>(src[i]);
+        }
+    }
+};
+
+// Converts block by block and finds the first out of range element of the first block that
+// has one. Without `convert_all`, it stops there and leaves the rest of dst unwritten.
+struct narrow_kernel {
+    template <typename From, typename To, typename Op>
+    STIPP_KERNEL constexpr std::optional<std::size_t> operator()(
+        std::span<const From> src,
+        std::span<To> dst,
+        Op op,
+        bool convert_all) const noexcept {
+        std::optional<std::size_t> first;
+        for (std::size_t i = 0; i < src.size(); i += reduce_block_size) {
+            const std::size_t end = i + (std::min)(reduce_block_size, src.size() - i);
+            unsigned out_of_range = 0;
+            for (std::size_t j = i; j < end; ++j) {
+                out_of_range |= static_cast<unsigned>(op(src[j], dst[j]));
+            }
+            if (out_of_range != 0 && !first) {
+                first = i;
+                while (std::in_range<repr_t<To>>(to_repr(src[*first]))) {
+                    ++*first;
+                }
+                if (!convert_all) {
+                    return first;
+                }
+            }
+        }
+        return first;
+    }
+};
+
+} // namespace detail
+
+template <stipp_int From, stipp_int To>
+    requires(detail::repr_layout_compatible_v<From> &&
+             detail::repr_layout_compatible_v<To> && sizeof(From) <= sizeof(To))
+constexpr void convert(std::span<const From> src, std::span<To> dst) {
+    detail::check_output_size(src.size(), dst.size(),
+                              "convert output span is smaller than its input");
+    detail::dispatch(detail::convert_kernel{}, src, dst);
+}
+
+template <stipp_int From, stipp_int To>
+    requires(detail::repr_layout_compatible_v<From> && detail::repr_layout_compatible_v<To>)
+constexpr std::optional<std::size_t> narrow_checked(std::span<const From> src,
+                                                    std::span<To> dst) {
+    detail::check_output_size(src.size(), dst.size(),
+                              "narrow_checked output span is smaller than its input");
+    const auto op = [](From value, To& out) STIPP_KERNEL {
+        out = detail::convert_wrap<To>(value);
+        return !std::in_range<detail::repr_t<To>>(detail::to_repr(value));
+    };
+    return detail::dispatch(detail::narrow_kernel{}, src, dst, op, false);
+}
+
+template <stipp_int From, stipp_int To>
+    requires(detail::repr_layout_compatible_v<From> && detail::repr_layout_compatible_v<To>)
+constexpr std::optional<std::size_t> narrow_saturating(std::span<const From> src,
+                                                       std::span<To> dst) {
+    detail::check_output_size(src.size(), dst.size(),
+                              "narrow_saturating output span is smaller than its input");
+    const auto op = [](From value, To& out) STIPP_KERNEL {
+        constexpr auto lo = detail::to_repr((std::numeric_limits<To>::min)());
+        constexpr auto hi = detail::to_repr((std::numeric_limits<To>::max)());
+        const auto repr = detail::to_repr(value);
+        auto narrowed = static_cast<detail::repr_t<To>>(repr);
+        narrowed = std::cmp_less(repr, lo) ? lo : narrowed;
+        narrowed = std::cmp_greater(repr, hi) ? hi : narrowed;
+        out = static_cast<To>(narrowed);
+        return std::cmp_not_equal(narrowed, repr);
+    };
+    return detail::dispatch(detail::narrow_kernel{}, src, dst, op, true);
+}
+
+namespace detail {
+
+struct dot_u8i8_kernel {
+    STIPP_KERNEL std::int32_t operator()(const std::uint8_t* lhs,
+                                         const std::int8_t* rhs,
+                                         std::size_t size) const noexcept {
+        std::uint32_t acc = 0;
+        for (std::size_t i = 0; i < size; ++i) {
+            const auto product = static_cast<std::int32_t>(lhs[i]) * std::int32_t{rhs[i]};
+            acc += static_cast<std::uint32_t>(product);
+        }
+        return static_cast<std::int32_t>(acc);
+    }
+
+#if STIPP_X86_DISPATCH
+    STIPP_TARGET_AVX2 std::int32_t avx2(const std::uint8_t* lhs,
+                                        const std::int8_t* rhs,
+                                        std::size_t size) const noexcept {
+        // vpmaddubsw saturates its 16-bit pair sums, so widen to 16 bits and use
+        // vpmaddwd, which is exact.
+        __m256i acc0 = _mm256_setzero_si256();
+        __m256i acc1 = _mm256_setzero_si256();
+        std::size_t i = 0;
+        for (; i + 32 <= size; i += 32) {
+            // NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast)
+            const auto* a = reinterpret_cast<const __m128i*>(lhs + i);
+            const auto* b = reinterpret_cast<const __m128i*>(rhs + i);
+            // NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast)
+            const __m256i a0 = _mm256_cvtepu8_epi16(_mm_loadu_si128(a));
+            const __m256i a1 = _mm256_cvtepu8_epi16(_mm_loadu_si128(a + 1));
+            const __m256i b0 = _mm256_cvtepi8_epi16(_mm_loadu_si128(b));
+            const __m256i b1 = _mm256_cvtepi8_epi16(_mm_loadu_si128(b + 1));
+            acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(a0, b0));
+            acc1 = _mm256_add_epi32(acc1, _mm256_madd_epi16(a1, b1));
+        }
+        const __m256i acc = _mm256_add_epi32(acc0, acc1);
+        __m128i sum = _mm256_extracti128_si256(acc, 1);
+        sum = _mm_add_epi32(sum, _mm256_castsi256_si128(acc));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+        const auto head = static_cast<std::uint32_t>(_mm_cvtsi128_si32(sum));
+        const auto tail = (*this)(lhs + i, rhs + i, size - i);
+        return static_cast<std::int32_t>(head + static_cast<std::uint32_t>(tail));
+    }
+
+    STIPP_TARGET_AVX512 std::int32_t avx512(const std::uint8_t* lhs,
+                                            const std::int8_t* rhs,
+                                            std::size_t size) const noexcept {
+        __m512i acc = _mm512_setzero_si512();
+        std::size_t i = 0;
+        for (; i + 64 <= size; i += 64) {
+            const __m512i a = _mm512_loadu_si512(lhs + i);
+            const __m512i b = _mm512_loadu_si512(rhs + i);
+            acc = _mm512_dpbusd_epi32(acc, a, b);
+        }
+        // Reduced through memory, as GCC 12 warns about the 512-bit extract intrinsics.
+        std::array<std::uint32_t, 16> lanes{};
+        _mm512_storeu_si512(lanes.data(), acc);
+        std::uint32_t head = 0;
+        for (const auto lane : lanes) {
+            head += lane;
+        }
+        const auto tail = (*this)(lhs + i, rhs + i, size - i);
+        return static_cast<std::int32_t>(head + static_cast<std::uint32_t>(tail));
+    }
+#endif
+};
+
+struct gemv_u8i8_kernel {
+    STIPP_KERNEL void operator()(const std::int8_t* matrix,
+                                 const std::uint8_t* x,
+                                 std::int32_t* y,
+                                 std::size_t rows,
+                                 std::size_t cols) const noexcept {
+        for (std::size_t row = 0; row < rows; ++row) {
+            y[row] = dot_u8i8_kernel{}(x, matrix + row * cols, cols);
+        }
+    }
+
+#if STIPP_X86_DISPATCH
+    STIPP_TARGET_AVX2 void avx2(const std::int8_t* matrix,
+                                const std::uint8_t* x,
+                                std::int32_t* y,
+                                std::size_t rows,
+                                std::size_t cols) const noexcept {
+        for (std::size_t row = 0; row < rows; ++row) {
+            y[row] = dot_u8i8_kernel{}.avx2(x, matrix + row * cols, cols);
+        }
+    }
+
+    STIPP_TARGET_AVX512 void avx512(const std::int8_t* matrix,
+                                    const std::uint8_t* x,
+                                    std::int32_t* y,
+                                    std::size_t rows,
+                                    std::size_t cols) const noexcept {
+        for (std::size_t row = 0; row < rows; ++row) {
+            y[row] = dot_u8i8_kernel{}.avx512(x, matrix + row * cols, cols);
+        }
+    }
+#endif
+};
+
+} // namespace detail
+
+inline i32 dot(std::span<const u8> lhs, std::span<const i8> rhs) {
+    if (lhs.size() != rhs.size()) {
+        throw std::invalid_argument("dot requires spans of equal size");
+    }
+    const auto* a = as_repr_span(lhs).data();
+    const auto* b = as_repr_span(rhs).data();
+    return i32{detail::dispatch(detail::dot_u8i8_kernel{}, a, b, lhs.size())};
+}
+
+inline void gemv(std::span<const i8> matrix, std::span<const u8> x, std::span<i32> y) {
+    if (matrix.size() != x.size() * y.size()) {
+        throw std::invalid_argument("gemv matrix size must be x.size() * y.size()");
+    }
+    detail::dispatch(detail::gemv_u8i8_kernel{}, as_repr_span(matrix).data(),
+                     as_repr_span(x).data(), as_repr_span(y).data(), y.size(), x.size());
+}
+
+enum class compare_op : std::uint8_t { eq, ne, lt, le, gt, ge };
+
+namespace detail {
+
+template <compare_op Op>
+struct compare_fn {
+    template <typename R>
+    STIPP_KERNEL constexpr bool operator()(R lhs, R rhs) const noexcept {
+        if constexpr (Op == compare_op::eq) {
+            return lhs == rhs;
+        } else if constexpr (Op == compare_op::ne) {
+            return lhs != rhs;
+        } else if constexpr (Op == compare_op::lt) {
+            return lhs < rhs;
+        } else if constexpr (Op == compare_op::le) {
+            return lhs <= rhs;
+        } else if constexpr (Op == compare_op::gt) {
+            return lhs > rhs;
+        } else {
+            return lhs >= rhs;
+        }
+    }
+};
+
+template <typename F>
+constexpr decltype(auto) with_compare_op(compare_op op, F&& fn) {
+    switch (op) {
+        case compare_op::eq:
+            return std::forward<F>(fn)(compare_fn<compare_op::eq>{});
+        case compare_op::ne:
+            return std::forward<F>(fn)(compare_fn<compare_op::ne>{});
+        case compare_op::lt:
+            return std::forward<F>(fn)(compare_fn<compare_op::lt>{});
+        case compare_op::le:
+            return std::forward<F>(fn)(compare_fn<compare_op::le>{});
+        case compare_op::gt:
+            return std::forward<F>(fn)(compare_fn<compare_op::gt>{});
+        case compare_op::ge:
+            break;
+    }
+    return std::forward<F>(fn)(compare_fn<compare_op::ge>{});
+}
+
+// Byte k of entry m is the position of the k-th set bit of m.
+inline constexpr auto select_positions = [] {
+    std::array<std::uint64_t, 256> table{};
+    for (std::size_t mask = 0; mask < table.size(); ++mask) {
+        int k = 0;
+        for (int bit = 0; bit < 8; ++bit) {
+            if (((mask >> bit) & 1U) != 0) {
+                table[mask] |= static_cast<std::uint64_t>(bit) << (8 * k++);
+            }
+        }
+    }
+    return table;
+}();
+
+struct select_indices_kernel {
+    // Every index is written, and the output position only advances past the selected
+    // ones, so the loop has no data-dependent branch.
+    template <typename R, compare_op Op>
+    STIPP_KERNEL static constexpr std::size_t scan(const R* col,
+                                                   std::size_t first,
+                                                   std::size_t last,
+                                                   R value,
+                                                   compare_fn<Op> cmp,
+                                                   std::uint32_t* out) noexcept {
+        std::size_t count = 0;
+        for (std::size_t i = first; i < last; ++i) {
+            out[count] = static_cast<std::uint32_t>(i);
+            count += static_cast<std::size_t>(cmp(col[i], value));
+        }
+        return count;
+    }
+
+    template <typename R, compare_op Op>
+    STIPP_KERNEL constexpr std::size_t operator()(const R* col,
+                                                  std::size_t size,
+                                                  R value,
+                                                  compare_fn<Op> cmp,
+                                                  std::uint32_t* out) const noexcept {
+        return scan(col, 0, size, value, cmp, out);
+    }
+
+#if STIPP_X86_DISPATCH
+    template <compare_op Op>
+    STIPP_TARGET_AVX2 static unsigned mask8(__m256i lhs, __m256i rhs) noexcept {
+        __m256i bits{};
+        if constexpr (Op == compare_op::eq || Op == compare_op::ne) {
+            bits = _mm256_cmpeq_epi32(lhs, rhs);
+        } else if constexpr (Op == compare_op::gt || Op == compare_op::le) {
+            bits = _mm256_cmpgt_epi32(lhs, rhs);
+        } else {
+            bits = _mm256_cmpgt_epi32(rhs, lhs);
+        }
+        const auto mask =
+            static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(bits)));
+        constexpr bool negate =
+            Op == compare_op::ne || Op == compare_op::le || Op == compare_op::ge;
+        return negate ? mask ^ 0xFFU : mask;
+    }
+
+    template <compare_op Op>
+    STIPP_TARGET_AVX2 static unsigned mask4x64(__m256i lhs, __m256i rhs) noexcept {
+        __m256i bits{};
+        if constexpr (Op == compare_op::eq || Op == compare_op::ne) {
+            bits = _mm256_cmpeq_epi64(lhs, rhs);
+        } else if constexpr (Op == compare_op::gt || Op == compare_op::le) {
+            bits = _mm256_cmpgt_epi64(lhs, rhs);
+        } else {
+            bits = _mm256_cmpgt_epi64(rhs, lhs);
+        }
+        const auto mask =
+            static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(bits)));
+        constexpr bool negate =
+            Op == compare_op::ne || Op == compare_op::le || Op == compare_op::ge;
+        return negate ? mask ^ 0xFU : mask;
+    }
+
+    // Narrow elements are widened to 32 bits, and unsigned elements of 32 or 64 bits are
+    // biased into the signed range, as AVX2 only has signed comparisons.
+    template <typename R, compare_op Op>
+    STIPP_TARGET_AVX2 std::size_t avx2(const R* col,
+                                       std::size_t size,
+                                       R value,
+                                       compare_fn<Op> cmp,
+                                       std::uint32_t* out) const noexcept {
+        constexpr bool is_unsigned = std::is_unsigned_v<R>;
+        const __m256i rhs32 = _mm256_set1_epi32(static_cast<std::int32_t>(value));
+        std::size_t count = 0;
+        std::size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            unsigned mask = 0;
+            // NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast)
+            if constexpr (sizeof(R) == 1) {
+                const auto* p = reinterpret_cast<const __m128i*>(col + i);
+                const __m128i raw = _mm_loadl_epi64(p);
+                const __m256i lanes =
+                    is_unsigned ? _mm256_cvtepu8_epi32(raw) : _mm256_cvtepi8_epi32(raw);
+                mask = mask8<Op>(lanes, rhs32);
+            } else if constexpr (sizeof(R) == 2) {
+                const auto* p = reinterpret_cast<const __m128i*>(col + i);
+                const __m128i raw = _mm_loadu_si128(p);
+                const __m256i lanes =
+                    is_unsigned ? _mm256_cvtepu16_epi32(raw) : _mm256_cvtepi16_epi32(raw);
+                mask = mask8<Op>(lanes, rhs32);
+            } else if constexpr (sizeof(R) == 4) {
+                const __m256i bias = _mm256_set1_epi32(is_unsigned ? INT32_MIN : 0);
+                const __m256i lanes = _mm256_xor_si256(
+                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(col + i)), bias);
+                mask = mask8<Op>(lanes, _mm256_xor_si256(rhs32, bias));
+            } else {
+                const __m256i bias = _mm256_set1_epi64x(is_unsigned ? INT64_MIN : 0);
+                const auto* p = reinterpret_cast<const __m256i*>(col + i);
+                const __m256i rhs = _mm256_xor_si256(
+                    _mm256_set1_epi64x(static_cast<std::int64_t>(value)), bias);
+                const __m256i lo = _mm256_xor_si256(_mm256_loadu_si256(p), bias);
+                const __m256i hi = _mm256_xor_si256(_mm256_loadu_si256(p + 1), bias);
+                mask = mask4x64<Op>(lo, rhs) | (mask4x64<Op>(hi, rhs) << 4);
+            }
+            const __m256i positions = _mm256_cvtepu8_epi32(
+                _mm_cvtsi64_si128(static_cast<long long>(select_positions[mask])));
+            const __m256i indices =
+                _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(i)), positions);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + count), indices);
+            // NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast)
+            count += static_cast<std::size_t>(std::popcount(mask));
+        }
+        return count + scan(col, i, size, value, cmp, out + count);
+    }
+
+    template <typename R, compare_op Op>
+    STIPP_TARGET_AVX512 std::size_t avx512(const R* col,
+                                           std::size_t size,
+                                           R value,
+                                           compare_fn<Op> cmp,
+                                           std::uint32_t* out) const noexcept {
+        constexpr int pred = Op == compare_op::eq   ? _MM_CMPINT_EQ
+                             : Op == compare_op::ne ? _MM_CMPINT_NE
+                             : Op == compare_op::lt ? _MM_CMPINT_LT
+                             : Op == compare_op::le ? _MM_CMPINT_LE
+                             : Op == compare_op::gt ? _MM_CMPINT_NLE
+                                                    : _MM_CMPINT_NLT;
+        constexpr bool is_unsigned = std::is_unsigned_v<R>;
+        const __m512i iota =
+            _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+        std::size_t count = 0;
+        std::size_t i = 0;
+        for (; i + 16 <= size; i += 16) {
+            __mmask16 mask = 0;
+            // NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast)
+            if constexpr (sizeof(R) == 1) {
+                const auto* p = reinterpret_cast<const __m128i*>(col + i);
+                const __m128i lanes = _mm_loadu_si128(p);
+                const __m128i rhs = _mm_set1_epi8(static_cast<char>(value));
+                mask = is_unsigned ? _mm_cmp_epu8_mask(lanes, rhs, pred)
+                                   : _mm_cmp_epi8_mask(lanes, rhs, pred);
+            } else if constexpr (sizeof(R) == 2) {
+                const __m256i lanes =
+                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(col + i));
+                const __m256i rhs = _mm256_set1_epi16(static_cast<std::int16_t>(value));
+                mask = is_unsigned ? _mm256_cmp_epu16_mask(lanes, rhs, pred)
+                                   : _mm256_cmp_epi16_mask(lanes, rhs, pred);
+            } else if constexpr (sizeof(R) == 4) {
+                const __m512i lanes = _mm512_loadu_si512(col + i);
+                const __m512i rhs = _mm512_set1_epi32(static_cast<std::int32_t>(value));
+                mask = is_unsigned ? _mm512_cmp_epu32_mask(lanes, rhs, pred)
+                                   : _mm512_cmp_epi32_mask(lanes, rhs, pred);
+            } else {
+                const __m512i lo = _mm512_loadu_si512(col + i);
+                const __m512i hi = _mm512_loadu_si512(col + i + 8);
+                const __m512i rhs = _mm512_set1_epi64(static_cast<std::int64_t>(value));
+                const auto lo_mask = is_unsigned ? _mm512_cmp_epu64_mask(lo, rhs, pred)
+                                                 : _mm512_cmp_epi64_mask(lo, rhs, pred);
+                const auto hi_mask = is_unsigned ? _mm512_cmp_epu64_mask(hi, rhs, pred)
+                                                 : _mm512_cmp_epi64_mask(hi, rhs, pred);
+                mask = static_cast<__mmask16>(lo_mask | (hi_mask << 8));
+            }
+            // vpcompressd into a register and a plain store, as the compressing store is
+            // microcoded on some CPUs.
+            const __m512i indices =
+                _mm512_add_epi32(_mm512_set1_epi32(static_cast<int>(i)), iota);
+            _mm512_storeu_si512(out + count, _mm512_maskz_compress_epi32(mask, indices));
+            // NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast)
+            count += static_cast<std::size_t>(std::popcount(static_cast<unsigned>(mask)));
+        }
+        return count + scan(col, i, size, value, cmp, out + count);
+    }
+#endif
+};
+
+struct gather_kernel {
+    template <typename R>
+    STIPP_KERNEL constexpr void operator()(const R* col,
+                                           std::size_t col_size,
+                                           const std::uint32_t* sel,
+                                           R* out,
+                                           std::size_t size) const noexcept {
+        static_cast<void>(col_size);
+        for (std::size_t i = 0; i < size; ++i) {
+            out[i] = col[sel[i]];
+        }
+    }
+
+#if STIPP_X86_DISPATCH
+    // The gather instructions take signed 32-bit indices, so they are only used when
+    // every valid index is below 2^31.
+    template <typename R>
+    STIPP_TARGET_AVX2 void avx2(const R* col,
+                                std::size_t col_size,
+                                const std::uint32_t* sel,
+                                R* out,
+                                std::size_t size) const noexcept {
+        std::size_t i = 0;
+        if (col_size <= static_cast<std::size_t>(INT32_MAX)) {
+            // NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast)
+            if constexpr (sizeof(R) == 4) {
+                const auto* base = reinterpret_cast<const int*>(col);
+                for (; i + 8 <= size; i += 8) {
+                    const __m256i idx =
+                        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(sel + i));
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                                        _mm256_i32gather_epi32(base, idx, 4));
+                }
+            } else if constexpr (sizeof(R) == 8) {
+                const auto* base = reinterpret_cast<const long long*>(col);
+                for (; i + 4 <= size; i += 4) {
+                    const __m128i idx =
+                        _mm_loadu_si128(reinterpret_cast<const __m128i*>(sel + i));
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                                        _mm256_i32gather_epi64(base, idx, 8));
+                }
+            }
+            // NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast)
+        }
+        (*this)(col, col_size, sel + i, out + i, size - i);
+    }
+
+// Without optimization, GCC 12 defines the gathers as macros that convert the mask to a
+// signed type, which -Wsign-conversion reports whatever type the mask is given.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wsign-conversion"
+#endif
+
+    template <typename R>
+    STIPP_TARGET_AVX512 void avx512(const R* col,
+                                    std::size_t col_size,
+                                    const std::uint32_t* sel,
+                                    R* out,
+                                    std::size_t size) const noexcept {
+        // The masked gathers are used because GCC 12 warns about the unmasked ones.
+        const __m512i zero = _mm512_setzero_si512();
+        std::size_t i = 0;
+        if (col_size <= static_cast<std::size_t>(INT32_MAX)) {
+            if constexpr (sizeof(R) == 4) {
+                for (; i + 16 <= size; i += 16) {
+                    const __m512i idx = _mm512_loadu_si512(sel + i);
+                    _mm512_storeu_si512(
+                        out + i, _mm512_mask_i32gather_epi32(zero, 0xFFFF, idx, col, 4));
+                }
+            } else if constexpr (sizeof(R) == 8) {
+                for (; i + 8 <= size; i += 8) {
+                    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+                    const __m256i idx =
+                        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(sel + i));
+                    _mm512_storeu_si512(
+                        out + i, _mm512_mask_i32gather_epi64(zero, 0xFF, idx, col, 8));
+                }
+            }
+        }
+        (*this)(col, col_size, sel + i, out + i, size - i);
+    }
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#endif
+};
+
+} // namespace detail
+
+template <stipp_int T>
+    requires detail::repr_layout_compatible_v<T>
+std::size_t select_indices(std::span<const T> col,
+                           compare_op cmp,
+                           T value,
+                           std::span<u32> out) {
+    detail::check_output_size(col.size(), out.size(),
+                              "select_indices output span is smaller than its input");
+    if (col.size() > (std::numeric_limits<std::uint32_t>::max)()) {
+        throw std::length_error("select_indices input is too large for u32 indices");
+    }
+    return detail::with_compare_op(cmp, [&](auto fn) {
+        return detail::dispatch(detail::select_indices_kernel{}, as_repr_span(col).data(),
+                                col.size(), detail::to_repr(value), fn,
+                                as_repr_span(out).data());
+    });
+}
+
+template <stipp_int T>
+    requires detail::repr_layout_compatible_v<T>
+void gather(std::span<const T> col, std::span<const u32> sel, std::span<T> out) {
+    detail::check_output_size(sel.size(), out.size(),
+                              "gather output span is smaller than its selection");
+    if (!sel.empty() && detail::to_repr(reduce_max(sel)) >= col.size()) {
+        throw std::out_of_range("gather selection index is out of range");
+    }
+    detail::dispatch(detail::gather_kernel{}, as_repr_span(col).data(), col.size(),
+                     as_repr_span(sel).data(), as_repr_span(out).data(), sel.size());
+}
+
+namespace detail {
+
+inline constexpr std::size_t cache_line_size = 64;
+
+} // namespace detail
+
+class thread_pool {
+  public:
+    // The thread that calls run() takes part in it, so `threads` counts it, and a pool of
+    // one thread starts no workers. 0 means one per hardware thread.
+    explicit thread_pool(std::size_t threads = 0)
+        : size_(threads != 0 ? threads
+                             : (std::max)(std::thread::hardware_concurrency(), 1U)),
+          queues_(std::make_unique<queue[]>(size_)) {
+        try {
+            workers_.reserve(size_ - 1);
+            for (std::size_t self = 1; self < size_; ++self) {
+                workers_.emplace_back([this, self] { worker_loop(self); });
+            }
+        } catch (...) {
+            shutdown();
+            throw;
+        }
+    }
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    ~thread_pool() { shutdown(); }
+
+    std::size_t size() const noexcept { return size_; }
+
+    static thread_pool& global() {
+        static thread_pool pool;
+        return pool;
+    }
+
+    // Calls fn(task) for every task in [0, tasks), and returns once all have run. Each
+    // thread starts on its own contiguous block of tasks, and a thread that runs out
+    // steals the second half of another thread's remaining block. If a task throws, the
+    // tasks that have not started yet are skipped and the first exception is rethrown.
+    // Calling run() from inside a task runs the inner tasks on the calling thread.
+    template <typename F>
+    void run(std::size_t tasks, F&& fn) {
+        if (tasks == 0) {
+            return;
+        }
+        if (size_ == 1 || tasks == 1 || current_pool() == this) {
+            for (std::size_t task = 0; task < tasks; ++task) {
+                fn(task);
+            }
+            return;
+        }
+        auto call = [&fn](std::size_t task) { fn(task); };
+        const std::scoped_lock run_lock(run_mutex_);
+        job_.context = &call;
+        job_.invoke = [](void* context, std::size_t task) {
+            (*static_cast<decltype(call)*>(context))(task);
+        };
+        for (std::size_t self = 0; self < size_; ++self) {
+            const std::scoped_lock lock(queues_[self].mutex);
+            queues_[self].begin = tasks * self / size_;
+            queues_[self].end = tasks * (self + 1) / size_;
+        }
+        {
+            const std::scoped_lock lock(state_mutex_);
+            failed_ = false;
+            busy_ = size_ - 1;
+            ++generation_;
+        }
+        wake_.notify_all();
+
+        const thread_pool* const previous = std::exchange(current_pool(), this);
+        work(0);
+        current_pool() = previous;
+
+        std::unique_lock lock(state_mutex_);
+        done_.wait(lock, [this] { return busy_ == 0; });
+        if (error_) {
+            std::rethrow_exception(std::exchange(error_, nullptr));
+        }
+    }
+
+  private:
+    struct alignas(detail::cache_line_size) queue {
+        std::mutex mutex;
+        std::size_t begin = 0;
+        std::size_t end = 0;
+    };
+
+    struct job {
+        void* context = nullptr;
+        void (*invoke)(void*, std::size_t) = nullptr;
+    };
+
+    static const thread_pool*& current_pool() noexcept {
+        static thread_local const thread_pool* pool = nullptr;
+        return pool;
+    }
+
+    void shutdown() noexcept {
+        {
+            const std::scoped_lock lock(state_mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        workers_.clear();
+    }
+
+    void worker_loop(std::size_t self) {
+        current_pool() = this;
+        std::uint64_t seen = 0;
+        while (true) {
+            {
+                std::unique_lock lock(state_mutex_);
+                wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+                if (stop_) {
+                    return;
+                }
+                seen = generation_;
+            }
+            work(self);
+            const std::scoped_lock lock(state_mutex_);
+            if (--busy_ == 0) {
+                done_.notify_one();
+            }
+        }
+    }
+
+    void work(std::size_t self) noexcept {
+        std::size_t task = 0;
+        while (pop(self, task) || steal(self, task)) {
+            if (failed_.load(std::memory_order_relaxed)) {
+                continue;
+            }
+            try {
+                job_.invoke(job_.context, task);
+            } catch (...) {
+                const std::scoped_lock lock(state_mutex_);
+                if (!failed_.exchange(true)) {
+                    error_ = std::current_exception();
+                }
+            }
+        }
+    }
+
+    bool pop(std::size_t self, std::size_t& task) noexcept {
+        queue& own = queues_[self];
+        const std::scoped_lock lock(own.mutex);
+        if (own.begin == own.end) {
+            return false;
+        }
+        task = own.begin++;
+        return true;
+    }
+
+    bool steal(std::size_t self, std::size_t& task) noexcept {
+        for (std::size_t offset = 1; offset < size_; ++offset) {
+            queue& victim = queues_[(self + offset) % size_];
+            std::size_t first = 0;
+            std::size_t last = 0;
+            {
+                const std::scoped_lock lock(victim.mutex);
+                if (victim.begin == victim.end) {
+                    continue;
+                }
+                last = victim.end;
+                first = victim.end - (victim.end - victim.begin + 1) / 2;
+                victim.end = first;
+            }
+            // Only this thread adds work to its own queue, and it is empty here.
+            queue& own = queues_[self];
+            const std::scoped_lock lock(own.mutex);
+            own.begin = first + 1;
+            own.end = last;
+            task = first;
+            return true;
+        }
+        return false;
+    }
+
+    std::size_t size_;
+    std::unique_ptr<queue[]> queues_;
+    std::vector<std::jthread> workers_;
+    std::mutex run_mutex_;
+    std::mutex state_mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    std::uint64_t generation_ = 0;
+    std::size_t busy_ = 0;
+    bool stop_ = false;
+    std::atomic<bool> failed_ = false;
+    std::exception_ptr error_;
+    job job_;
+};
+
+namespace detail {
+
+inline constexpr std::size_t parallel_chunk_bytes = std::size_t{64} << 10;
+
+// Splits a span into chunks of about parallel_chunk_bytes. When the element size divides
+// the cache line size, the chunk boundaries fall on cache lines, so that no two chunks
+// write to the same line.
+class chunk_plan {
+  public:
+    template <typename T>
+    chunk_plan(const T* data, std::size_t size) noexcept
+        : size_(size),
+          chunk_((std::max)(parallel_chunk_bytes / sizeof(T), std::size_t{1})) {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        const auto address = reinterpret_cast<std::uintptr_t>(data);
+        const std::size_t misalign = address % cache_line_size;
+        if (cache_line_size % sizeof(T) == 0 && misalign % sizeof(T) == 0 &&
+            misalign != 0) {
+            head_ = (std::min)((cache_line_size - misalign) / sizeof(T), size);
+        }
+    }
+
+    std::size_t count() const noexcept {
+        if (size_ == 0) {
+            return 0;
+        }
+        return (std::max)((size_ - head_ + chunk_ - 1) / chunk_, std::size_t{1});
+    }
+
+    std::pair<std::size_t, std::size_t> bounds(std::size_t index) const noexcept {
+        const std::size_t first = index == 0 ? 0 : head_ + index * chunk_;
+        return {first, (std::min)(head_ + (index + 1) * chunk_, size_)};
+    }
+
+  private:
+    std::size_t size_;
+    std::size_t chunk_;
+    std::size_t head_ = 0;
+};
+
+} // namespace detail
+
+template <typename T, typename F>
+void parallel_for(std::span<T> values, F fn, thread_pool& pool = thread_pool::global()) {
+    const detail::chunk_plan plan(values.data(), values.size());
+    pool.run(plan.count(), [&](std::size_t chunk) {
+        const auto [first, last] = plan.bounds(chunk);
+        for (std::size_t i = first; i < last; ++i) {
+            fn(values[i]);
+        }
+    });
+}
+
+// Memory is placed on the NUMA node of the thread that first writes to it. Filling a new
+// buffer with the same pool that later processes it deals the same chunks to the same
+// threads, so each thread mostly works on local memory.
+template <typename T>
+void parallel_fill(std::span<T> values,
+                   const T& value,
+                   thread_pool& pool = thread_pool::global()) {
+    parallel_for(values, [&value](T& element) { element = value; }, pool);
+}
+
+template <typename T, typename U, typename F>
+void parallel_transform(std::span<const T> src,
+                        std::span<U> dst,
+                        F fn,
+                        thread_pool& pool = thread_pool::global()) {
+    if (dst.size() < src.size()) {
+        throw std::length_error("parallel_transform output span is smaller than its input");
+    }
+    const detail::chunk_plan plan(dst.data(), src.size());
+    pool.run(plan.count(), [&](std::size_t chunk) {
+        const auto [first, last] = plan.bounds(chunk);
+        for (std::size_t i = first; i < last; ++i) {
+            dst[i] = fn(src[i]);
+        }
+    });
+}
+
+// Every chunk is folded starting from `identity`, and the chunk results are combined in
+// order, so for a given span the grouping does not depend on the pool.
+template <typename T, typename Acc, typename Fold, typename Combine>
+Acc parallel_reduce(std::span<const T> values,
+                    Acc identity,
+                    Fold fold,
+                    Combine combine,
+                    thread_pool& pool = thread_pool::global()) {
+    const detail::chunk_plan plan(values.data(), values.size());
+    std::vector<Acc> partial(plan.count(), identity);
+    pool.run(plan.count(), [&](std::size_t chunk) {
+        const auto [first, last] = plan.bounds(chunk);
+        Acc acc = identity;
+        for (std::size_t i = first; i < last; ++i) {
+            acc = fold(std::move(acc), values[i]);
+        }
+        partial[chunk] = std::move(acc);
+    });
+    Acc ret = std::move(identity);
+    for (auto& acc : partial) {
+        ret = combine(std::move(ret), std::move(acc));
+    }
+    return ret;
+}
+
+template <typename T, typename Acc, typename Op>
+Acc parallel_reduce(std::span<const T> values,
+                    Acc identity,
+                    Op op,
+                    thread_pool& pool = thread_pool::global()) {
+    return parallel_reduce(values, std::move(identity), op, op, pool);
+}
+
+namespace detail {
+
+// The number of parts to split `size` elements into so that each has at least `min_part`
+// elements. A thread count of 0 means one per thread of the global pool.
+inline std::size_t part_count(std::size_t size,
+                              std::size_t threads,
+                              std::size_t min_part) {
+    if (threads == 0) {
+        threads = thread_pool::global().size();
+    }
+    return std::clamp(size / min_part, std::size_t{1}, (std::max)(threads, std::size_t{1}));
+}
+
+// Calls fn(part, first, last) for `parts` equal parts of [0, size) on the global pool. A
+// single part runs on the calling thread, so the pool is not started for it.
+template <typename F>
+void run_parts(std::size_t size, std::size_t parts, F fn) {
+    if (parts == 1) {
+        fn(0, 0, size);
+        return;
+    }
+    const std::size_t chunk = (size + parts - 1) / parts;
+    thread_pool::global().run(parts, [&](std::size_t part) {
+        const std::size_t first = (std::min)(part * chunk, size);
+        fn(part, first, (std::min)(first + chunk, size));
+    });
+}
+
+inline constexpr std::size_t histogram_block_size = std::size_t{1} << 30;
+inline constexpr std::size_t histogram_min_chunk = std::size_t{1} << 18;
+
+// Runs of equal values would make every increment wait for the previous one to be stored,
+// so consecutive values are counted in separate tables that are added up per block.
+template <typename R, std::size_t Tables>
+struct histogram_kernel {
+    static constexpr std::size_t bins = std::size_t{1} << (8 * sizeof(R));
+    static constexpr std::size_t scratch_size = Tables * bins;
+
+    static void count(std::span<const R> values,
+                      std::span<std::uint32_t, scratch_size> tables,
+                      std::span<std::uint64_t, bins> counts) noexcept {
+        for (std::size_t first = 0; first < values.size(); first += histogram_block_size) {
+            const auto rest = values.subspan(first);
+            const auto block = rest.first((std::min)(histogram_block_size, rest.size()));
+            std::size_t i = 0;
+            for (; i + 2 * Tables <= block.size(); i += 2 * Tables) {
+                for (std::size_t t = 0; t < 2 * Tables; ++t) {
+                    ++tables[(t % Tables) * bins + block[i + t]];
+                }
+            }
+            for (; i < block.size(); ++i) {
+                ++tables[block[i]];
+            }
+            for (std::size_t bin = 0; bin < bins; ++bin) {
+                std::uint64_t sum = 0;
+                for (std::size_t t = 0; t < Tables; ++t) {
+                    sum += std::exchange(tables[t * bins + bin], 0U);
+                }
+                counts[bin] += sum;
+            }
+        }
+    }
+
+    static void run(std::span<const R> values,
+                    std::size_t threads,
+                    std::span<std::uint64_t, bins> counts) {
+        const std::size_t parts = part_count(values.size(), threads, histogram_min_chunk);
+        std::vector<std::uint32_t> scratch(parts * scratch_size);
+        std::vector<std::uint64_t> partial((parts - 1) * bins);
+        const auto count_part = [&](std::size_t t, std::size_t first, std::size_t last) {
+            const std::span<std::uint32_t, scratch_size> tables(
+                scratch.data() + t * scratch_size, scratch_size);
+            const auto out = t == 0 ? counts
+                                    : std::span<std::uint64_t, bins>(
+                                          partial.data() + (t - 1) * bins, bins);
+            count(values.subspan(first, last - first), tables, out);
+        };
+        run_parts(values.size(), parts, count_part);
+        for (std::size_t i = 0; i < partial.size(); ++i) {
+            counts[i % bins] += partial[i];
+        }
+    }
+};
+
+} // namespace detail
+
+inline std::array<u64, 256> histogram(std::span<const u8> values, std::size_t threads = 1) {
+    std::array<u64, 256> ret{};
+    detail::histogram_kernel<std::uint8_t, 8>::run(as_repr_span(values), threads,
+                                                   as_repr_span(std::span(ret)));
+    return ret;
+}
+
+inline std::vector<u64> histogram(std::span<const u16> values, std::size_t threads = 1) {
+    using kernel = detail::histogram_kernel<std::uint16_t, 2>;
+    std::vector<u64> ret(kernel::bins);
+    kernel::run(as_repr_span(values), threads,
+                std::span<std::uint64_t, kernel::bins>(as_repr_span(std::span(ret))));
+    return ret;
+}
+
+namespace detail {
+
+inline constexpr std::size_t scan_min_part = std::size_t{1} << 16;
+
+template <typename D>
+constexpr D wrapping_add(D lhs, D rhs) noexcept {
+    using bits_type = std::make_unsigned_t<D>;
+    return static_cast<D>(
+        static_cast<bits_type>(static_cast<bits_type>(lhs) + static_cast<bits_type>(rhs)));
+}
+
+template <bool Exclusive>
+struct scan_kernel {
+    // Returns the running total after the last element, which is the carry into the next
+    // block.
+    template <typename S, typename D>
+    STIPP_KERNEL constexpr D operator()(const S* src,
+                                        D* dst,
+                                        std::size_t size,
+                                        D carry) const noexcept {
+        for (std::size_t i = 0; i < size; ++i) {
+            const auto value = static_cast<D>(src[i]);
+            if constexpr (Exclusive) {
+                dst[i] = carry;
+            }
+            carry = wrapping_add(carry, value);
+            if constexpr (!Exclusive) {
+                dst[i] = carry;
+            }
+        }
+        return carry;
+    }
+
+#if STIPP_X86_DISPATCH
+    // Loads one vector's worth of elements, widened to the lanes of D.
+    // NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast)
+    template <typename S, typename D>
+    STIPP_TARGET_AVX2 static __m256i load_lanes(const S* src) noexcept {
+        constexpr bool is_signed = std::is_signed_v<S>;
+        if constexpr (sizeof(S) == sizeof(D)) {
+            return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+        } else if constexpr (sizeof(D) == 4 && sizeof(S) == 1) {
+            const __m128i raw = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src));
+            return is_signed ? _mm256_cvtepi8_epi32(raw) : _mm256_cvtepu8_epi32(raw);
+        } else if constexpr (sizeof(D) == 4) {
+            const __m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+            return is_signed ? _mm256_cvtepi16_epi32(raw) : _mm256_cvtepu16_epi32(raw);
+        } else if constexpr (sizeof(S) == 1) {
+            const __m128i raw = _mm_loadu_si32(src);
+            return is_signed ? _mm256_cvtepi8_epi64(raw) : _mm256_cvtepu8_epi64(raw);
+        } else if constexpr (sizeof(S) == 2) {
+            const __m128i raw = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src));
+            return is_signed ? _mm256_cvtepi16_epi64(raw) : _mm256_cvtepu16_epi64(raw);
+        } else {
+            const __m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+            return is_signed ? _mm256_cvtepi32_epi64(raw) : _mm256_cvtepu32_epi64(raw);
+        }
+    }
+    // NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast)
+
+    // Scans each 128-bit half with byte shifts, then adds the total of the low half to
+    // the high half.
+    template <typename D>
+    STIPP_TARGET_AVX2 static __m256i scan_lanes(__m256i x) noexcept {
+        if constexpr (sizeof(D) == 4) {
+            x = _mm256_add_epi32(x, _mm256_slli_si256(x, 4));
+            x = _mm256_add_epi32(x, _mm256_slli_si256(x, 8));
+            const __m256i low = _mm256_shuffle_epi32(x, 0xFF);
+            return _mm256_add_epi32(x, _mm256_permute2x128_si256(low, low, 0x08));
+        } else {
+            x = _mm256_add_epi64(x, _mm256_slli_si256(x, 8));
+            const __m256i low = _mm256_shuffle_epi32(x, 0xEE);
+            return _mm256_add_epi64(x, _mm256_permute2x128_si256(low, low, 0x08));
+        }
+    }
+
+    template <typename S, typename D>
+    STIPP_TARGET_AVX2 D avx2(const S* src,
+                             D* dst,
+                             std::size_t size,
+                             D carry) const noexcept {
+        if constexpr (sizeof(D) < 4) {
+            return (*this)(src, dst, size, carry);
+        } else {
+            constexpr bool wide = sizeof(D) == 8;
+            constexpr std::size_t lanes = 32 / sizeof(D);
+            __m256i acc = wide ? _mm256_set1_epi64x(static_cast<std::int64_t>(carry))
+                               : _mm256_set1_epi32(static_cast<std::int32_t>(carry));
+            std::size_t i = 0;
+            for (; i + lanes <= size; i += lanes) {
+                const __m256i values = load_lanes<S, D>(src + i);
+                const __m256i scanned = scan_lanes<D>(values);
+                const __m256i sums = wide ? _mm256_add_epi64(scanned, acc)
+                                          : _mm256_add_epi32(scanned, acc);
+                __m256i out = sums;
+                if constexpr (Exclusive) {
+                    out = wide ? _mm256_sub_epi64(sums, values)
+                               : _mm256_sub_epi32(sums, values);
+                }
+                // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), out);
+                // Adding the broadcast block total, rather than broadcasting the last
+                // sum, keeps the shuffle out of the loop-carried dependency.
+                const __m256i total =
+                    wide ? _mm256_permute4x64_epi64(scanned, 0xFF)
+                         : _mm256_permutevar8x32_epi32(scanned, _mm256_set1_epi32(7));
+                acc = wide ? _mm256_add_epi64(acc, total) : _mm256_add_epi32(acc, total);
+            }
+            const __m128i last = _mm256_castsi256_si128(acc);
+            if constexpr (wide) {
+                carry = static_cast<D>(_mm_cvtsi128_si64(last));
+            } else {
+                carry = static_cast<D>(_mm_cvtsi128_si32(last));
+            }
+            return (*this)(src + i, dst + i, size - i, carry);
+        }
+    }
+
+    template <typename S, typename D>
+    STIPP_TARGET_AVX512 D avx512(const S* src,
+                                 D* dst,
+                                 std::size_t size,
+                                 D carry) const noexcept {
+        return avx2(src, dst, size, carry);
+    }
+#endif
+};
+
+template <bool Exclusive, typename S, typename D>
+constexpr std::optional<std::size_t> scan_checked_part(const S* src,
+                                                       D* dst,
+                                                       std::size_t first,
+                                                       std::size_t last,
+                                                       D carry) noexcept {
+    for (std::size_t i = first; i < last; ++i) {
+        const S value = src[i];
+        if constexpr (Exclusive) {
+            dst[i] = carry;
+        }
+        if (!checked_accumulate(carry, value)) {
+            return i;
+        }
+        if constexpr (!Exclusive) {
+            dst[i] = carry;
+        }
+    }
+    return std::nullopt;
+}
+
+// The two-pass block scan: the parts are summed in parallel, the part sums are scanned
+// in order, and then every part is scanned from its offset in parallel. Part i only
+// depends on the sums of the parts before it, so the result does not depend on the
+// number of threads.
+template <typename U, typename T, typename ScanPart>
+void scan_parts(std::span<const T> src, std::size_t threads, ScanPart scan_part) {
+    using repr_type = repr_t<U>;
+    const std::size_t parts = part_count(src.size(), threads, scan_min_part);
+    std::vector<repr_type> offsets(parts);
+    if (parts > 1) {
+        run_parts(src.size(), parts, [&](std::size_t part, std::size_t first,
+                                         std::size_t last) {
+            if (part + 1 < parts) {
+                offsets[part + 1] =
+                    dispatch(sum_kernel<repr_type>{}, src.subspan(first, last - first));
+            }
+        });
+        for (std::size_t part = 1; part < parts; ++part) {
+            offsets[part] = wrapping_add(offsets[part - 1], offsets[part]);
+        }
+    }
+    run_parts(src.size(), parts,
+              [&](std::size_t part, std::size_t first, std::size_t last) {
+                  scan_part(part, parts, first, last, offsets[part]);
+              });
+}
+
+template <bool Exclusive, typename T, typename U>
+U scan(std::span<const T> src, std::span<U> dst, std::size_t threads) {
+    const auto* in = as_repr_span(src).data();
+    auto* out = as_repr_span(dst).data();
+    repr_t<U> total{0};
+    scan_parts<U>(src, threads, [&](std::size_t part, std::size_t parts, std::size_t first,
+                                    std::size_t last, repr_t<U> offset) {
+        const auto end = dispatch(scan_kernel<Exclusive>{}, in + first, out + first,
+                                  last - first, offset);
+        if (part + 1 == parts) {
+            total = end;
+        }
+    });
+    return static_cast<U>(total);
+}
+
+template <bool Exclusive, typename T, typename U>
+std::optional<std::size_t> scan_checked(std::span<const T> src,
+                                        std::span<U> dst,
+                                        std::size_t threads) {
+    const auto* in = as_repr_span(src).data();
+    auto* out = as_repr_span(dst).data();
+    std::vector<std::optional<std::size_t>> overflow(
+        part_count(src.size(), threads, scan_min_part));
+    // A part's offset is only exact if no earlier part overflowed, but in that case the
+    // earlier part's index is the one returned.
+    scan_parts<U>(src, threads, [&](std::size_t part, std::size_t, std::size_t first,
+                                    std::size_t last, repr_t<U> offset) {
+        overflow[part] = scan_checked_part<Exclusive>(in, out, first, last, offset);
+    });
+    for (const auto index : overflow) {
+        if (index) {
+            return index;
+        }
+    }
+    return std::nullopt;
+}
+
+template <typename T, typename U>
+concept scannable = stipp_int<T> && stipp_int<U> && repr_layout_compatible_v<T> &&
+                    repr_layout_compatible_v<U> && sizeof(T) <= sizeof(U);
+
+} // namespace detail
+
+template <stipp_int T, stipp_int U>
+    requires detail::scannable<T, U>
+U inclusive_scan(std::span<const T> src, std::span<U> dst, std::size_t threads = 1) {
+    detail::check_output_size(src.size(), dst.size(),
+                              "inclusive_scan output span is smaller than its input");
+    return detail::scan<false>(src, dst, threads);
+}
+
+template <stipp_int T, stipp_int U>
+    requires detail::scannable<T, U>
+U exclusive_scan(std::span<const T> src, std::span<U> dst, std::size_t threads = 1) {
+    detail::check_output_size(src.size(), dst.size(),
+                              "exclusive_scan output span is smaller than its input");
+    return detail::scan<true>(src, dst, threads);
+}
+
+template <stipp_int T, stipp_int U>
+    requires detail::scannable<T, U>
+std::optional<std::size_t> inclusive_scan_checked(std::span<const T> src,
+                                                  std::span<U> dst,
+                                                  std::size_t threads = 1) {
+    detail::check_output_size(
+        src.size(), dst.size(),
+        "inclusive_scan_checked output span is smaller than its input");
+    return detail::scan_checked<false>(src, dst, threads);
+}
+
+template <stipp_int T, stipp_int U>
+    requires detail::scannable<T, U>
+std::optional<std::size_t> exclusive_scan_checked(std::span<const T> src,
+                                                  std::span<U> dst,
+                                                  std::size_t threads = 1) {
+    detail::check_output_size(
+        src.size(), dst.size(),
+        "exclusive_scan_checked output span is smaller than its input");
+    return detail::scan_checked<true>(src, dst, threads);
+}
+
+namespace detail {
+
+// The 64-bit finalizer of MurmurHash3. Every input bit affects every output bit, and it
+// is a bijection, so distinct keys never collide before the table reduces them.
+constexpr std::uint64_t fmix64(std::uint64_t x) noexcept {
+    x ^= x >> 33;
+    x *= 0xFF51'AFD7'ED55'8CCDULL;
+    x ^= x >> 33;
+    x *= 0xC4CE'B9FE'1A85'EC53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+constexpr std::uint64_t splitmix64(std::uint64_t x) noexcept {
+    return fmix64(x + 0x9E37'79B9'7F4A'7C15ULL);
+}
+
+template <typename T>
+constexpr std::uint64_t hash_bits(T value) noexcept {
+    if constexpr (is_strong_id_v<T>) {
+        return hash_bits(value.value());
+    } else {
+        return static_cast<std::uint64_t>(to_bits(value));
+    }
+}
+
+template <typename T>
+concept hashable = stipp_int<T> || is_strong_id_v<T>;
+
+inline std::uint64_t random_hash_seed() {
+    static const std::uint64_t seed = [] {
+        std::random_device device;
+        return (std::uint64_t{device()} << 32) ^ device();
+    }();
+    return seed;
+}
+
+} // namespace detail
+
+template <detail::hashable T>
+struct hash {
+    static constexpr std::uint64_t mix(std::uint64_t bits) noexcept {
+        return detail::fmix64(bits);
+    }
+
+    constexpr std::size_t operator()(T value) const noexcept {
+        return static_cast<std::size_t>(mix(detail::hash_bits(value)));
+    }
+};
+
+// Mixes two secret keys into the hash. Without knowing them, an attacker cannot pick keys
+// that land in the same bucket. The default seed is random for each process.
+template <detail::hashable T>
+class seeded_hash {
+  public:
+    seeded_hash() : seeded_hash(detail::random_hash_seed()) {}
+
+    explicit constexpr seeded_hash(std::uint64_t seed) noexcept
+        : key0_(detail::splitmix64(seed)), key1_(detail::splitmix64(key0_)) {}
+
+    constexpr std::uint64_t mix(std::uint64_t bits) const noexcept {
+        return detail::fmix64(detail::fmix64(bits ^ key0_) + key1_);
+    }
+
+    constexpr std::size_t operator()(T value) const noexcept {
+        return static_cast<std::size_t>(mix(detail::hash_bits(value)));
+    }
+
+  private:
+    std::uint64_t key0_;
+    std::uint64_t key1_;
+};
+
+namespace detail {
+
+struct hash_kernel {
+    template <typename T, typename Hash>
+    STIPP_KERNEL constexpr void operator()(std::span<const T> values,
+                                           std::uint64_t* out,
+                                           Hash hasher) const noexcept {
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            out[i] = hasher.mix(hash_bits(values[i]));
+        }
+    }
+};
+
+} // namespace detail
+
+template <detail::hashable T, typename Hash = hash<T>>
+    requires(std::same_as<Hash, hash<T>> || std::same_as<Hash, seeded_hash<T>>)
+void hash_n(std::span<const T> values, std::span<u64> out, const Hash& hasher = {}) {
+    detail::check_output_size(values.size(), out.size(),
+                              "hash_n output span is smaller than its input");
+    detail::dispatch(detail::hash_kernel{}, values, as_repr_span(out).data(), hasher);
+}
+
+// Names a key value that a flat_map or flat_set never stores. The table then marks empty
+// slots with that key instead of keeping a separate control byte per slot.
+template <typename K, K Key>
+struct empty_key {
+    static constexpr K value = Key;
+};
+
+namespace detail {
+
+inline void prefetch(const void* address) noexcept {
+#if defined(__GNUC__)
+    __builtin_prefetch(address);
+#elif STIPP_SSE2
+    _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#else
+    static_cast<void>(address);
+#endif
+}
+
+template <typename E, typename K>
+concept empty_key_of = std::is_void_v<E> || std::same_as<decltype(E::value), const K>;
+
+// Integer keys may be looked up by any integer type. Values the key type cannot represent
+// are simply not found.
+template <typename Q, typename K>
+concept lookup_key_of =
+    std::same_as<Q, K> ||
+    (stipp_int<K> && std::is_enum_v<K> &&
+     ((stipp_int<Q> && std::is_enum_v<Q>) || (std::integral<Q> && !std::same_as<Q, bool>)));
+
+template <typename K, typename Q>
+constexpr std::optional<K> lookup_key(Q key) noexcept {
+    if constexpr (std::same_as<Q, K>) {
+        return key;
+    } else {
+        const auto value = [key] {
+            if constexpr (stipp_int<Q>) {
+                return to_repr(key);
+            } else {
+                return key;
+            }
+        }();
+        if (!std::in_range<repr_t<K>>(value)) {
+            return std::nullopt;
+        }
+        return static_cast<K>(static_cast<repr_t<K>>(value));
+    }
+}
+
+inline constexpr std::size_t group_width = 16;
+inline constexpr std::int8_t ctrl_empty = -128;
+inline constexpr std::int8_t ctrl_deleted = -2;
+
+// One bit per slot of a probe group.
+class group_mask {
+  public:
+    constexpr explicit group_mask(std::uint32_t bits) noexcept : bits_(bits) {}
+
+    constexpr explicit operator bool() const noexcept { return bits_ != 0; }
+
+    [[nodiscard]] constexpr std::size_t lowest() const noexcept {
+        return static_cast<std::size_t>(std::countr_zero(bits_));
+    }
+
+    [[nodiscard]] constexpr std::size_t highest_gap() const noexcept {
+        const auto low_half = static_cast<std::uint16_t>(bits_);
+        return static_cast<std::size_t>(std::countl_zero(low_half));
+    }
+
+    constexpr void clear_lowest() noexcept { bits_ &= bits_ - 1; }
+
+  private:
+    std::uint32_t bits_;
+};
+
+// Sixteen control bytes. A full slot stores the low seven bits of its key's hash, so one
+// byte compare rules out most keys before their slots are read.
+class ctrl_group {
+  public:
+    explicit ctrl_group(const std::int8_t* ctrl) noexcept {
+#if STIPP_SSE2
+        bytes_ = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+#else
+        std::memcpy(bytes_.data(), ctrl, group_width);
+#endif
+    }
+
+    [[nodiscard]] group_mask match(std::int8_t tag) const noexcept {
+#if STIPP_SSE2
+        return group_mask{movemask(_mm_cmpeq_epi8(bytes_, _mm_set1_epi8(tag)))};
+#else
+        std::uint32_t bits = 0;
+        for (std::size_t i = 0; i < group_width; ++i) {
+            bits |= std::uint32_t{bytes_[i] == tag} << i;
+        }
+        return group_mask{bits};
+#endif
+    }
+
+    [[nodiscard]] group_mask match_empty() const noexcept { return match(ctrl_empty); }
+
+    // Empty and deleted slots are the only ones with the sign bit set.
+    [[nodiscard]] group_mask match_free() const noexcept {
+#if STIPP_SSE2
+        return group_mask{movemask(bytes_)};
+#else
+        std::uint32_t bits = 0;
+        for (std::size_t i = 0; i < group_width; ++i) {
+            bits |= std::uint32_t{bytes_[i] < 0} << i;
+        }
+        return group_mask{bits};
+#endif
+    }
+
+  private:
+#if STIPP_SSE2
+    static std::uint32_t movemask(__m128i bytes) noexcept {
+        return static_cast<std::uint32_t>(_mm_movemask_epi8(bytes));
+    }
+
+    __m128i bytes_;
+#else
+    std::array<std::int8_t, group_width> bytes_;
+#endif
+};
+
+// Open addressing table shared by flat_map and flat_set. Keys, values and control bytes
+// live in separate arrays. With an empty key, control bytes are dropped for linear probing
+// over the keys themselves.
+template <typename K, typename V, typename Hash, typename EmptyKey>
+class flat_table {
+  protected:
+    static constexpr bool has_values = !std::is_void_v<V>;
+    static constexpr bool has_ctrl = std::is_void_v<EmptyKey>;
+    static constexpr std::size_t npos = SIZE_MAX;
+
+    using value_storage = std::conditional_t<has_values, V, std::byte>;
+
+    template <bool Const>
+    class basic_iterator {
+        using table_pointer = std::conditional_t<Const, const flat_table*, flat_table*>;
+        using mapped_reference =
+            std::conditional_t<Const, const value_storage&, value_storage&>;
+
+      public:
+        using value_type = std::conditional_t<has_values, std::pair<K, value_storage>, K>;
+        using reference =
+            std::conditional_t<has_values, std::pair<const K&, mapped_reference>, const K&>;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::conditional_t<has_values,
+                                                     std::input_iterator_tag,
+                                                     std::forward_iterator_tag>;
+
+        basic_iterator() = default;
+
+        constexpr basic_iterator(table_pointer table, std::size_t index) noexcept
+            : table_(table), index_(index) {}
+
+        template <bool OtherConst>
+            requires(Const && !OtherConst)
+        constexpr basic_iterator(const basic_iterator<OtherConst>& other) noexcept
+            : table_(other.table_), index_(other.index_) {}
+
+        constexpr reference operator*() const noexcept {
+            if constexpr (has_values) {
+                return {table_->keys_[index_], table_->values_[index_]};
+            } else {
+                return table_->keys_[index_];
+            }
+        }
+
+        constexpr basic_iterator& operator++() noexcept {
+            index_ = table_->next_full(index_ + 1);
+            return *this;
+        }
+
+        constexpr basic_iterator operator++(int) noexcept {
+            const basic_iterator ret = *this;
+            ++*this;
+            return ret;
+        }
+
+        friend constexpr bool operator==(basic_iterator lhs, basic_iterator rhs) noexcept {
+            return lhs.index_ == rhs.index_;
+        }
+
+      private:
+        friend class flat_table;
+        friend class basic_iterator<!Const>;
+
+        table_pointer table_{};
+        std::size_t index_{};
+    };
+
+  public:
+    using key_type = K;
+    using size_type = std::size_t;
+    using hasher = Hash;
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+
+    flat_table() = default;
+
+    explicit flat_table(const Hash& hash) : hash_(hash) {}
+
+    flat_table(const flat_table& other) : flat_table(other.hash_) {
+        reserve(other.size_);
+        other.for_each_full([&](std::size_t i) {
+            const std::size_t slot = prepare_insert(other.keys_[i], hash_(other.keys_[i]));
+            if constexpr (has_values) {
+                construct_value(slot, other.values_[i]);
+            }
+        });
+    }
+
+    flat_table(flat_table&& other) noexcept : flat_table(other.hash_) { swap(other); }
+
+    flat_table& operator=(flat_table other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    ~flat_table() { release(); }
+
+    void swap(flat_table& other) noexcept {
+        using std::swap;
+        swap(hash_, other.hash_);
+        swap(keys_, other.keys_);
+        swap(values_, other.values_);
+        swap(ctrl_, other.ctrl_);
+        swap(capacity_, other.capacity_);
+        swap(size_, other.size_);
+        swap(growth_left_, other.growth_left_);
+    }
+
+    friend void swap(flat_table& lhs, flat_table& rhs) noexcept { lhs.swap(rhs); }
+
+    [[nodiscard]] std::size_t size() const noexcept { return size_; }
+
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+
+    [[nodiscard]] std::size_t capacity() const noexcept { return capacity_; }
+
+    [[nodiscard]] Hash hash_function() const { return hash_; }
+
+    iterator begin() noexcept { return iterator{this, next_full(0)}; }
+
+    iterator end() noexcept { return iterator{this, capacity_}; }
+
+    [[nodiscard]] const_iterator begin() const noexcept {
+        return const_iterator{this, next_full(0)};
+    }
+
+    [[nodiscard]] const_iterator end() const noexcept {
+        return const_iterator{this, capacity_};
+    }
+
+    void clear() noexcept {
+        destroy_values();
+        reset_slots();
+        size_ = 0;
+        growth_left_ = max_load(capacity_);
+    }
+
+    void reserve(std::size_t count) {
+        if (count > size_ + growth_left_) {
+            rehash(capacity_for(count));
+        }
+    }
+
+    template <lookup_key_of<K> Q>
+    iterator find(Q key) {
+        return iterator{this, found_or_end(lookup(key))};
+    }
+
+    template <lookup_key_of<K> Q>
+    [[nodiscard]] const_iterator find(Q key) const {
+        return const_iterator{this, found_or_end(lookup(key))};
+    }
+
+    template <lookup_key_of<K> Q>
+    [[nodiscard]] bool contains(Q key) const {
+        return lookup(key) != npos;
+    }
+
+    template <lookup_key_of<K> Q>
+    [[nodiscard]] std::size_t count(Q key) const {
+        return lookup(key) != npos ? 1 : 0;
+    }
+
+    template <lookup_key_of<K> Q>
+    std::size_t erase(Q key) {
+        const std::size_t index = lookup(key);
+        if (index == npos) {
+            return 0;
+        }
+        erase_index(index);
+        return 1;
+    }
+
+    // Iterators other than pos stay valid only with control bytes. Without them, erasing
+    // shifts later keys of the probe run back into the freed slot.
+    void erase(const_iterator pos) { erase_index(pos.index_); }
+
+    friend bool operator==(const flat_table& lhs, const flat_table& rhs) {
+        if (lhs.size_ != rhs.size_) {
+            return false;
+        }
+        bool equal = true;
+        lhs.for_each_full([&](std::size_t i) {
+            const std::size_t j = rhs.find_index(lhs.keys_[i], rhs.hash_(lhs.keys_[i]));
+            if constexpr (has_values) {
+                equal = equal && j != npos && lhs.values_[i] == rhs.values_[j];
+            } else {
+                equal = equal && j != npos;
+            }
+        });
+        return equal;
+    }
+
+  protected:
+    template <typename Q>
+    std::size_t lookup(Q key) const {
+        const std::optional<K> converted = lookup_key<K>(key);
+        return converted ? find_index(*converted, hash_(*converted)) : npos;
+    }
+
+    std::size_t found_or_end(std::size_t index) const noexcept {
+        return index == npos ? capacity_ : index;
+    }
+
+    // Returns the slot of key and whether it was just inserted. The caller constructs the
+    // value of a new slot.
+    std::pair<std::size_t, bool> find_or_prepare(K key) {
+        const std::size_t hashed = hash_(key);
+        if (const std::size_t index = find_index(key, hashed); index != npos) {
+            return {index, false};
+        }
+        return {prepare_insert(key, hashed), true};
+    }
+
+    template <typename... Args>
+    void construct_value(std::size_t index, Args&&... args) {
+        try {
+            std::construct_at(values_ + index, std::forward<Args>(args)...);
+        } catch (...) {
+            abandon(index);
+            throw;
+        }
+    }
+
+    // Hashes a block of keys and prefetches their first probe positions before probing
+    // any of them, so the cache misses of independent lookups overlap.
+    template <typename F>
+    void find_indices(std::span<const K> keys, F&& fn) const {
+        constexpr std::size_t block = 16;
+        std::array<std::size_t, block> hashes{};
+        for (std::size_t first = 0; first < keys.size(); first += block) {
+            const std::size_t count = (std::min)(block, keys.size() - first);
+            if (capacity_ != 0) {
+                for (std::size_t i = 0; i < count; ++i) {
+                    hashes[i] = hash_(keys[first + i]);
+                    const std::size_t pos = home(hashes[i]) & (capacity_ - 1);
+                    if constexpr (has_ctrl) {
+                        prefetch(ctrl_ + pos);
+                    }
+                    prefetch(keys_ + pos);
+                }
+            }
+            for (std::size_t i = 0; i < count; ++i) {
+                fn(first + i, find_index(keys[first + i], hashes[i]));
+            }
+        }
+    }
+
+    K* keys_ = nullptr;
+    value_storage* values_ = nullptr;
+
+  private:
+    static constexpr std::size_t home(std::size_t hashed) noexcept { return hashed >> 7; }
+
+    static constexpr std::int8_t tag(std::size_t hashed) noexcept {
+        return static_cast<std::int8_t>(hashed & 0x7F);
+    }
+
+    // Group probing stays short up to 7/8 full. Linear probing clusters much sooner.
+    static constexpr std::size_t max_load(std::size_t capacity) noexcept {
+        if constexpr (has_ctrl) {
+            return capacity - capacity / 8;
+        } else {
+            return capacity / 2 + capacity / 4;
+        }
+    }
+
+    static std::size_t capacity_for(std::size_t count) {
+        if (count > (std::numeric_limits<std::size_t>::max)() / 4 / sizeof(K)) {
+            throw std::length_error("flat table size is too large");
+        }
+        std::size_t capacity = group_width;
+        while (max_load(capacity) < count) {
+            capacity *= 2;
+        }
+        return capacity;
+    }
+
+    [[nodiscard]] bool is_full(std::size_t index) const noexcept {
+        if constexpr (has_ctrl) {
+            return ctrl_[index] >= 0;
+        } else {
+            return keys_[index] != EmptyKey::value;
+        }
+    }
+
+    [[nodiscard]] std::size_t next_full(std::size_t index) const noexcept {
+        while (index < capacity_ && !is_full(index)) {
+            ++index;
+        }
+        return index;
+    }
+
+    template <typename F>
+    void for_each_full(F&& fn) const {
+        for (std::size_t i = next_full(0); i < capacity_; i = next_full(i + 1)) {
+            fn(i);
+        }
+    }
+
+    std::size_t find_index(K key, std::size_t hashed) const noexcept {
+        if (capacity_ == 0) {
+            return npos;
+        }
+        const std::size_t mask = capacity_ - 1;
+        std::size_t pos = home(hashed) & mask;
+        if constexpr (has_ctrl) {
+            for (std::size_t step = group_width;; step += group_width) {
+                const ctrl_group group(ctrl_ + pos);
+                group_mask match = group.match(tag(hashed));
+                for (; match; match.clear_lowest()) {
+                    const std::size_t index = (pos + match.lowest()) & mask;
+                    if (keys_[index] == key) {
+                        return index;
+                    }
+                }
+                if (group.match_empty()) {
+                    return npos;
+                }
+                pos = (pos + step) & mask;
+            }
+        } else {
+            if (key == EmptyKey::value) {
+                return npos;
+            }
+            for (;; pos = (pos + 1) & mask) {
+                if (keys_[pos] == key) {
+                    return pos;
+                }
+                if (keys_[pos] == EmptyKey::value) {
+                    return npos;
+                }
+            }
+        }
+    }
+
+    std::size_t find_free(std::size_t hashed) const noexcept {
+        const std::size_t mask = capacity_ - 1;
+        std::size_t pos = home(hashed) & mask;
+        if constexpr (has_ctrl) {
+            for (std::size_t step = group_width;; step += group_width) {
+                if (const group_mask free = ctrl_group(ctrl_ + pos).match_free()) {
+                    return (pos + free.lowest()) & mask;
+                }
+                pos = (pos + step) & mask;
+            }
+        } else {
+            while (keys_[pos] != EmptyKey::value) {
+                pos = (pos + 1) & mask;
+            }
+            return pos;
+        }
+    }
+
+    std::size_t prepare_insert(K key, std::size_t hashed) {
+        if constexpr (!has_ctrl) {
+            if (key == EmptyKey::value) {
+                throw std::invalid_argument("flat table cannot store its empty key");
+            }
+        }
+        if (growth_left_ == 0) {
+            grow();
+        }
+        const std::size_t index = find_free(hashed);
+        if constexpr (has_ctrl) {
+            if (ctrl_[index] == ctrl_empty) {
+                --growth_left_;
+            }
+            set_ctrl(index, tag(hashed));
+        } else {
+            --growth_left_;
+        }
+        keys_[index] = key;
+        ++size_;
+        return index;
+    }
+
+    // Releases a prepared slot whose value failed to construct.
+    void abandon(std::size_t index) noexcept {
+        if constexpr (has_ctrl) {
+            set_ctrl(index, ctrl_deleted);
+        } else {
+            keys_[index] = EmptyKey::value;
+            ++growth_left_;
+        }
+        --size_;
+    }
+
+    void erase_index(std::size_t index) noexcept {
+        if constexpr (has_values) {
+            std::destroy_at(values_ + index);
+        }
+        --size_;
+        const std::size_t mask = capacity_ - 1;
+        if constexpr (has_ctrl) {
+            // A slot can go straight back to empty if every group covering it has an
+            // empty slot, since no probe has ever continued past such a group.
+            const group_mask before = ctrl_group(ctrl_ + ((index - group_width) & mask))
+                                          .match_empty();
+            const group_mask after = ctrl_group(ctrl_ + index).match_empty();
+            if (before && after && before.highest_gap() + after.lowest() < group_width) {
+                set_ctrl(index, ctrl_empty);
+                ++growth_left_;
+            } else {
+                set_ctrl(index, ctrl_deleted);
+            }
+        } else {
+            std::size_t hole = index;
+            for (std::size_t pos = (index + 1) & mask; keys_[pos] != EmptyKey::value;
+                 pos = (pos + 1) & mask) {
+                // The key may fill the hole only if the hole lies between its home slot
+                // and its current one.
+                const std::size_t wanted = home(hash_(keys_[pos])) & mask;
+                if (((pos - wanted) & mask) >= ((pos - hole) & mask)) {
+                    keys_[hole] = keys_[pos];
+                    if constexpr (has_values) {
+                        std::construct_at(values_ + hole, std::move(values_[pos]));
+                        std::destroy_at(values_ + pos);
+                    }
+                    hole = pos;
+                }
+            }
+            keys_[hole] = EmptyKey::value;
+            ++growth_left_;
+        }
+    }
+
+    void set_ctrl(std::size_t index, std::int8_t value) noexcept {
+        ctrl_[index] = value;
+        // The first group is mirrored past the end so probes never wrap mid-group.
+        if (index < group_width) {
+            ctrl_[capacity_ + index] = value;
+        }
+    }
+
+    // Reclaims tombstones in place when they, rather than live keys, used up the room.
+    void grow() {
+        if (capacity_ != 0 && size_ <= max_load(capacity_) / 2) {
+            rehash(capacity_);
+        } else {
+            rehash(capacity_ == 0 ? group_width : capacity_ * 2);
+        }
+    }
+
+    void rehash(std::size_t capacity) {
+        flat_table other(hash_);
+        other.allocate(capacity);
+        for_each_full([&](std::size_t i) {
+            const std::size_t slot = other.prepare_insert(keys_[i], hash_(keys_[i]));
+            if constexpr (has_values) {
+                other.construct_value(slot, std::move(values_[i]));
+            }
+        });
+        swap(other);
+    }
+
+    void allocate(std::size_t capacity) {
+        capacity_ = capacity;
+        keys_ = std::allocator<K>{}.allocate(capacity);
+        if constexpr (has_values) {
+            values_ = std::allocator<V>{}.allocate(capacity);
+        }
+        if constexpr (has_ctrl) {
+            ctrl_ = std::allocator<std::int8_t>{}.allocate(capacity + group_width);
+        }
+        reset_slots();
+        growth_left_ = max_load(capacity);
+    }
+
+    void reset_slots() noexcept {
+        if (capacity_ == 0) {
+            return;
+        }
+        if constexpr (has_ctrl) {
+            std::fill_n(ctrl_, capacity_ + group_width, ctrl_empty);
+        } else {
+            std::fill_n(keys_, capacity_, EmptyKey::value);
+        }
+    }
+
+    void destroy_values() noexcept {
+        if constexpr (has_values && !std::is_trivially_destructible_v<V>) {
+            if (size_ != 0) {
+                for_each_full([this](std::size_t i) { std::destroy_at(values_ + i); });
+            }
+        }
+    }
+
+    void release() noexcept {
+        destroy_values();
+        if (keys_ != nullptr) {
+            std::allocator<K>{}.deallocate(keys_, capacity_);
+        }
+        if constexpr (has_values) {
+            if (values_ != nullptr) {
+                std::allocator<V>{}.deallocate(values_, capacity_);
+            }
+        }
+        if constexpr (has_ctrl) {
+            if (ctrl_ != nullptr) {
+                std::allocator<std::int8_t>{}.deallocate(ctrl_, capacity_ + group_width);
+            }
+        }
+    }
+
+    Hash hash_{};
+    std::int8_t* ctrl_ = nullptr;
+    std::size_t capacity_ = 0;
+    std::size_t size_ = 0;
+    std::size_t growth_left_ = 0;
+};
+
+} // namespace detail
+
+// Swiss table style hash map. Lookups compare sixteen control bytes at a time and only
+// read keys whose hash tag matches. Keys and values are stored inline, so a lookup touches
+// at most a few cache lines and never follows node pointers.
+template <detail::hashable K,
+          typename V,
+          typename Hash = hash<K>,
+          detail::empty_key_of<K> EmptyKey = void>
+class flat_map : public detail::flat_table<K, V, Hash, EmptyKey> {
+    using base = detail::flat_table<K, V, Hash, EmptyKey>;
+
+  public:
+    using mapped_type = V;
+    using value_type = std::pair<K, V>;
+    using typename base::const_iterator;
+    using typename base::iterator;
+
+    using base::base;
+
+    flat_map(std::initializer_list<value_type> init, const Hash& hash = {})
+        : base(hash) {
+        this->reserve(init.size());
+        for (const value_type& value : init) {
+            insert(value);
+        }
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(K key, Args&&... args) {
+        const auto [index, inserted] = this->find_or_prepare(key);
+        if (inserted) {
+            this->construct_value(index, std::forward<Args>(args)...);
+        }
+        return {iterator{this, index}, inserted};
+    }
+
+    std::pair<iterator, bool> insert(const value_type& value) {
+        return try_emplace(value.first, value.second);
+    }
+
+    std::pair<iterator, bool> insert(value_type&& value) {
+        return try_emplace(value.first, std::move(value.second));
+    }
+
+    template <typename M>
+    std::pair<iterator, bool> insert_or_assign(K key, M&& value) {
+        const auto [index, inserted] = this->find_or_prepare(key);
+        if (inserted) {
+            this->construct_value(index, std::forward<M>(value));
+        } else {
+            this->values_[index] = std::forward<M>(value);
+        }
+        return {iterator{this, index}, inserted};
+    }
+
+    V& operator[](K key) { return (*try_emplace(key).first).second; }
+
+    template <detail::lookup_key_of<K> Q>
+    V& at(Q key) {
+        return this->values_[checked_lookup(key)];
+    }
+
+    template <detail::lookup_key_of<K> Q>
+    [[nodiscard]] const V& at(Q key) const {
+        return this->values_[checked_lookup(key)];
+    }
+
+    // Writes a pointer to the value of each key, or null for missing keys.
+    void find_n(std::span<const K> keys, std::span<V*> out) {
+        detail::check_output_size(keys.size(), out.size(),
+                                  "flat_map find_n output span is smaller than its input");
+        this->find_indices(keys, [&](std::size_t i, std::size_t index) {
+            out[i] = index == base::npos ? nullptr : this->values_ + index;
+        });
+    }
+
+    void find_n(std::span<const K> keys, std::span<const V*> out) const {
+        detail::check_output_size(keys.size(), out.size(),
+                                  "flat_map find_n output span is smaller than its input");
+        this->find_indices(keys, [&](std::size_t i, std::size_t index) {
+            out[i] = index == base::npos ? nullptr : this->values_ + index;
+        });
+    }
+
+  private:
+    template <typename Q>
+    std::size_t checked_lookup(Q key) const {
+        const std::size_t index = this->lookup(key);
+        if (index == base::npos) {
+            throw std::out_of_range("flat_map key not found");
+        }
+        return index;
+    }
+};
+
+template <detail::hashable K,
+          typename Hash = hash<K>,
+          detail::empty_key_of<K> EmptyKey = void>
+class flat_set : public detail::flat_table<K, void, Hash, EmptyKey> {
+    using base = detail::flat_table<K, void, Hash, EmptyKey>;
+
+  public:
+    using value_type = K;
+    using typename base::const_iterator;
+    using typename base::iterator;
+
+    using base::base;
+
+    flat_set(std::initializer_list<K> init, const Hash& hash = {}) : base(hash) {
+        insert(init.begin(), init.end());
+    }
+
+    std::pair<iterator, bool> insert(K key) {
+        const auto [index, inserted] = this->find_or_prepare(key);
+        return {iterator{this, index}, inserted};
+    }
+
+    template <std::input_iterator It, std::sentinel_for<It> S>
+    void insert(It first, S last) {
+        if constexpr (std::sized_sentinel_for<S, It>) {
+            this->reserve(this->size() + static_cast<std::size_t>(last - first));
+        }
+        for (; first != last; ++first) {
+            insert(*first);
+        }
+    }
+
+    // Writes a pointer to the stored copy of each key, or null for missing keys.
+    void find_n(std::span<const K> keys, std::span<const K*> out) const {
+        detail::check_output_size(keys.size(), out.size(),
+                                  "flat_set find_n output span is smaller than its input");
+        this->find_indices(keys, [&](std::size_t i, std::size_t index) {
+            out[i] = index == base::npos ? nullptr : this->keys_ + index;
+        });
+    }
+};
+
+namespace detail {
+
+inline constexpr std::size_t radix_buckets = 256;
+inline constexpr std::size_t radix_min_part = std::size_t{1} << 16;
+inline constexpr std::size_t radix_insertion_limit = 64;
+
+template <typename T>
+using radix_key_t = std::make_unsigned_t<repr_t<T>>;
+
+// Flipping the sign bit orders two's complement values like unsigned ones.
+template <typename T>
+constexpr radix_key_t<T> radix_key(T value) noexcept {
+    using key_type = radix_key_t<T>;
+    const key_type bits = to_bits(value);
+    if constexpr (is_signed_v<T>) {
+        return static_cast<key_type>(bits ^ (key_type{1} << (8 * sizeof(key_type) - 1)));
+    } else {
+        return bits;
+    }
+}
+
+// Digits are taken from the distance to the smallest key, so only as many passes run as
+// the range of the keys needs, even when that range straddles zero.
+template <typename T>
+struct radix_range {
+    radix_key_t<T> base{};
+    std::size_t passes = 0;
+
+    [[nodiscard]] constexpr std::size_t digit(T value, std::size_t pass) const noexcept {
+        const auto offset = static_cast<radix_key_t<T>>(radix_key(value) - base);
+        return static_cast<std::size_t>((offset >> (8 * pass)) & 0xFF);
+    }
+};
+
+template <typename T>
+struct radix_bounds {
+    radix_key_t<T> min = (std::numeric_limits<radix_key_t<T>>::max)();
+    radix_key_t<T> max{};
+
+    constexpr void add(std::span<const T> values) noexcept {
+        for (const T value : values) {
+            min = (std::min)(min, radix_key(value));
+            max = (std::max)(max, radix_key(value));
+        }
+    }
+
+    constexpr void add(const radix_bounds& other) noexcept {
+        min = (std::min)(min, other.min);
+        max = (std::max)(max, other.max);
+    }
+
+    [[nodiscard]] constexpr radix_range<T> range() const noexcept {
+        const auto spread = static_cast<std::uint64_t>(max - min);
+        const auto bits = static_cast<std::size_t>(std::bit_width(spread));
+        return {min, (bits + 7) / 8};
+    }
+};
+
+template <typename T>
+using radix_counts = std::array<std::array<std::size_t, radix_buckets>, sizeof(repr_t<T>)>;
+
+// Stands in for the values of a keys-only sort.
+struct radix_no_values {};
+
+template <typename K>
+void radix_count(std::span<const K> keys,
+                 const radix_range<K>& range,
+                 radix_counts<K>& counts) noexcept {
+    for (const K key : keys) {
+        for (std::size_t pass = 0; pass < range.passes; ++pass) {
+            ++counts[pass][range.digit(key, pass)];
+        }
+    }
+}
+
+template <typename K, typename V>
+void radix_insertion_sort(std::span<K> keys, std::span<V> values) {
+    constexpr bool with_values = !std::same_as<V, radix_no_values>;
+    for (std::size_t i = 1; i < keys.size(); ++i) {
+        const K key = keys[i];
+        std::size_t j = i;
+        if constexpr (with_values) {
+            V value = std::move(values[i]);
+            for (; j > 0 && radix_key(keys[j - 1]) > radix_key(key); --j) {
+                keys[j] = keys[j - 1];
+                values[j] = std::move(values[j - 1]);
+            }
+            values[j] = std::move(value);
+        } else {
+            for (; j > 0 && radix_key(keys[j - 1]) > radix_key(key); --j) {
+                keys[j] = keys[j - 1];
+            }
+        }
+        keys[j] = key;
+    }
+}
+
+// Stable sort that moves elements back and forth between the input and the buffers,
+// skipping passes whose digit is the same for every key. Returns true if the sorted
+// elements ended up in the buffers.
+template <typename K, typename V>
+bool radix_lsd(std::span<K> keys,
+               std::span<K> key_buf,
+               std::span<V> values,
+               std::span<V> value_buf) {
+    constexpr bool with_values = !std::same_as<V, radix_no_values>;
+    if (keys.size() <= radix_insertion_limit) {
+        radix_insertion_sort(keys, values);
+        return false;
+    }
+    radix_bounds<K> bounds;
+    bounds.add(keys);
+    const radix_range<K> range = bounds.range();
+    radix_counts<K> counts{};
+    radix_count(std::span<const K>(keys), range, counts);
+
+    bool in_buf = false;
+    for (std::size_t pass = 0; pass < range.passes; ++pass) {
+        const auto& count = counts[pass];
+        if (count[range.digit(keys[0], pass)] == keys.size()) {
+            continue;
+        }
+        std::array<std::size_t, radix_buckets> offsets;
+        std::size_t running = 0;
+        for (std::size_t bucket = 0; bucket < radix_buckets; ++bucket) {
+            offsets[bucket] = running;
+            running += count[bucket];
+        }
+        const std::span<K> src = in_buf ? key_buf : keys;
+        const std::span<K> dst = in_buf ? keys : key_buf;
+        const std::span<V> src_values = in_buf ? value_buf : values;
+        const std::span<V> dst_values = in_buf ? values : value_buf;
+        for (std::size_t i = 0; i < src.size(); ++i) {
+            const std::size_t pos = offsets[range.digit(src[i], pass)]++;
+            dst[pos] = src[i];
+            if constexpr (with_values) {
+                dst_values[pos] = std::move(src_values[i]);
+            }
+        }
+        in_buf = !in_buf;
+    }
+    return in_buf;
+}
+
+template <typename K, typename V>
+void radix_move_back(std::span<K> from_keys,
+                     std::span<K> to_keys,
+                     std::span<V> from_values,
+                     std::span<V> to_values) {
+    std::copy(from_keys.begin(), from_keys.end(), to_keys.begin());
+    if constexpr (!std::same_as<V, radix_no_values>) {
+        std::move(from_values.begin(), from_values.end(), to_values.begin());
+    }
+}
+
+// With several threads, the keys are first scattered by their most significant digit,
+// each part into its own slice of every bucket so the order stays stable. The buckets
+// are then independent LSD sorts, run as tasks so that the pool balances skewed buckets
+// by stealing.
+template <typename K, typename V>
+void radix_sort(std::span<K> keys, std::span<V> values, std::size_t threads) {
+    constexpr bool with_values = !std::same_as<V, radix_no_values>;
+    if (keys.size() <= radix_insertion_limit) {
+        radix_insertion_sort(keys, values);
+        return;
+    }
+    std::vector<K> key_storage(keys.size());
+    std::vector<V> value_storage(with_values ? values.size() : 0);
+    const std::span<K> key_buf(key_storage);
+    const std::span<V> value_buf(value_storage);
+
+    const std::size_t parts = part_count(keys.size(), threads, radix_min_part);
+    if (parts == 1) {
+        if (radix_lsd(keys, key_buf, values, value_buf)) {
+            radix_move_back(key_buf, keys, value_buf, values);
+        }
+        return;
+    }
+
+    const std::span<const K> const_keys(keys);
+    std::vector<radix_bounds<K>> part_bounds(parts);
+    run_parts(keys.size(), parts,
+              [&](std::size_t part, std::size_t first, std::size_t last) {
+                  part_bounds[part].add(const_keys.subspan(first, last - first));
+              });
+    radix_bounds<K> bounds;
+    for (const auto& part : part_bounds) {
+        bounds.add(part);
+    }
+    const radix_range<K> range = bounds.range();
+    if (range.passes == 0) {
+        return;
+    }
+    const std::size_t msd = range.passes - 1;
+
+    std::vector<std::array<std::size_t, radix_buckets>> offsets(parts);
+    run_parts(keys.size(), parts,
+              [&](std::size_t part, std::size_t first, std::size_t last) {
+                  for (std::size_t i = first; i < last; ++i) {
+                      ++offsets[part][range.digit(keys[i], msd)];
+                  }
+              });
+    std::array<std::size_t, radix_buckets + 1> bucket_begin{};
+    std::size_t running = 0;
+    for (std::size_t bucket = 0; bucket < radix_buckets; ++bucket) {
+        bucket_begin[bucket] = running;
+        for (auto& offset : offsets) {
+            running += std::exchange(offset[bucket], running);
+        }
+    }
+    bucket_begin[radix_buckets] = running;
+
+    run_parts(keys.size(), parts,
+              [&](std::size_t part, std::size_t first, std::size_t last) {
+                  auto& offset = offsets[part];
+                  for (std::size_t i = first; i < last; ++i) {
+                      const std::size_t pos = offset[range.digit(keys[i], msd)]++;
+                      key_buf[pos] = keys[i];
+                      if constexpr (with_values) {
+                          value_buf[pos] = std::move(values[i]);
+                      }
+                  }
+              });
+
+    thread_pool::global().run(radix_buckets, [&](std::size_t bucket) {
+        const std::size_t first = bucket_begin[bucket];
+        const std::size_t count = bucket_begin[bucket + 1] - first;
+        // Without values, both value spans are empty and cannot be sliced at `first`.
+        const auto bucket_values =
+            with_values ? values.subspan(first, count) : std::span<V>();
+        const auto bucket_value_buf =
+            with_values ? value_buf.subspan(first, count) : std::span<V>();
+        if (!radix_lsd(key_buf.subspan(first, count), keys.subspan(first, count),
+                       bucket_value_buf, bucket_values)) {
+            radix_move_back(key_buf.subspan(first, count), keys.subspan(first, count),
+                            bucket_value_buf, bucket_values);
+        }
+    });
+}
+
+} // namespace detail
+
+template <stipp_int T>
+void radix_sort(std::span<T> values, std::size_t threads = 1) {
+    detail::radix_sort(values, std::span<detail::radix_no_values>(), threads);
+}
+
+// Stable: values with equal keys keep their relative order.
+template <stipp_int K, typename V>
+    requires(std::movable<V> && std::default_initializable<V>)
+void radix_sort_by_key(std::span<K> keys, std::span<V> values, std::size_t threads = 1) {
+    if (keys.size() != values.size()) {
+        throw std::length_error("radix_sort_by_key key and value spans differ in size");
+    }
+    detail::radix_sort(keys, values, threads);
+}
+
+namespace detail {
+
+// One cache line of keys. Each internal node routes to width + 1 children.
+template <typename R>
+struct search_node {
+    static constexpr std::size_t width = cache_line_size / sizeof(R);
+
+    alignas(cache_line_size) std::array<R, width> keys;
+};
+
+template <typename R>
+struct search_layout {
+    const search_node<R>* nodes;
+    const std::size_t* layer_offsets;
+    std::size_t height;
+    std::size_t size;
+};
+
+inline constexpr std::size_t search_batch_size = 16;
+
+struct search_index_kernel {
+    // Counts the keys of a node that are less than key. Nodes are sorted, so this is the
+    // position of key in the node, found without branches.
+    template <typename R>
+    STIPP_KERNEL static std::size_t rank(const search_node<R>& node, R key) noexcept {
+        std::size_t count = 0;
+        for (const R k : node.keys) {
+            count += static_cast<std::size_t>(k < key);
+        }
+        return count;
+    }
+
+#if STIPP_X86_DISPATCH
+    // AVX2 only has signed comparisons, so unsigned keys are biased into the signed range.
+    template <typename R>
+    STIPP_TARGET_AVX2 static std::size_t rank_avx2(const search_node<R>& node,
+                                                   R key) noexcept {
+        // NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast)
+        const auto* p = reinterpret_cast<const __m256i*>(node.keys.data());
+        if constexpr (sizeof(R) == 4) {
+            const __m256i bias = _mm256_set1_epi32(std::is_unsigned_v<R> ? INT32_MIN : 0);
+            const __m256i rhs =
+                _mm256_xor_si256(_mm256_set1_epi32(static_cast<std::int32_t>(key)), bias);
+            const __m256i lo =
+                _mm256_cmpgt_epi32(rhs, _mm256_xor_si256(_mm256_load_si256(p), bias));
+            const __m256i hi =
+                _mm256_cmpgt_epi32(rhs, _mm256_xor_si256(_mm256_load_si256(p + 1), bias));
+            const auto mask = static_cast<unsigned>(
+                _mm256_movemask_epi8(_mm256_packs_epi32(lo, hi)));
+            return static_cast<std::size_t>(std::popcount(mask)) / 2;
+        } else if constexpr (sizeof(R) == 8) {
+            const __m256i bias = _mm256_set1_epi64x(std::is_unsigned_v<R> ? INT64_MIN : 0);
+            const __m256i rhs =
+                _mm256_xor_si256(_mm256_set1_epi64x(static_cast<std::int64_t>(key)), bias);
+            const __m256i lo =
+                _mm256_cmpgt_epi64(rhs, _mm256_xor_si256(_mm256_load_si256(p), bias));
+            const __m256i hi =
+                _mm256_cmpgt_epi64(rhs, _mm256_xor_si256(_mm256_load_si256(p + 1), bias));
+            const auto mask = static_cast<unsigned>(
+                _mm256_movemask_epi8(_mm256_packs_epi32(lo, hi)));
+            return static_cast<std::size_t>(std::popcount(mask)) / 4;
+        } else {
+            return rank(node, key);
+        }
+        // NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast)
+    }
+
+    template <typename R>
+    STIPP_TARGET_AVX512 static std::size_t rank_avx512(const search_node<R>& node,
+                                                       R key) noexcept {
+        const __m512i keys = _mm512_load_si512(node.keys.data());
+        if constexpr (sizeof(R) == 4) {
+            const __m512i rhs = _mm512_set1_epi32(static_cast<std::int32_t>(key));
+            const auto mask = std::is_unsigned_v<R> ? _mm512_cmplt_epu32_mask(keys, rhs)
+                                                    : _mm512_cmplt_epi32_mask(keys, rhs);
+            return static_cast<std::size_t>(std::popcount(static_cast<unsigned>(mask)));
+        } else if constexpr (sizeof(R) == 8) {
+            const __m512i rhs = _mm512_set1_epi64(static_cast<std::int64_t>(key));
+            const auto mask = std::is_unsigned_v<R> ? _mm512_cmplt_epu64_mask(keys, rhs)
+                                                    : _mm512_cmplt_epi64_mask(keys, rhs);
+            return static_cast<std::size_t>(std::popcount(static_cast<unsigned>(mask)));
+        } else {
+            return rank_avx2(node, key);
+        }
+    }
+#endif
+
+    // Descends a batch of queries one layer at a time, prefetching the node each query
+    // visits next, so the cache misses of the whole batch overlap.
+    template <cpu_level Level, typename R>
+    STIPP_KERNEL static void search(search_layout<R> layout,
+                                    const R* queries,
+                                    std::size_t count,
+                                    std::size_t* out) noexcept {
+        constexpr std::size_t width = search_node<R>::width;
+        const auto node_rank = [](const search_node<R>& node, R key) {
+#if STIPP_X86_DISPATCH
+            if constexpr (Level == cpu_level::avx512) {
+                return rank_avx512(node, key);
+            } else if constexpr (Level == cpu_level::avx2) {
+                return rank_avx2(node, key);
+            } else {
+                return rank(node, key);
+            }
+#else
+            return rank(node, key);
+#endif
+        };
+        std::array<std::size_t, search_batch_size> index{};
+        for (std::size_t first = 0; first < count; first += search_batch_size) {
+            const std::size_t batch = (std::min)(search_batch_size, count - first);
+            index.fill(0);
+            for (std::size_t layer = layout.height - 1; layer > 0; --layer) {
+                const search_node<R>* nodes = layout.nodes + layout.layer_offsets[layer];
+                const search_node<R>* below =
+                    layout.nodes + layout.layer_offsets[layer - 1];
+                for (std::size_t q = 0; q < batch; ++q) {
+                    const std::size_t child =
+                        node_rank(nodes[index[q]], queries[first + q]);
+                    index[q] = index[q] * (width + 1) + child;
+                    prefetch(below + index[q]);
+                }
+            }
+            const search_node<R>* leaves = layout.nodes + layout.layer_offsets[0];
+            for (std::size_t q = 0; q < batch; ++q) {
+                const std::size_t pos =
+                    index[q] * width + node_rank(leaves[index[q]], queries[first + q]);
+                out[first + q] = (std::min)(pos, layout.size);
+            }
+        }
+    }
+
+    template <typename R>
+    STIPP_KERNEL void operator()(search_layout<R> layout,
+                                 const R* queries,
+                                 std::size_t count,
+                                 std::size_t* out) const noexcept {
+        search<cpu_level::baseline>(layout, queries, count, out);
+    }
+
+#if STIPP_X86_DISPATCH
+    template <typename R>
+    STIPP_TARGET_AVX2 void avx2(search_layout<R> layout,
+                                const R* queries,
+                                std::size_t count,
+                                std::size_t* out) const noexcept {
+        search<cpu_level::avx2>(layout, queries, count, out);
+    }
+
+    template <typename R>
+    STIPP_TARGET_AVX512 void avx512(search_layout<R> layout,
+                                    const R* queries,
+                                    std::size_t count,
+                                    std::size_t* out) const noexcept {
+        search<cpu_level::avx512>(layout, queries, count, out);
+    }
+#endif
+};
+
+} // namespace detail
+
+// Read-only index over sorted keys in a static B+ tree layout. Every node is one cache
+// line of keys, so a search takes one miss per layer instead of one per halving. The
+// leaves are the keys themselves in sorted order, padded to whole nodes, which is why
+// results come out as positions in the original span.
+template <stipp_int T>
+    requires std::is_enum_v<T>
+class static_search_index {
+    using repr_type = detail::repr_t<T>;
+    using node_type = detail::search_node<repr_type>;
+
+    static constexpr std::size_t width = node_type::width;
+
+  public:
+    using key_type = T;
+
+    static_search_index() = default;
+
+    explicit static_search_index(std::span<const T> sorted) : size_(sorted.size()) {
+        if (!std::is_sorted(sorted.begin(), sorted.end())) {
+            throw std::invalid_argument("static_search_index keys are not sorted");
+        }
+        const auto keys = as_repr_span(sorted);
+        constexpr repr_type padding = (std::numeric_limits<repr_type>::max)();
+
+        std::vector<std::size_t> layer_sizes{
+            (std::max)(ceil_div(size_, width), std::size_t{1})};
+        while (layer_sizes.back() > 1) {
+            layer_sizes.push_back(ceil_div(layer_sizes.back(), width + 1));
+        }
+        std::size_t total = 0;
+        for (const std::size_t layer_size : layer_sizes) {
+            layer_offsets_.push_back(total);
+            total += layer_size;
+        }
+        nodes_.resize(total);
+
+        for (std::size_t i = 0; i < layer_sizes[0] * width; ++i) {
+            nodes_[i / width].keys[i % width] = i < size_ ? keys[i] : padding;
+        }
+        // Key j of an internal node is the smallest key under child j + 1, which is the
+        // first key of that child's leftmost leaf.
+        std::size_t leaves_per_child = 1;
+        for (std::size_t layer = 1; layer < layer_sizes.size(); ++layer) {
+            for (std::size_t node = 0; node < layer_sizes[layer]; ++node) {
+                for (std::size_t j = 0; j < width; ++j) {
+                    const std::size_t child = node * (width + 1) + j + 1;
+                    const std::size_t first = child * leaves_per_child * width;
+                    nodes_[layer_offsets_[layer] + node].keys[j] =
+                        first < size_ ? keys[first] : padding;
+                }
+            }
+            leaves_per_child *= width + 1;
+        }
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept { return size_; }
+
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+
+    // Position of the first key not less than key, or size() if there is none.
+    [[nodiscard]] std::size_t lower_bound(T key) const noexcept {
+        std::size_t pos = 0;
+        if (size_ != 0) {
+            const repr_type query = detail::to_repr(key);
+            detail::dispatch(detail::search_index_kernel{}, layout(), &query,
+                             std::size_t{1}, &pos);
+        }
+        return pos;
+    }
+
+    [[nodiscard]] bool contains(T key) const noexcept {
+        const std::size_t pos = lower_bound(key);
+        return pos < size_ &&
+               nodes_[pos / width].keys[pos % width] == detail::to_repr(key);
+    }
+
+    void lower_bound_n(std::span<const T> keys, std::span<std::size_t> out) const {
+        detail::check_output_size(keys.size(), out.size(),
+                                  "lower_bound_n output span is smaller than its input");
+        if (size_ == 0) {
+            std::fill_n(out.begin(), keys.size(), std::size_t{0});
+            return;
+        }
+        detail::dispatch(detail::search_index_kernel{}, layout(), as_repr_span(keys).data(),
+                         keys.size(), out.data());
+    }
+
+  private:
+    static constexpr std::size_t ceil_div(std::size_t lhs, std::size_t rhs) noexcept {
+        return (lhs + rhs - 1) / rhs;
+    }
+
+    [[nodiscard]] detail::search_layout<repr_type> layout() const noexcept {
+        return {nodes_.data(), layer_offsets_.data(), layer_offsets_.size(), size_};
+    }
+
+    std::vector<node_type> nodes_;
+    std::vector<std::size_t> layer_offsets_;
+    std::size_t size_ = 0;
+};
+
+namespace detail {
+
+// Beyond this size ratio, searching the larger set for each element of the smaller one
+// beats a merge that reads every element of both.
+inline constexpr std::size_t set_gallop_ratio = 32;
+
+// Lower bound of value in data[first, size), found by doubling the step from first and
+// then bisecting the last step. Costs O(log d) for a match d elements ahead.
+template <typename R>
+constexpr std::size_t gallop(const R* data, std::size_t first, std::size_t size, R value) {
+    std::size_t step = 1;
+    std::size_t low = first;
+    while (low + step < size && data[low + step] < value) {
+        low += step;
+        step *= 2;
+    }
+    if (low < size && !(data[low] < value)) {
+        return low;
+    }
+    const R* end = data + (std::min)(low + step, size);
+    return static_cast<std::size_t>(std::lower_bound(data + low, end, value) - data);
+}
+
+// Keeps the elements of a that are (Present) or are not (!Present) in b, writing them to
+// out unless it is null. Both inputs are strictly increasing.
+template <bool Present>
+struct set_filter_kernel {
+    // Bit k of pending marks a[i + k] as already found in an earlier block of b.
+    template <typename R>
+    STIPP_KERNEL static std::size_t scan(const R* a,
+                                         std::size_t i,
+                                         std::size_t na,
+                                         const R* b,
+                                         std::size_t j,
+                                         std::size_t nb,
+                                         R* out,
+                                         std::size_t count,
+                                         std::uint32_t pending) noexcept {
+        for (; i < na; ++i, pending >>= 1) {
+            const R x = a[i];
+            while (j < nb && b[j] < x) {
+                ++j;
+            }
+            const bool found = (pending & 1U) != 0 || (j < nb && b[j] == x);
+            if (found == Present) {
+                if (out != nullptr) {
+                    out[count] = x;
+                }
+                ++count;
+            }
+        }
+        return count;
+    }
+
+    template <typename R>
+    STIPP_KERNEL std::size_t operator()(const R* a,
+                                        std::size_t na,
+                                        const R* b,
+                                        std::size_t nb,
+                                        R* out,
+                                        std::size_t capacity) const noexcept {
+        static_cast<void>(capacity);
+        return scan(a, 0, na, b, 0, nb, out, 0, 0);
+    }
+
+#if STIPP_X86_DISPATCH
+    // Compares a block of a with every rotation of a block of b, so each lane of a meets
+    // each lane of b once. The block with the smaller last element is done and moves on.
+    // The matches of the current block of a add up until it moves on.
+    template <typename R>
+    STIPP_TARGET_AVX2 std::size_t avx2(const R* a,
+                                       std::size_t na,
+                                       const R* b,
+                                       std::size_t nb,
+                                       R* out,
+                                       std::size_t capacity) const noexcept {
+        if constexpr (sizeof(R) != 4 && sizeof(R) != 8) {
+            return scan(a, 0, na, b, 0, nb, out, 0, 0);
+        } else {
+            constexpr std::size_t lanes = 32 / sizeof(R);
+            constexpr std::uint32_t all = (1U << lanes) - 1;
+            const __m256i rotate = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
+            std::size_t i = 0;
+            std::size_t j = 0;
+            std::size_t count = 0;
+            std::uint32_t pending = 0;
+            while (i + lanes <= na && j + lanes <= nb) {
+                // NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast)
+                const __m256i va =
+                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+                __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + j));
+                // NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast)
+                __m256i match = _mm256_setzero_si256();
+                for (std::size_t r = 0; r < lanes; ++r) {
+                    if constexpr (sizeof(R) == 4) {
+                        match = _mm256_or_si256(match, _mm256_cmpeq_epi32(va, vb));
+                        vb = _mm256_permutevar8x32_epi32(vb, rotate);
+                    } else {
+                        match = _mm256_or_si256(match, _mm256_cmpeq_epi64(va, vb));
+                        vb = _mm256_permute4x64_epi64(vb, 0x39);
+                    }
+                }
+                if constexpr (sizeof(R) == 4) {
+                    pending |= static_cast<std::uint32_t>(
+                        _mm256_movemask_ps(_mm256_castsi256_ps(match)));
+                } else {
+                    pending |= static_cast<std::uint32_t>(
+                        _mm256_movemask_pd(_mm256_castsi256_pd(match)));
+                }
+                const R a_last = a[i + lanes - 1];
+                const R b_last = b[j + lanes - 1];
+                if (!(a_last < b_last)) {
+                    j += lanes;
+                }
+                if (!(b_last < a_last)) {
+                    const std::uint32_t keep = Present ? pending : ~pending & all;
+                    count = emit(va, a + i, keep, out, count, capacity);
+                    i += lanes;
+                    pending = 0;
+                }
+            }
+            return scan(a, i, na, b, j, nb, out, count, pending);
+        }
+    }
+
+    // Writes the lanes of block selected by keep, packed to the front.
+    template <typename R>
+    STIPP_TARGET_AVX2 static std::size_t emit(__m256i block,
+                                              const R* src,
+                                              std::uint32_t keep,
+                                              R* out,
+                                              std::size_t count,
+                                              std::size_t capacity) noexcept {
+        const auto kept = static_cast<std::size_t>(std::popcount(keep));
+        if (out == nullptr) {
+            return count + kept;
+        }
+        if constexpr (sizeof(R) == 4) {
+            const __m256i positions = _mm256_cvtepu8_epi32(
+                _mm_cvtsi64_si128(static_cast<long long>(select_positions[keep])));
+            const __m256i packed = _mm256_permutevar8x32_epi32(block, positions);
+            // A full store may run past the end of out, which then takes a copy.
+            if (count + 8 <= capacity) {
+                // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + count), packed);
+            } else {
+                std::array<R, 8> lanes;
+                // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes.data()), packed);
+                std::copy_n(lanes.begin(), kept, out + count);
+            }
+        } else {
+            std::size_t pos = count;
+            for (std::uint32_t bits = keep; bits != 0; bits &= bits - 1) {
+                out[pos++] = src[std::countr_zero(bits)];
+            }
+        }
+        return count + kept;
+    }
+
+    template <typename R>
+    STIPP_TARGET_AVX512 std::size_t avx512(const R* a,
+                                           std::size_t na,
+                                           const R* b,
+                                           std::size_t nb,
+                                           R* out,
+                                           std::size_t capacity) const noexcept {
+        return avx2(a, na, b, nb, out, capacity);
+    }
+#endif
+};
+
+template <bool Present, typename R>
+std::size_t set_filter(std::span<const R> a,
+                       std::span<const R> b,
+                       R* out,
+                       std::size_t capacity) {
+    std::size_t count = 0;
+    const auto keep = [&](R x) {
+        if (out != nullptr) {
+            out[count] = x;
+        }
+        ++count;
+    };
+    if (b.size() >= set_gallop_ratio * a.size()) {
+        std::size_t j = 0;
+        for (const R x : a) {
+            j = gallop(b.data(), j, b.size(), x);
+            if ((j < b.size() && b[j] == x) == Present) {
+                keep(x);
+            }
+        }
+    } else if (a.size() >= set_gallop_ratio * b.size()) {
+        std::size_t i = 0;
+        for (const R y : b) {
+            const std::size_t found = gallop(a.data(), i, a.size(), y);
+            const bool match = found < a.size() && a[found] == y;
+            if constexpr (Present) {
+                if (match) {
+                    keep(y);
+                }
+            } else {
+                for (; i < found; ++i) {
+                    keep(a[i]);
+                }
+            }
+            i = found + (match ? 1 : 0);
+        }
+        if constexpr (!Present) {
+            for (; i < a.size(); ++i) {
+                keep(a[i]);
+            }
+        }
+    } else {
+        count = dispatch(set_filter_kernel<Present>{}, a.data(), a.size(), b.data(),
+                         b.size(), out, capacity);
+    }
+    return count;
+}
+
+// Below this size ratio, the inputs interleave too finely for a branch predictor, and the
+// union merge is branchless.
+inline constexpr std::size_t set_branchless_ratio = 4;
+
+// Merges two strictly increasing inputs into their union, writing each shared element
+// once. Very skewed inputs copy the runs of the larger input between the elements of the
+// smaller one.
+template <typename R>
+std::size_t set_merge(std::span<const R> a, std::span<const R> b, R* out) {
+    if (a.size() < b.size()) {
+        std::swap(a, b);
+    }
+    if (a.size() >= set_branchless_ratio * b.size() &&
+        a.size() < set_gallop_ratio * b.size()) {
+        return static_cast<std::size_t>(
+            std::set_union(a.begin(), a.end(), b.begin(), b.end(), out) - out);
+    }
+    std::size_t i = 0;
+    std::size_t count = 0;
+    if (a.size() >= set_gallop_ratio * b.size()) {
+        for (const R y : b) {
+            const std::size_t found = gallop(a.data(), i, a.size(), y);
+            out = std::copy(a.data() + i, a.data() + found, out);
+            *out++ = y;
+            count += found - i + 1;
+            i = found + (found < a.size() && a[found] == y ? 1 : 0);
+        }
+    } else {
+        std::size_t j = 0;
+        while (i < a.size() && j < b.size()) {
+            const R x = a[i];
+            const R y = b[j];
+            out[count++] = y < x ? y : x;
+            i += static_cast<std::size_t>(!(y < x));
+            j += static_cast<std::size_t>(!(x < y));
+        }
+        out = std::copy(b.data() + j, b.data() + b.size(), out + count);
+        count += b.size() - j;
+    }
+    std::copy(a.data() + i, a.data() + a.size(), out);
+    return count + a.size() - i;
+}
+
+} // namespace detail
+
+// The set operations take strictly increasing spans, such as posting lists, and write a
+// strictly increasing result. Each returns the number of elements written, and throws
+// std::length_error if out could be too small for the worst case.
+template <stipp_int T>
+    requires std::is_enum_v<T>
+std::size_t set_intersect(std::span<const T> lhs,
+                          std::span<const T> rhs,
+                          std::span<T> out) {
+    detail::check_output_size((std::min)(lhs.size(), rhs.size()), out.size(),
+                              "set_intersect output span is smaller than an input");
+    return detail::set_filter<true>(as_repr_span(lhs), as_repr_span(rhs),
+                                    as_repr_span(out).data(), out.size());
+}
+
+template <stipp_int T>
+    requires std::is_enum_v<T>
+std::size_t set_intersect_count(std::span<const T> lhs, std::span<const T> rhs) {
+    return detail::set_filter<true, detail::repr_t<T>>(as_repr_span(lhs), as_repr_span(rhs),
+                                                       nullptr, 0);
+}
+
+template <stipp_int T>
+    requires std::is_enum_v<T>
+std::size_t set_difference(std::span<const T> lhs,
+                           std::span<const T> rhs,
+                           std::span<T> out) {
+    detail::check_output_size(lhs.size(), out.size(),
+                              "set_difference output span is smaller than its first input");
+    return detail::set_filter<false>(as_repr_span(lhs), as_repr_span(rhs),
+                                     as_repr_span(out).data(), out.size());
+}
+
+template <stipp_int T>
+    requires std::is_enum_v<T>
+std::size_t set_difference_count(std::span<const T> lhs, std::span<const T> rhs) {
+    return lhs.size() - set_intersect_count(lhs, rhs);
+}
+
+template <stipp_int T>
+    requires std::is_enum_v<T>
+std::size_t set_union(std::span<const T> lhs, std::span<const T> rhs, std::span<T> out) {
+    detail::check_output_size(lhs.size() + rhs.size(), out.size(),
+                              "set_union output span is smaller than its inputs combined");
+    return detail::set_merge(as_repr_span(lhs), as_repr_span(rhs),
+                             as_repr_span(out).data());
+}
+
+template <stipp_int T>
+    requires std::is_enum_v<T>
+std::size_t set_union_count(std::span<const T> lhs, std::span<const T> rhs) {
+    return lhs.size() + rhs.size() - set_intersect_count(lhs, rhs);
+}
+
+template <stipp_int T>
+    requires std::same_as<T, u32> || std::same_as<T, u64>
+class roaring;
+
+template <stipp_int T>
+    requires std::same_as<T, u32> || std::same_as<T, u64>
+class roaring_view;
+
+namespace detail {
+
+template <typename S>
+inline constexpr bool is_roaring_v = false;
+
+template <stipp_int T>
+    requires std::same_as<T, u32> || std::same_as<T, u64>
+inline constexpr bool is_roaring_v<roaring<T>> = true;
+
+template <stipp_int T>
+    requires std::same_as<T, u32> || std::same_as<T, u64>
+inline constexpr bool is_roaring_v<roaring_view<T>> = true;
+
+template <typename Lhs, typename Rhs>
+concept roaring_operands = is_roaring_v<Lhs> && is_roaring_v<Rhs> &&
+                           std::same_as<typename Lhs::value_type, typename Rhs::value_type>;
+
+// A container holds the low 16 bits of the values that share their high bits. It is a
+// sorted array up to 4096 values and a bitmap of 8 KiB above that. Runs of (start,
+// length - 1) pairs replace either when they are smaller, after add_range or run_optimize.
+enum class roaring_kind : std::uint8_t { array, bitmap, run };
+
+enum class roaring_op : std::uint8_t { intersect, merge, subtract };
+
+inline constexpr std::size_t roaring_words = 1024;
+inline constexpr std::uint32_t roaring_array_max = 4096;
+inline constexpr std::uint32_t roaring_span = 65536;
+
+using roaring_bitmap = std::array<std::uint64_t, roaring_words>;
+
+// Read-only container in a roaring or a serialized buffer. size counts the values of an
+// array and the runs of a run container.
+struct roaring_ref {
+    roaring_kind kind = roaring_kind::array;
+    std::uint32_t size = 0;
+    std::uint32_t cardinality = 0;
+    const std::uint16_t* halves = nullptr;
+    const std::uint64_t* words = nullptr;
+};
+
+struct roaring_container {
+    roaring_kind kind = roaring_kind::array;
+    std::uint32_t cardinality = 0;
+    std::vector<std::uint16_t> halves;
+    std::vector<std::uint64_t> words;
+
+    [[nodiscard]] roaring_ref ref() const noexcept {
+        const std::size_t size =
+            kind == roaring_kind::run ? halves.size() / 2 : halves.size();
+        return {kind, static_cast<std::uint32_t>(size), cardinality, halves.data(),
+                words.data()};
+    }
+};
+
+constexpr bool roaring_apply(roaring_op op, bool lhs, bool rhs) noexcept {
+    switch (op) {
+        case roaring_op::intersect:
+            return lhs && rhs;
+        case roaring_op::merge:
+            return lhs || rhs;
+        case roaring_op::subtract:
+            break;
+    }
+    return lhs && !rhs;
+}
+
+// The number of runs that start at or before low.
+inline std::size_t roaring_runs_before(const std::uint16_t* runs,
+                                       std::size_t count,
+                                       std::uint16_t low) noexcept {
+    std::size_t first = 0;
+    while (count > 0) {
+        const std::size_t half = count / 2;
+        if (runs[2 * (first + half)] <= low) {
+            first += half + 1;
+            count -= half + 1;
+        } else {
+            count = half;
+        }
+    }
+    return first;
+}
+
+inline bool roaring_contains(const roaring_ref& c, std::uint16_t low) noexcept {
+    switch (c.kind) {
+        case roaring_kind::array:
+            return std::binary_search(c.halves, c.halves + c.size, low);
+        case roaring_kind::bitmap:
+            return ((c.words[low / 64] >> (low % 64)) & 1U) != 0;
+        case roaring_kind::run:
+            break;
+    }
+    // Only the last run that starts at or before low can hold it.
+    const std::size_t before = roaring_runs_before(c.halves, c.size, low);
+    return before > 0 && low - c.halves[2 * before - 2] <= c.halves[2 * before - 1];
+}
+
+// Sets bits first to last, inclusive.
+inline void roaring_set_range(std::uint64_t* words,
+                              std::uint32_t first,
+                              std::uint32_t last) noexcept {
+    const std::uint32_t first_word = first / 64;
+    const std::uint32_t last_word = last / 64;
+    const std::uint64_t first_mask = ~std::uint64_t{0} << (first % 64);
+    const std::uint64_t last_mask = ~std::uint64_t{0} >> (63 - last % 64);
+    if (first_word == last_word) {
+        words[first_word] |= first_mask & last_mask;
+        return;
+    }
+    words[first_word] |= first_mask;
+    std::fill(words + first_word + 1, words + last_word, ~std::uint64_t{0});
+    words[last_word] |= last_mask;
+}
+
+inline void roaring_fill(const roaring_ref& c, std::uint64_t* words) noexcept {
+    if (c.kind == roaring_kind::bitmap) {
+        std::copy_n(c.words, roaring_words, words);
+        return;
+    }
+    std::fill_n(words, roaring_words, std::uint64_t{0});
+    if (c.kind == roaring_kind::array) {
+        for (std::uint32_t i = 0; i < c.size; ++i) {
+            words[c.halves[i] / 64] |= std::uint64_t{1} << (c.halves[i] % 64);
+        }
+    } else {
+        for (std::uint32_t i = 0; i < c.size; ++i) {
+            const std::uint32_t start = c.halves[2 * i];
+            roaring_set_range(words, start, start + c.halves[2 * i + 1]);
+        }
+    }
+}
+
+inline roaring_container roaring_to_bitmap(const roaring_ref& c) {
+    roaring_container out;
+    out.kind = roaring_kind::bitmap;
+    out.cardinality = c.cardinality;
+    out.words.resize(roaring_words);
+    roaring_fill(c, out.words.data());
+    return out;
+}
+
+// Room that decoding a bitmap needs past its last value.
+inline constexpr std::size_t roaring_decode_slack = 64;
+
+// Writes base plus the position of each set bit of words[*pos, 1024) to out, a word at a
+// time while out has roaring_decode_slack entries left, and returns how many it wrote.
+// Each word writes its first 4 and then 8 positions whether or not they are set bits,
+// so that sparse words take no mispredicted branches; extra writes land past the end.
+struct roaring_decode_kernel {
+    template <typename Out>
+    STIPP_KERNEL static void decode(std::uint64_t& bits,
+                                    std::uint64_t base,
+                                    Out* out,
+                                    std::size_t first,
+                                    std::size_t last) noexcept {
+        for (std::size_t i = first; i < last; ++i) {
+            out[i] = static_cast<Out>(base + static_cast<unsigned>(std::countr_zero(bits)));
+            bits &= bits - 1;
+        }
+    }
+
+    template <typename Out>
+    STIPP_KERNEL std::size_t operator()(const std::uint64_t* words,
+                                        std::size_t* pos,
+                                        std::uint64_t base,
+                                        Out* out,
+                                        std::size_t capacity) const noexcept {
+        std::size_t count = 0;
+        std::size_t w = *pos;
+        for (; w < roaring_words && count + roaring_decode_slack <= capacity; ++w) {
+            std::uint64_t bits = words[w];
+            const auto set = static_cast<std::size_t>(std::popcount(bits));
+            Out* const dst = out + count;
+            decode(bits, base + w * 64, dst, 0, 4);
+            if (set > 4) {
+                decode(bits, base + w * 64, dst, 4, (std::max)(set, std::size_t{8}));
+            }
+            count += set;
+        }
+        *pos = w;
+        return count;
+    }
+};
+
+// The container for a bitmap with the given number of set bits: an array if it is small
+// enough, otherwise the bitmap itself.
+inline roaring_container roaring_from_words(std::vector<std::uint64_t> words,
+                                            std::uint32_t cardinality) {
+    roaring_container out;
+    out.cardinality = cardinality;
+    if (cardinality > roaring_array_max) {
+        out.kind = roaring_kind::bitmap;
+        out.words = std::move(words);
+        return out;
+    }
+    out.halves.resize(cardinality + roaring_decode_slack);
+    std::size_t pos = 0;
+    dispatch(roaring_decode_kernel{}, words.data(), &pos, std::uint64_t{0},
+             out.halves.data(), out.halves.size());
+    out.halves.resize(cardinality);
+    return out;
+}
+
+inline roaring_container roaring_from_array(std::vector<std::uint16_t> values) {
+    const auto cardinality = static_cast<std::uint32_t>(values.size());
+    if (cardinality > roaring_array_max) {
+        return roaring_to_bitmap(
+            {roaring_kind::array, cardinality, cardinality, values.data(), nullptr});
+    }
+    roaring_container out;
+    out.cardinality = cardinality;
+    out.halves = std::move(values);
+    return out;
+}
+
+// The smallest container for the values covered by runs.
+inline roaring_container roaring_from_runs(std::vector<std::uint16_t> runs) {
+    std::uint32_t cardinality = 0;
+    for (std::size_t i = 1; i < runs.size(); i += 2) {
+        cardinality += runs[i] + 1U;
+    }
+    const std::size_t other_bytes = cardinality > roaring_array_max
+                                        ? roaring_words * sizeof(std::uint64_t)
+                                        : cardinality * sizeof(std::uint16_t);
+    const roaring_ref ref{roaring_kind::run, static_cast<std::uint32_t>(runs.size() / 2),
+                          cardinality, runs.data(), nullptr};
+    if (runs.size() * sizeof(std::uint16_t) < other_bytes) {
+        roaring_container out;
+        out.kind = roaring_kind::run;
+        out.cardinality = cardinality;
+        out.halves = std::move(runs);
+        return out;
+    }
+    roaring_container bitmap = roaring_to_bitmap(ref);
+    return roaring_from_words(std::move(bitmap.words), cardinality);
+}
+
+inline roaring_container roaring_copy(const roaring_ref& c) {
+    roaring_container out;
+    out.kind = c.kind;
+    out.cardinality = c.cardinality;
+    if (c.kind == roaring_kind::bitmap) {
+        out.words.assign(c.words, c.words + roaring_words);
+    } else {
+        const std::size_t size = c.kind == roaring_kind::run ? 2 * c.size : c.size;
+        out.halves.assign(c.halves, c.halves + size);
+    }
+    return out;
+}
+
+inline std::size_t roaring_run_count(const roaring_ref& c) noexcept {
+    std::size_t runs = 0;
+    switch (c.kind) {
+        case roaring_kind::array:
+            for (std::uint32_t i = 0; i < c.size; ++i) {
+                const bool gap = i == 0 || c.halves[i] != c.halves[i - 1] + 1;
+                runs += static_cast<std::size_t>(gap);
+            }
+            break;
+        case roaring_kind::bitmap: {
+            // A run starts at each set bit whose lower neighbour is clear.
+            std::uint64_t carry = 0;
+            for (std::size_t w = 0; w < roaring_words; ++w) {
+                const std::uint64_t bits = c.words[w];
+                const std::uint64_t starts = bits & ~((bits << 1) | carry);
+                runs += static_cast<std::size_t>(std::popcount(starts));
+                carry = bits >> 63;
+            }
+            break;
+        }
+        case roaring_kind::run:
+            runs = c.size;
+            break;
+    }
+    return runs;
+}
+
+inline std::vector<std::uint16_t> roaring_runs(const roaring_ref& c) {
+    std::vector<std::uint16_t> runs;
+    const auto push = [&](std::uint32_t first, std::uint32_t last) {
+        runs.push_back(static_cast<std::uint16_t>(first));
+        runs.push_back(static_cast<std::uint16_t>(last - first));
+    };
+    if (c.kind == roaring_kind::run) {
+        runs.assign(c.halves, c.halves + 2 * c.size);
+    } else if (c.kind == roaring_kind::array) {
+        for (std::uint32_t i = 0; i < c.size;) {
+            std::uint32_t j = i + 1;
+            while (j < c.size && c.halves[j] == c.halves[j - 1] + 1) {
+                ++j;
+            }
+            push(c.halves[i], c.halves[j - 1]);
+            i = j;
+        }
+    } else {
+        // Filling the bits below the start of a run makes its end the lowest clear bit.
+        constexpr std::uint64_t full = ~std::uint64_t{0};
+        std::size_t w = 0;
+        std::uint64_t bits = c.words[0];
+        while (true) {
+            while (bits == 0 && w + 1 < roaring_words) {
+                bits = c.words[++w];
+            }
+            if (bits == 0) {
+                break;
+            }
+            const auto start = static_cast<unsigned>(std::countr_zero(bits));
+            const auto first = static_cast<std::uint32_t>(w * 64 + start);
+            bits |= bits - 1;
+            while (bits == full && w + 1 < roaring_words) {
+                bits = c.words[++w];
+            }
+            if (bits == full) {
+                push(first, roaring_span - 1);
+                break;
+            }
+            const auto end = static_cast<unsigned>(std::countr_zero(~bits));
+            push(first, static_cast<std::uint32_t>(w * 64 + end) - 1);
+            bits &= bits + 1;
+        }
+    }
+    return runs;
+}
+
+inline void roaring_optimize(roaring_container& c) {
+    if (c.kind == roaring_kind::run) {
+        return;
+    }
+    const std::size_t bytes = c.kind == roaring_kind::array
+                                  ? c.halves.size() * sizeof(std::uint16_t)
+                                  : roaring_words * sizeof(std::uint64_t);
+    if (roaring_run_count(c.ref()) * 2 * sizeof(std::uint16_t) < bytes) {
+        c = roaring_from_runs(roaring_runs(c.ref()));
+    }
+}
+
+// Combines two run containers by walking the boundaries where a run of either starts or
+// ends. Boundary 2k is the start of run k, and 2k + 1 is one past its end.
+inline std::vector<std::uint16_t> roaring_sweep(roaring_op op,
+                                                const roaring_ref& lhs,
+                                                const roaring_ref& rhs) {
+    const auto boundary = [](const roaring_ref& c, std::size_t k) -> std::uint32_t {
+        if (k == 2 * c.size) {
+            return roaring_span + 1;
+        }
+        const std::uint32_t start = c.halves[k & ~std::size_t{1}];
+        return k % 2 == 0 ? start : start + c.halves[k] + 1;
+    };
+    std::vector<std::uint16_t> runs;
+    std::size_t i = 0;
+    std::size_t j = 0;
+    std::uint32_t first = 0;
+    bool inside = false;
+    while (i < 2 * lhs.size || j < 2 * rhs.size) {
+        const std::uint32_t lhs_pos = boundary(lhs, i);
+        const std::uint32_t rhs_pos = boundary(rhs, j);
+        const std::uint32_t pos = (std::min)(lhs_pos, rhs_pos);
+        i += lhs_pos == pos ? 1 : 0;
+        j += rhs_pos == pos ? 1 : 0;
+        const bool now = roaring_apply(op, i % 2 == 1, j % 2 == 1);
+        if (now == inside) {
+            continue;
+        }
+        inside = now;
+        if (!now) {
+            runs.push_back(static_cast<std::uint16_t>(first));
+            runs.push_back(static_cast<std::uint16_t>(pos - 1 - first));
+        } else if (!runs.empty() && runs[runs.size() - 2] + runs.back() + 1U == pos) {
+            // Adjacent runs, such as the two halves of a range split by the inputs.
+            first = runs[runs.size() - 2];
+            runs.resize(runs.size() - 2);
+        } else {
+            first = pos;
+        }
+    }
+    return runs;
+}
+
+// Combines two bitmaps word by word into out, unless it is null, and returns the number
+// of set bits in the result.
+template <roaring_op Op>
+struct roaring_bitmap_kernel {
+    STIPP_KERNEL std::uint32_t operator()(const std::uint64_t* lhs,
+                                          const std::uint64_t* rhs,
+                                          std::uint64_t* out) const noexcept {
+        std::uint32_t count = 0;
+        for (std::size_t i = 0; i < roaring_words; ++i) {
+            std::uint64_t word = lhs[i] & rhs[i];
+            if constexpr (Op == roaring_op::merge) {
+                word = lhs[i] | rhs[i];
+            } else if constexpr (Op == roaring_op::subtract) {
+                word = lhs[i] & ~rhs[i];
+            }
+            if (out != nullptr) {
+                out[i] = word;
+            }
+            count += static_cast<std::uint32_t>(std::popcount(word));
+        }
+        return count;
+    }
+
+#if STIPP_X86_DISPATCH
+    // Counts the bits of each nibble with a byte shuffle and sums the bytes of each lane
+    // with a sum of absolute differences, which outruns one popcnt per word.
+    STIPP_TARGET_AVX2 std::uint32_t avx2(const std::uint64_t* lhs,
+                                         const std::uint64_t* rhs,
+                                         std::uint64_t* out) const noexcept {
+        const __m256i table = _mm256_broadcastsi128_si256(
+            _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4));
+        const __m256i nibble = _mm256_set1_epi8(0x0f);
+        __m256i total = _mm256_setzero_si256();
+        for (std::size_t i = 0; i < roaring_words; i += 4) {
+            // NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast)
+            const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lhs + i));
+            const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rhs + i));
+            __m256i word = _mm256_and_si256(x, y);
+            if constexpr (Op == roaring_op::merge) {
+                word = _mm256_or_si256(x, y);
+            } else if constexpr (Op == roaring_op::subtract) {
+                word = _mm256_andnot_si256(y, x);
+            }
+            if (out != nullptr) {
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), word);
+            }
+            // NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast)
+            const __m256i low = _mm256_shuffle_epi8(table, _mm256_and_si256(word, nibble));
+            const __m256i high = _mm256_shuffle_epi8(
+                table, _mm256_and_si256(_mm256_srli_epi16(word, 4), nibble));
+            total = _mm256_add_epi64(total, _mm256_sad_epu8(_mm256_add_epi8(low, high),
+                                                            _mm256_setzero_si256()));
+        }
+        const __m128i sum = _mm_add_epi64(_mm256_castsi256_si128(total),
+                                          _mm256_extracti128_si256(total, 1));
+        return static_cast<std::uint32_t>(_mm_cvtsi128_si64(sum) +
+                                          _mm_extract_epi64(sum, 1));
+    }
+
+    // Bitmaps are small enough that wider vectors gain nothing over AVX2.
+    STIPP_TARGET_AVX512 std::uint32_t avx512(const std::uint64_t* lhs,
+                                             const std::uint64_t* rhs,
+                                             std::uint64_t* out) const noexcept {
+        return avx2(lhs, rhs, out);
+    }
+#endif
+};
+
+inline std::uint32_t roaring_bitmap_op(roaring_op op,
+                                       const std::uint64_t* lhs,
+                                       const std::uint64_t* rhs,
+                                       std::uint64_t* out) noexcept {
+    switch (op) {
+        case roaring_op::intersect:
+            return dispatch(roaring_bitmap_kernel<roaring_op::intersect>{}, lhs, rhs, out);
+        case roaring_op::merge:
+            return dispatch(roaring_bitmap_kernel<roaring_op::merge>{}, lhs, rhs, out);
+        case roaring_op::subtract:
+            break;
+    }
+    return dispatch(roaring_bitmap_kernel<roaring_op::subtract>{}, lhs, rhs, out);
+}
+
+// The words of c, in scratch unless c is a bitmap already.
+inline const std::uint64_t* roaring_words_of(const roaring_ref& c,
+                                             roaring_bitmap& scratch) noexcept {
+    if (c.kind == roaring_kind::bitmap) {
+        return c.words;
+    }
+    roaring_fill(c, scratch.data());
+    return scratch.data();
+}
+
+// Combines two containers with the same key. The result may be empty.
+inline roaring_container roaring_combine(roaring_op op,
+                                         const roaring_ref& lhs,
+                                         const roaring_ref& rhs) {
+    const bool lhs_full = lhs.cardinality == roaring_span;
+    const bool rhs_full = rhs.cardinality == roaring_span;
+    if (op == roaring_op::merge && (lhs_full || rhs_full)) {
+        return roaring_copy(lhs_full ? lhs : rhs);
+    }
+    if (op == roaring_op::intersect && (lhs_full || rhs_full)) {
+        return roaring_copy(lhs_full ? rhs : lhs);
+    }
+    if (op == roaring_op::subtract && rhs_full) {
+        return {};
+    }
+    if (lhs.kind == roaring_kind::array && rhs.kind == roaring_kind::array) {
+        const std::span<const std::uint16_t> a(lhs.halves, lhs.size);
+        const std::span<const std::uint16_t> b(rhs.halves, rhs.size);
+        std::vector<std::uint16_t> out(op == roaring_op::merge ? a.size() + b.size()
+                                                               : a.size());
+        std::size_t count = 0;
+        switch (op) {
+            case roaring_op::intersect:
+                count = set_filter<true>(a, b, out.data(), out.size());
+                break;
+            case roaring_op::merge:
+                count = set_merge(a, b, out.data());
+                break;
+            case roaring_op::subtract:
+                count = set_filter<false>(a, b, out.data(), out.size());
+                break;
+        }
+        out.resize(count);
+        return roaring_from_array(std::move(out));
+    }
+    if (lhs.kind == roaring_kind::run && rhs.kind == roaring_kind::run) {
+        return roaring_from_runs(roaring_sweep(op, lhs, rhs));
+    }
+    // An array keeps the values found, or not found, in the other container.
+    if (op != roaring_op::merge &&
+        (lhs.kind == roaring_kind::array ||
+         (op == roaring_op::intersect && rhs.kind == roaring_kind::array))) {
+        const bool swap = lhs.kind != roaring_kind::array;
+        const roaring_ref& values = swap ? rhs : lhs;
+        const roaring_ref& other = swap ? lhs : rhs;
+        std::vector<std::uint16_t> out;
+        out.reserve(values.size);
+        for (std::uint32_t i = 0; i < values.size; ++i) {
+            const bool found = roaring_contains(other, values.halves[i]);
+            if (found == (op == roaring_op::intersect)) {
+                out.push_back(values.halves[i]);
+            }
+        }
+        return roaring_from_array(std::move(out));
+    }
+    roaring_bitmap lhs_scratch;
+    roaring_bitmap rhs_scratch;
+    std::vector<std::uint64_t> words(roaring_words);
+    const std::uint32_t cardinality =
+        roaring_bitmap_op(op, roaring_words_of(lhs, lhs_scratch),
+                          roaring_words_of(rhs, rhs_scratch), words.data());
+    return roaring_from_words(std::move(words), cardinality);
+}
+
+inline std::size_t roaring_intersect_count(const roaring_ref& lhs, const roaring_ref& rhs) {
+    if (lhs.kind == roaring_kind::array && rhs.kind == roaring_kind::array) {
+        return set_filter<true, std::uint16_t>({lhs.halves, lhs.size},
+                                               {rhs.halves, rhs.size}, nullptr, 0);
+    }
+    if (lhs.kind == roaring_kind::array || rhs.kind == roaring_kind::array) {
+        const bool swap = lhs.kind != roaring_kind::array;
+        const roaring_ref& values = swap ? rhs : lhs;
+        const roaring_ref& other = swap ? lhs : rhs;
+        std::size_t count = 0;
+        for (std::uint32_t i = 0; i < values.size; ++i) {
+            count += static_cast<std::size_t>(roaring_contains(other, values.halves[i]));
+        }
+        return count;
+    }
+    if (lhs.kind == roaring_kind::run && rhs.kind == roaring_kind::run) {
+        const std::vector<std::uint16_t> runs =
+            roaring_sweep(roaring_op::intersect, lhs, rhs);
+        std::size_t count = runs.size() / 2;
+        for (std::size_t i = 1; i < runs.size(); i += 2) {
+            count += runs[i];
+        }
+        return count;
+    }
+    roaring_bitmap lhs_scratch;
+    roaring_bitmap rhs_scratch;
+    return roaring_bitmap_op(roaring_op::intersect, roaring_words_of(lhs, lhs_scratch),
+                             roaring_words_of(rhs, rhs_scratch), nullptr);
+}
+
+// Adds or removes low in a run container by growing, shrinking, joining or splitting
+// runs, then keeps the smallest form. Returns whether the container changed.
+inline bool roaring_update_runs(roaring_container& c, std::uint16_t low, bool add) {
+    std::vector<std::uint16_t>& runs = c.halves;
+    const std::size_t next = roaring_runs_before(runs.data(), runs.size() / 2, low);
+    const std::size_t prev = 2 * next - 2;
+    const std::uint32_t value = low;
+    const bool inside = next > 0 && value - runs[prev] <= runs[prev + 1];
+    if (inside == add) {
+        return false;
+    }
+    const auto half = [](std::uint32_t x) { return static_cast<std::uint16_t>(x); };
+    const auto at = [&](std::size_t i) {
+        return runs.begin() + static_cast<std::ptrdiff_t>(i);
+    };
+    if (add) {
+        const bool joins_prev = next > 0 && runs[prev] + runs[prev + 1] + 1U == value;
+        const bool joins_next = 2 * next < runs.size() && runs[2 * next] == value + 1;
+        if (joins_prev && joins_next) {
+            runs[prev + 1] = half(runs[prev + 1] + runs[2 * next + 1] + 2U);
+            runs.erase(at(2 * next), at(2 * next + 2));
+        } else if (joins_prev) {
+            ++runs[prev + 1];
+        } else if (joins_next) {
+            --runs[2 * next];
+            ++runs[2 * next + 1];
+        } else {
+            runs.insert(at(2 * next), {low, 0});
+        }
+    } else {
+        const std::uint32_t start = runs[prev];
+        const std::uint32_t last = start + runs[prev + 1];
+        if (start == last) {
+            runs.erase(at(prev), at(prev + 2));
+        } else if (value == start) {
+            ++runs[prev];
+            --runs[prev + 1];
+        } else if (value == last) {
+            --runs[prev + 1];
+        } else {
+            runs[prev + 1] = half(value - 1 - start);
+            runs.insert(at(prev + 2), {half(value + 1), half(last - value - 1)});
+        }
+    }
+    c = roaring_from_runs(std::move(runs));
+    return true;
+}
+
+inline bool roaring_add(roaring_container& c, std::uint16_t low) {
+    if (c.kind == roaring_kind::run) {
+        return roaring_update_runs(c, low, true);
+    }
+    if (c.kind == roaring_kind::array) {
+        const auto pos = std::lower_bound(c.halves.begin(), c.halves.end(), low);
+        if (pos != c.halves.end() && *pos == low) {
+            return false;
+        }
+        if (c.cardinality < roaring_array_max) {
+            c.halves.insert(pos, low);
+            ++c.cardinality;
+            return true;
+        }
+        c = roaring_to_bitmap(c.ref());
+    }
+    std::uint64_t& word = c.words[low / 64];
+    const std::uint64_t bit = std::uint64_t{1} << (low % 64);
+    if ((word & bit) != 0) {
+        return false;
+    }
+    word |= bit;
+    ++c.cardinality;
+    return true;
+}
+
+inline bool roaring_remove(roaring_container& c, std::uint16_t low) {
+    if (c.kind == roaring_kind::run) {
+        return roaring_update_runs(c, low, false);
+    }
+    if (c.kind == roaring_kind::array) {
+        const auto pos = std::lower_bound(c.halves.begin(), c.halves.end(), low);
+        if (pos == c.halves.end() || *pos != low) {
+            return false;
+        }
+        c.halves.erase(pos);
+        --c.cardinality;
+        return true;
+    }
+    std::uint64_t& word = c.words[low / 64];
+    const std::uint64_t bit = std::uint64_t{1} << (low % 64);
+    if ((word & bit) == 0) {
+        return false;
+    }
+    word &= ~bit;
+    if (--c.cardinality <= roaring_array_max) {
+        c = roaring_from_words(std::move(c.words), c.cardinality);
+    }
+    return true;
+}
+
+// Serialized layout, all little-endian: a 16-byte header of magic, value bits and
+// container count; the 8-byte container keys; a 16-byte descriptor per container of
+// payload offset, cardinality, size and kind; then the payloads, each 8-byte aligned.
+inline constexpr std::uint32_t roaring_magic = 0x4d425253; // "SRBM"
+inline constexpr std::size_t roaring_header_bytes = 16;
+inline constexpr std::size_t roaring_key_bytes = 8;
+inline constexpr std::size_t roaring_descriptor_bytes = 16;
+
+constexpr std::size_t roaring_layout_bytes(std::size_t count) noexcept {
+    return roaring_header_bytes + (roaring_key_bytes + roaring_descriptor_bytes) * count;
+}
+
+constexpr std::size_t roaring_payload_bytes(roaring_kind kind, std::size_t size) noexcept {
+    std::size_t bytes = roaring_words * sizeof(std::uint64_t);
+    if (kind == roaring_kind::array) {
+        bytes = size * sizeof(std::uint16_t);
+    } else if (kind == roaring_kind::run) {
+        bytes = size * 2 * sizeof(std::uint16_t);
+    }
+    return (bytes + 7) & ~std::size_t{7};
+}
+
+template <std::unsigned_integral U>
+void store_le(std::byte* out, U value) noexcept {
+    for (std::size_t i = 0; i < sizeof(U); ++i) {
+        out[i] = static_cast<std::byte>(static_cast<std::uint8_t>(value >> (8 * i)));
+    }
+}
+
+template <std::unsigned_integral U>
+void store_le_n(std::byte* out, const U* values, std::size_t count) noexcept {
+    if constexpr (std::endian::native == std::endian::little) {
+        std::memcpy(out, values, count * sizeof(U));
+    } else {
+        for (std::size_t i = 0; i < count; ++i) {
+            store_le(out + i * sizeof(U), values[i]);
+        }
+    }
+}
+
+template <std::unsigned_integral U>
+U load_le(const std::byte* in) noexcept {
+    U value = 0;
+    for (std::size_t i = 0; i < sizeof(U); ++i) {
+        value |= static_cast<U>(static_cast<U>(in[i]) << (8 * i));
+    }
+    return value;
+}
+
+// Algorithms over roaring and roaring_view, which both expose their containers to it as
+// container_count(), container_key(i) and container(i).
+struct roaring_access {
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    template <typename Source>
+    static std::size_t find(const Source& source, std::uint64_t key) noexcept {
+        std::size_t first = 0;
+        std::size_t count = source.container_count();
+        while (count > 0) {
+            const std::size_t half = count / 2;
+            if (source.container_key(first + half) < key) {
+                first += half + 1;
+                count -= half + 1;
+            } else {
+                count = half;
+            }
+        }
+        return first < source.container_count() && source.container_key(first) == key
+                   ? first
+                   : npos;
+    }
+
+    template <typename Source>
+    static bool contains(const Source& source, std::uint64_t value) noexcept {
+        const std::size_t i = find(source, value >> 16);
+        return i != npos &&
+               roaring_contains(source.container(i), static_cast<std::uint16_t>(value));
+    }
+
+    template <typename Source>
+    static std::size_t cardinality(const Source& source) noexcept {
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < source.container_count(); ++i) {
+            count += source.container(i).cardinality;
+        }
+        return count;
+    }
+
+    // Walks the keys of both inputs in order. Keys on one side only are copied or
+    // dropped depending on op; shared keys combine their containers.
+    template <typename Result, typename Lhs, typename Rhs>
+    static Result combine(roaring_op op, const Lhs& lhs, const Rhs& rhs) {
+        constexpr std::uint64_t end = ~std::uint64_t{0};
+        Result out;
+        std::size_t i = 0;
+        std::size_t j = 0;
+        const std::size_t lhs_count = lhs.container_count();
+        const std::size_t rhs_count = rhs.container_count();
+        while (i < lhs_count || j < rhs_count) {
+            const std::uint64_t lhs_key = i < lhs_count ? lhs.container_key(i) : end;
+            const std::uint64_t rhs_key = j < rhs_count ? rhs.container_key(j) : end;
+            if (lhs_key < rhs_key) {
+                if (op != roaring_op::intersect) {
+                    out.keys_.push_back(lhs_key);
+                    out.containers_.push_back(roaring_copy(lhs.container(i)));
+                }
+                ++i;
+            } else if (rhs_key < lhs_key) {
+                if (op == roaring_op::merge) {
+                    out.keys_.push_back(rhs_key);
+                    out.containers_.push_back(roaring_copy(rhs.container(j)));
+                }
+                ++j;
+            } else {
+                roaring_container c =
+                    roaring_combine(op, lhs.container(i), rhs.container(j));
+                if (c.cardinality != 0) {
+                    out.keys_.push_back(lhs_key);
+                    out.containers_.push_back(std::move(c));
+                }
+                ++i;
+                ++j;
+            }
+        }
+        return out;
+    }
+
+    template <typename Lhs, typename Rhs>
+    static std::size_t intersect_count(const Lhs& lhs, const Rhs& rhs) {
+        std::size_t count = 0;
+        std::size_t i = 0;
+        std::size_t j = 0;
+        while (i < lhs.container_count() && j < rhs.container_count()) {
+            const std::uint64_t lhs_key = lhs.container_key(i);
+            const std::uint64_t rhs_key = rhs.container_key(j);
+            if (lhs_key == rhs_key) {
+                count += roaring_intersect_count(lhs.container(i), rhs.container(j));
+            }
+            i += lhs_key <= rhs_key ? 1 : 0;
+            j += rhs_key <= lhs_key ? 1 : 0;
+        }
+        return count;
+    }
+
+    // Containers with the same values compare equal in any form.
+    template <typename Lhs, typename Rhs>
+    static bool equal(const Lhs& lhs, const Rhs& rhs) {
+        if (lhs.container_count() != rhs.container_count()) {
+            return false;
+        }
+        for (std::size_t i = 0; i < lhs.container_count(); ++i) {
+            const roaring_ref a = lhs.container(i);
+            const roaring_ref b = rhs.container(i);
+            if (lhs.container_key(i) != rhs.container_key(i) ||
+                a.cardinality != b.cardinality ||
+                roaring_intersect_count(a, b) != a.cardinality) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+} // namespace detail
+
+// Reads the values of a roaring or roaring_view in increasing order, a batch at a time.
+// The set must outlive the reader and not change while it is read.
+template <typename Source>
+class roaring_reader {
+  public:
+    using value_type = typename Source::value_type;
+
+    explicit roaring_reader(const Source& source) noexcept : source_(&source) {}
+
+    // Writes the next values to out and returns how many. Fewer than out.size() means the
+    // end of the set.
+    std::size_t next(std::span<value_type> out) noexcept {
+        std::size_t count = 0;
+        while (count < out.size() && container_ < source_->container_count()) {
+            count += read(out.subspan(count));
+        }
+        return count;
+    }
+
+  private:
+    // Reads from the current container, and moves to the next one at its end. pos_ is the
+    // next array value, bitmap word or run, and bits_ is what is left of the last word
+    // read or the offset into the current run.
+    std::size_t read(std::span<value_type> out) noexcept {
+        const detail::roaring_ref c = source_->container(container_);
+        const std::uint64_t high = source_->container_key(container_) << 16;
+        const auto value = [high](std::uint64_t low) {
+            return value_type{static_cast<detail::repr_t<value_type>>(high | low)};
+        };
+        std::size_t n = 0;
+        bool done = false;
+        switch (c.kind) {
+            case detail::roaring_kind::array:
+                for (; n < out.size() && pos_ < c.size; ++n, ++pos_) {
+                    out[n] = value(c.halves[pos_]);
+                }
+                done = pos_ == c.size;
+                break;
+            case detail::roaring_kind::bitmap: {
+                // The rest of a word cut short by the last batch, whole words while they
+                // fit, then bit by bit up to the end of out.
+                const auto emit_bits = [&] {
+                    for (; bits_ != 0 && n < out.size(); bits_ &= bits_ - 1) {
+                        const auto bit = static_cast<unsigned>(std::countr_zero(bits_));
+                        out[n++] = value((pos_ - 1) * 64 + bit);
+                    }
+                };
+                emit_bits();
+                if (bits_ == 0) {
+                    const auto rest = as_repr_span(out.subspan(n));
+                    n += detail::dispatch(detail::roaring_decode_kernel{}, c.words, &pos_,
+                                          high, rest.data(), rest.size());
+                }
+                while (n < out.size() && bits_ == 0 && pos_ < detail::roaring_words) {
+                    bits_ = c.words[pos_++];
+                    emit_bits();
+                }
+                done = bits_ == 0 && pos_ == detail::roaring_words;
+                break;
+            }
+            case detail::roaring_kind::run:
+                for (; n < out.size() && pos_ < c.size; ++n) {
+                    out[n] = value(c.halves[2 * pos_] + bits_);
+                    if (bits_ == c.halves[2 * pos_ + 1]) {
+                        ++pos_;
+                        bits_ = 0;
+                    } else {
+                        ++bits_;
+                    }
+                }
+                done = pos_ == c.size;
+                break;
+        }
+        if (done) {
+            ++container_;
+            pos_ = 0;
+            bits_ = 0;
+        }
+        return n;
+    }
+
+    const Source* source_;
+    std::size_t container_ = 0;
+    std::size_t pos_ = 0;
+    std::uint64_t bits_ = 0;
+};
+
+// Compressed set of u32 or u64 values, such as IDs. Values are grouped by their high bits
+// into containers of up to 65536 values, each a sorted array, a bitmap or a list of runs.
+// Set operations combine the containers with the same key, with a SIMD popcount over
+// bitmaps, and serialize() writes a form that roaring_view reads in place.
+template <stipp_int T>
+    requires std::same_as<T, u32> || std::same_as<T, u64>
+class roaring {
+    using repr_type = detail::repr_t<T>;
+
+  public:
+    using value_type = T;
+
+    roaring() = default;
+
+    // The values may come in any order and repeat.
+    explicit roaring(std::span<const T> values) {
+        std::vector<T> sorted(values.begin(), values.end());
+        if (!std::is_sorted(sorted.begin(), sorted.end())) {
+            radix_sort(std::span<T>(sorted));
+        }
+        const auto reprs = as_repr_span(std::span<const T>(sorted));
+        for (std::size_t i = 0; i < reprs.size();) {
+            const std::uint64_t key = reprs[i] >> 16;
+            std::vector<std::uint16_t> lows;
+            for (; i < reprs.size() && reprs[i] >> 16 == key; ++i) {
+                const auto low = static_cast<std::uint16_t>(reprs[i]);
+                if (lows.empty() || lows.back() != low) {
+                    lows.push_back(low);
+                }
+            }
+            keys_.push_back(key);
+            containers_.push_back(detail::roaring_from_array(std::move(lows)));
+        }
+    }
+
+    explicit roaring(const roaring_view<T>& view) {
+        keys_.reserve(view.container_count());
+        containers_.reserve(view.container_count());
+        for (std::size_t i = 0; i < view.container_count(); ++i) {
+            keys_.push_back(view.container_key(i));
+            containers_.push_back(detail::roaring_copy(view.container(i)));
+        }
+    }
+
+    [[nodiscard]] bool empty() const noexcept { return keys_.empty(); }
+
+    [[nodiscard]] std::size_t cardinality() const noexcept {
+        return detail::roaring_access::cardinality(*this);
+    }
+
+    [[nodiscard]] bool contains(T value) const noexcept {
+        return detail::roaring_access::contains(*this, detail::to_repr(value));
+    }
+
+    // Returns whether value was not in the set before.
+    bool add(T value) {
+        const repr_type repr = detail::to_repr(value);
+        const std::uint64_t key = repr >> 16;
+        const auto low = static_cast<std::uint16_t>(repr);
+        const auto pos = std::lower_bound(keys_.begin(), keys_.end(), key);
+        const auto index = static_cast<std::size_t>(pos - keys_.begin());
+        if (pos != keys_.end() && *pos == key) {
+            return detail::roaring_add(containers_[index], low);
+        }
+        detail::roaring_container c;
+        c.cardinality = 1;
+        c.halves.push_back(low);
+        containers_.reserve(containers_.size() + 1);
+        keys_.insert(pos, key);
+        containers_.insert(containers_.begin() + static_cast<std::ptrdiff_t>(index),
+                           std::move(c));
+        return true;
+    }
+
+    // Returns whether value was in the set.
+    bool remove(T value) {
+        const repr_type repr = detail::to_repr(value);
+        const std::size_t index = detail::roaring_access::find(*this, repr >> 16);
+        if (index == detail::roaring_access::npos ||
+            !detail::roaring_remove(containers_[index], static_cast<std::uint16_t>(repr))) {
+            return false;
+        }
+        if (containers_[index].cardinality == 0) {
+            keys_.erase(keys_.begin() + static_cast<std::ptrdiff_t>(index));
+            containers_.erase(containers_.begin() + static_cast<std::ptrdiff_t>(index));
+        }
+        return true;
+    }
+
+    // Adds every value from first to last, inclusive, as runs where they are smaller.
+    void add_range(T first, T last) {
+        const repr_type lo = detail::to_repr(first);
+        const repr_type hi = detail::to_repr(last);
+        if (hi < lo) {
+            return;
+        }
+        const std::uint64_t first_key = lo >> 16;
+        const std::uint64_t last_key = hi >> 16;
+        const auto begin = std::lower_bound(keys_.begin(), keys_.end(), first_key);
+        const auto end = std::upper_bound(begin, keys_.end(), last_key);
+        auto existing = static_cast<std::size_t>(begin - keys_.begin());
+
+        std::vector<std::uint64_t> keys;
+        std::vector<detail::roaring_container> containers;
+        for (std::uint64_t key = first_key; key <= last_key; ++key) {
+            const std::uint16_t start =
+                key == first_key ? static_cast<std::uint16_t>(lo) : std::uint16_t{0};
+            const std::uint16_t stop =
+                key == last_key ? static_cast<std::uint16_t>(hi) : std::uint16_t{0xffff};
+            const auto length = static_cast<std::uint16_t>(stop - start);
+            detail::roaring_container c = detail::roaring_from_runs({start, length});
+            if (existing < keys_.size() && keys_[existing] == key) {
+                c = detail::roaring_combine(detail::roaring_op::merge,
+                                            containers_[existing++].ref(), c.ref());
+            }
+            keys.push_back(key);
+            containers.push_back(std::move(c));
+        }
+        // Nothing can throw once both vectors have room for the result.
+        const auto removed = end - begin;
+        const auto first_index = begin - keys_.begin();
+        const std::size_t size =
+            keys_.size() - static_cast<std::size_t>(removed) + keys.size();
+        keys_.reserve(size);
+        containers_.reserve(size);
+        keys_.erase(keys_.begin() + first_index, keys_.begin() + first_index + removed);
+        keys_.insert(keys_.begin() + first_index, keys.begin(), keys.end());
+        const auto containers_begin = containers_.begin() + first_index;
+        containers_.erase(containers_begin, containers_begin + removed);
+        containers_.insert(containers_.begin() + first_index,
+                           std::make_move_iterator(containers.begin()),
+                           std::make_move_iterator(containers.end()));
+    }
+
+    // Stores each container as runs if that is smaller.
+    void run_optimize() {
+        for (detail::roaring_container& c : containers_) {
+            detail::roaring_optimize(c);
+        }
+    }
+
+    [[nodiscard]] roaring_reader<roaring> reader() const noexcept {
+        return roaring_reader<roaring>(*this);
+    }
+
+    template <typename Rhs>
+        requires detail::roaring_operands<roaring, Rhs>
+    roaring& operator&=(const Rhs& rhs) {
+        return *this = *this & rhs;
+    }
+
+    template <typename Rhs>
+        requires detail::roaring_operands<roaring, Rhs>
+    roaring& operator|=(const Rhs& rhs) {
+        return *this = *this | rhs;
+    }
+
+    template <typename Rhs>
+        requires detail::roaring_operands<roaring, Rhs>
+    roaring& operator-=(const Rhs& rhs) {
+        return *this = *this - rhs;
+    }
+
+    [[nodiscard]] std::size_t serialized_size() const noexcept {
+        std::size_t size = detail::roaring_layout_bytes(keys_.size());
+        for (const detail::roaring_container& c : containers_) {
+            size += detail::roaring_payload_bytes(c.kind, c.ref().size);
+        }
+        return size;
+    }
+
+    // Writes the form that roaring_view reads and returns its size in bytes. The layout is
+    // the same on every host.
+    std::size_t serialize(std::span<std::byte> out) const {
+        const std::size_t size = serialized_size();
+        detail::check_output_size(size, out.size(),
+                                  "roaring serialize output span is too small");
+        std::byte* const data = out.data();
+        std::fill_n(data, size, std::byte{0});
+        detail::store_le(data, detail::roaring_magic);
+        detail::store_le(data + 4, static_cast<std::uint32_t>(sizeof(T) * 8));
+        detail::store_le(data + 8, static_cast<std::uint64_t>(keys_.size()));
+        std::byte* const keys = data + detail::roaring_header_bytes;
+        std::byte* const descriptors = keys + detail::roaring_key_bytes * keys_.size();
+        std::size_t offset = detail::roaring_layout_bytes(keys_.size());
+        for (std::size_t i = 0; i < keys_.size(); ++i) {
+            const detail::roaring_ref c = containers_[i].ref();
+            std::byte* const descriptor =
+                descriptors + detail::roaring_descriptor_bytes * i;
+            detail::store_le(keys + detail::roaring_key_bytes * i, keys_[i]);
+            detail::store_le(descriptor, static_cast<std::uint64_t>(offset));
+            detail::store_le(descriptor + 8, c.cardinality);
+            detail::store_le(descriptor + 12, static_cast<std::uint16_t>(c.size));
+            detail::store_le(descriptor + 14, static_cast<std::uint8_t>(c.kind));
+            if (c.kind == detail::roaring_kind::bitmap) {
+                detail::store_le_n(data + offset, c.words, detail::roaring_words);
+            } else {
+                detail::store_le_n(data + offset, c.halves, containers_[i].halves.size());
+            }
+            offset += detail::roaring_payload_bytes(c.kind, c.size);
+        }
+        return size;
+    }
+
+  private:
+    friend struct detail::roaring_access;
+    friend class roaring_reader<roaring>;
+
+    [[nodiscard]] std::size_t container_count() const noexcept { return keys_.size(); }
+
+    [[nodiscard]] std::uint64_t container_key(std::size_t i) const noexcept {
+        return keys_[i];
+    }
+
+    [[nodiscard]] detail::roaring_ref container(std::size_t i) const noexcept {
+        return containers_[i].ref();
+    }
+
+    std::vector<std::uint64_t> keys_;
+    std::vector<detail::roaring_container> containers_;
+};
+
+// Read-only roaring set over the bytes written by roaring::serialize(), such as a mapped
+// file. Containers are read in place, so the bytes must stay alive and start at an 8-byte
+// aligned address. Hosts must be little-endian, like the layout.
+template <stipp_int T>
+    requires std::same_as<T, u32> || std::same_as<T, u64>
+class roaring_view {
+    static_assert(std::endian::native == std::endian::little,
+                  "roaring_view reads little-endian containers in place");
+
+  public:
+    using value_type = T;
+
+    roaring_view() = default;
+
+    // Checks the header, the order of the keys, the bounds of every container, that array
+    // values increase, that runs are in order and neither overlap nor touch, and that the
+    // cardinality of each container matches its contents. Throws std::invalid_argument if
+    // the bytes are not a serialized roaring<T>.
+    explicit roaring_view(std::span<const std::byte> bytes) : bytes_(bytes.data()) {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        if (reinterpret_cast<std::uintptr_t>(bytes.data()) % 8 != 0) {
+            throw std::invalid_argument("roaring_view bytes are not 8-byte aligned");
+        }
+        if (bytes.size() < detail::roaring_header_bytes ||
+            detail::load_le<std::uint32_t>(bytes_) != detail::roaring_magic ||
+            detail::load_le<std::uint32_t>(bytes_ + 4) != sizeof(T) * 8) {
+            throw std::invalid_argument(
+                "roaring_view bytes are not a serialized roaring of this type");
+        }
+        const auto count = detail::load_le<std::uint64_t>(bytes_ + 8);
+        if (count > (bytes.size() - detail::roaring_header_bytes) /
+                        (detail::roaring_key_bytes + detail::roaring_descriptor_bytes)) {
+            throw std::invalid_argument("roaring_view bytes are truncated");
+        }
+        count_ = static_cast<std::size_t>(count);
+        constexpr std::uint64_t key_end = std::uint64_t{1} << (sizeof(T) * 8 - 16);
+        for (std::size_t i = 0; i < count_; ++i) {
+            const std::uint64_t key = container_key(i);
+            if (key >= key_end || (i > 0 && key <= container_key(i - 1))) {
+                throw std::invalid_argument("roaring_view container keys are out of order");
+            }
+            if (!valid_container(i, bytes.size())) {
+                throw std::invalid_argument("roaring_view container is malformed");
+            }
+        }
+    }
+
+    [[nodiscard]] bool empty() const noexcept { return count_ == 0; }
+
+    [[nodiscard]] std::size_t cardinality() const noexcept {
+        return detail::roaring_access::cardinality(*this);
+    }
+
+    [[nodiscard]] bool contains(T value) const noexcept {
+        return detail::roaring_access::contains(*this, detail::to_repr(value));
+    }
+
+    [[nodiscard]] roaring_reader<roaring_view> reader() const noexcept {
+        return roaring_reader<roaring_view>(*this);
+    }
+
+  private:
+    friend struct detail::roaring_access;
+    friend class roaring_reader<roaring_view>;
+    friend class roaring<T>;
+
+    [[nodiscard]] const std::byte* descriptor(std::size_t i) const noexcept {
+        return bytes_ + detail::roaring_header_bytes + detail::roaring_key_bytes * count_ +
+               detail::roaring_descriptor_bytes * i;
+    }
+
+    [[nodiscard]] bool valid_container(std::size_t i, std::size_t size) const noexcept {
+        const std::byte* const d = descriptor(i);
+        const auto offset = detail::load_le<std::uint64_t>(d);
+        const auto cardinality = detail::load_le<std::uint32_t>(d + 8);
+        const auto count = detail::load_le<std::uint16_t>(d + 12);
+        const auto kind = detail::load_le<std::uint8_t>(d + 14);
+        bool valid = false;
+        switch (static_cast<detail::roaring_kind>(kind)) {
+            case detail::roaring_kind::array:
+                valid = count == cardinality && count != 0 &&
+                        count <= detail::roaring_array_max;
+                break;
+            case detail::roaring_kind::bitmap:
+                valid = count == 0 && cardinality > detail::roaring_array_max &&
+                        cardinality <= detail::roaring_span;
+                break;
+            case detail::roaring_kind::run:
+                valid = count != 0 && cardinality != 0 &&
+                        cardinality <= detail::roaring_span;
+                break;
+        }
+        if (!valid || offset % 8 != 0 || offset < detail::roaring_layout_bytes(count_) ||
+            offset > size ||
+            size - offset < detail::roaring_payload_bytes(
+                                static_cast<detail::roaring_kind>(kind), count)) {
+            return false;
+        }
+        // The set operations rely on increasing values, runs that neither overlap nor touch
+        // and exact cardinalities, and a run past the end of the container would write past
+        // a bitmap built from it.
+        const detail::roaring_ref c = container(i);
+        if (c.kind == detail::roaring_kind::bitmap) {
+            // The intersection of the words with themselves counts their bits.
+            const std::uint32_t set = detail::roaring_bitmap_op(
+                detail::roaring_op::intersect, c.words, c.words, nullptr);
+            return set == cardinality;
+        }
+        if (c.kind == detail::roaring_kind::array) {
+            for (std::uint32_t k = 1; k < c.size; ++k) {
+                if (c.halves[k] <= c.halves[k - 1]) {
+                    return false;
+                }
+            }
+        } else if (c.kind == detail::roaring_kind::run) {
+            std::uint32_t next = 0;
+            std::uint32_t total = 0;
+            for (std::uint32_t run = 0; run < c.size; ++run) {
+                const std::uint32_t start = c.halves[2 * run];
+                const std::uint32_t last = start + c.halves[2 * run + 1];
+                if (start < next || last >= detail::roaring_span) {
+                    return false;
+                }
+                next = last + 2;
+                total += last - start + 1;
+            }
+            return total == cardinality;
+        }
+        return true;
+    }
+
+    [[nodiscard]] std::size_t container_count() const noexcept { return count_; }
+
+    [[nodiscard]] std::uint64_t container_key(std::size_t i) const noexcept {
+        return detail::load_le<std::uint64_t>(bytes_ + detail::roaring_header_bytes +
+                                              detail::roaring_key_bytes * i);
+    }
+
+    [[nodiscard]] detail::roaring_ref container(std::size_t i) const noexcept {
+        const std::byte* const d = descriptor(i);
+        const std::byte* const payload = bytes_ + detail::load_le<std::uint64_t>(d);
+        // NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast)
+        return {static_cast<detail::roaring_kind>(detail::load_le<std::uint8_t>(d + 14)),
+                detail::load_le<std::uint16_t>(d + 12),
+                detail::load_le<std::uint32_t>(d + 8),
+                reinterpret_cast<const std::uint16_t*>(payload),
+                reinterpret_cast<const std::uint64_t*>(payload)};
+        // NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast)
+    }
+
+    const std::byte* bytes_ = nullptr;
+    std::size_t count_ = 0;
+};
+
+// The set operations take any mix of roaring and roaring_view operands with the same value
+// type. Lhs - Rhs keeps the values of lhs that are not in rhs.
+template <typename Lhs, typename Rhs>
+    requires detail::roaring_operands<Lhs, Rhs>
+roaring<typename Lhs::value_type> operator&(const Lhs& lhs, const Rhs& rhs) {
+    return detail::roaring_access::combine<roaring<typename Lhs::value_type>>(
+        detail::roaring_op::intersect, lhs, rhs);
+}
+
+template <typename Lhs, typename Rhs>
+    requires detail::roaring_operands<Lhs, Rhs>
+roaring<typename Lhs::value_type> operator|(const Lhs& lhs, const Rhs& rhs) {
+    return detail::roaring_access::combine<roaring<typename Lhs::value_type>>(
+        detail::roaring_op::merge, lhs, rhs);
+}
+
+template <typename Lhs, typename Rhs>
+    requires detail::roaring_operands<Lhs, Rhs>
+roaring<typename Lhs::value_type> operator-(const Lhs& lhs, const Rhs& rhs) {
+    return detail::roaring_access::combine<roaring<typename Lhs::value_type>>(
+        detail::roaring_op::subtract, lhs, rhs);
+}
+
+template <typename Lhs, typename Rhs>
+    requires detail::roaring_operands<Lhs, Rhs>
+bool operator==(const Lhs& lhs, const Rhs& rhs) {
+    return detail::roaring_access::equal(lhs, rhs);
+}
+
+// The size of lhs & rhs, without building it.
+template <typename Lhs, typename Rhs>
+    requires detail::roaring_operands<Lhs, Rhs>
+std::size_t set_intersect_count(const Lhs& lhs, const Rhs& rhs) {
+    return detail::roaring_access::intersect_count(lhs, rhs);
+}
+
+namespace detail {
+
+// The rank directory has one entry per block of 2048 bits: the number of set bits before
+// the block, counted from the start of its upper block of 2^31 bits, in the low 31 bits,
+// then the running count at each of the last three 512-bit sub-blocks in 11 bits each.
+// Sub-blocks are one cache line of words, so a rank reads one entry and one line.
+inline constexpr std::size_t bitvector_block_bits = 2048;
+inline constexpr std::size_t bitvector_sub_bits = 512;
+inline constexpr unsigned bitvector_upper_shift = 20;
+inline constexpr std::uint64_t bitvector_relative_mask = (std::uint64_t{1} << 31) - 1;
+
+// The block of every 8192nd set bit, and of every 8192nd clear bit, which bounds the
+// blocks a select has to search.
+inline constexpr std::size_t bitvector_select_sample = 8192;
+
+struct bitvector_layout {
+    const std::uint64_t* words;
+    const std::uint64_t* blocks;
+    const std::uint64_t* upper;
+    const std::size_t* samples;
+    const std::size_t* zero_samples;
+};
+
+struct bitvector_rank_kernel {
+    // The number of set bits before block.
+    STIPP_KERNEL static std::size_t block_rank(bitvector_layout layout,
+                                               std::size_t block) noexcept {
+        return layout.upper[block >> bitvector_upper_shift] +
+               (layout.blocks[block] & bitvector_relative_mask);
+    }
+
+    // The number of set bits before sub-block sub of a block, relative to the block.
+    STIPP_KERNEL static std::size_t sub_rank(std::uint64_t entry,
+                                             std::size_t sub) noexcept {
+        return (entry >> 31 << 11 >> (11 * sub)) & 0x7ff;
+    }
+
+    STIPP_KERNEL std::size_t operator()(bitvector_layout layout,
+                                        std::size_t pos) const noexcept {
+        const std::size_t block = pos / bitvector_block_bits;
+        const std::size_t sub = pos % bitvector_block_bits / bitvector_sub_bits;
+        std::size_t rank = block_rank(layout, block) + sub_rank(layout.blocks[block], sub);
+        const std::size_t word = pos / 64;
+        for (std::size_t w = pos / bitvector_sub_bits * (bitvector_sub_bits / 64); w < word;
+             ++w) {
+            rank += static_cast<std::size_t>(std::popcount(layout.words[w]));
+        }
+        if (pos % 64 != 0) {
+            const std::uint64_t below = (std::uint64_t{1} << (pos % 64)) - 1;
+            rank += static_cast<std::size_t>(std::popcount(layout.words[word] & below));
+        }
+        return rank;
+    }
+};
+
+// Finds the set bit of a given rank, or the clear bit if not Ones.
+template <bool Ones>
+struct bitvector_select_kernel {
+    // The position of the set bit of word with rank set bits below it. Whole bytes are
+    // skipped by their popcounts before the bits of the last byte are cleared one by one.
+    STIPP_KERNEL static std::size_t select_in_word(std::uint64_t word,
+                                                   std::size_t rank) noexcept {
+        unsigned shift = 0;
+        for (;; shift += 8) {
+            const std::uint64_t byte = (word >> shift) & 0xff;
+            const auto set = static_cast<std::size_t>(std::popcount(byte));
+            if (rank < set) {
+                break;
+            }
+            rank -= set;
+        }
+        std::uint64_t bits = word >> shift;
+        for (; rank > 0; --rank) {
+            bits &= bits - 1;
+        }
+        return shift + static_cast<unsigned>(std::countr_zero(bits));
+    }
+
+#if STIPP_X86_DISPATCH
+    // pdep deposits a single bit onto the set bit wanted, and tzcnt finds it.
+    STIPP_TARGET_AVX2 static std::size_t select_in_word_bmi2(std::uint64_t word,
+                                                             std::size_t rank) noexcept {
+        const std::uint64_t bit = _pdep_u64(std::uint64_t{1} << rank, word);
+        return static_cast<std::size_t>(_tzcnt_u64(bit));
+    }
+#endif
+
+    // The bits before block, or before sub-block sub of a block, and the word w, of the
+    // kind being selected.
+    STIPP_KERNEL static std::size_t block_rank(bitvector_layout layout,
+                                               std::size_t block) noexcept {
+        const std::size_t ones = bitvector_rank_kernel::block_rank(layout, block);
+        return Ones ? ones : block * bitvector_block_bits - ones;
+    }
+
+    STIPP_KERNEL static std::size_t sub_rank(std::uint64_t entry,
+                                             std::size_t sub) noexcept {
+        const std::size_t ones = bitvector_rank_kernel::sub_rank(entry, sub);
+        return Ones ? ones : sub * bitvector_sub_bits - ones;
+    }
+
+    STIPP_KERNEL static std::uint64_t word_bits(bitvector_layout layout,
+                                                std::size_t w) noexcept {
+        return Ones ? layout.words[w] : ~layout.words[w];
+    }
+
+    template <cpu_level Level>
+    STIPP_KERNEL static std::size_t select(bitvector_layout layout,
+                                           std::size_t rank) noexcept {
+        // The bit is in the last block whose rank is at most rank, which lies between
+        // the blocks of the samples either side of it.
+        const std::size_t* samples = Ones ? layout.samples : layout.zero_samples;
+        const std::size_t sample = rank / bitvector_select_sample;
+        std::size_t block = samples[sample];
+        std::size_t count = samples[sample + 1] - block;
+        while (count > 0) {
+            const std::size_t half = count / 2;
+            if (block_rank(layout, block + half + 1) <= rank) {
+                block += half + 1;
+                count -= half + 1;
+            } else {
+                count = half;
+            }
+        }
+        rank -= block_rank(layout, block);
+        const std::uint64_t entry = layout.blocks[block];
+        std::size_t sub = 0;
+        for (std::size_t s = 1; s < bitvector_block_bits / bitvector_sub_bits; ++s) {
+            sub += static_cast<std::size_t>(sub_rank(entry, s) <= rank);
+        }
+        rank -= sub_rank(entry, sub);
+        std::size_t word =
+            block * (bitvector_block_bits / 64) + sub * (bitvector_sub_bits / 64);
+        for (;; ++word) {
+            const std::uint64_t bits = word_bits(layout, word);
+            const auto set = static_cast<std::size_t>(std::popcount(bits));
+            if (rank < set) {
+                break;
+            }
+            rank -= set;
+        }
+#if STIPP_X86_DISPATCH
+        if constexpr (Level >= cpu_level::avx2) {
+            return word * 64 + select_in_word_bmi2(word_bits(layout, word), rank);
+        }
+#endif
+        return word * 64 + select_in_word(word_bits(layout, word), rank);
+    }
+
+    STIPP_KERNEL std::size_t operator()(bitvector_layout layout,
+                                        std::size_t rank) const noexcept {
+        return select<cpu_level::baseline>(layout, rank);
+    }
+
+#if STIPP_X86_DISPATCH
+    STIPP_TARGET_AVX2 std::size_t avx2(bitvector_layout layout,
+                                       std::size_t rank) const noexcept {
+        return select<cpu_level::avx2>(layout, rank);
+    }
+
+    STIPP_TARGET_AVX512 std::size_t avx512(bitvector_layout layout,
+                                           std::size_t rank) const noexcept {
+        return select<cpu_level::avx512>(layout, rank);
+    }
+#endif
+};
+
+} // namespace detail
+
+// Rank and select over bits stored in u64 words, which it indexes in place: bit i is bit
+// i % 64 of word i / 64. rank1 reads one directory entry and at most one cache line of
+// words. select1 and select0 search the blocks between two samples of the set or clear
+// bits and finish in the word with pdep and tzcnt where the CPU has them. The directory
+// and samples take about 4% of the size of the bits.
+class rank_select_bitvector {
+  public:
+    rank_select_bitvector() : rank_select_bitvector(std::span<const u64>{}) {}
+
+    // The words must outlive the index and must not change while it is in use.
+    explicit rank_select_bitvector(std::span<const u64> words)
+        : rank_select_bitvector(words, words.size() * 64) {}
+
+    // Indexes the first size bits of words. The bits of the last word past size are
+    // ignored.
+    rank_select_bitvector(std::span<const u64> words, std::size_t size) : size_(size) {
+        if (size > words.size() * 64) {
+            throw std::length_error("rank_select_bitvector size is larger than its words");
+        }
+        words_ = as_repr_span(words).first((size + 63) / 64);
+        const std::uint64_t last_mask =
+            size % 64 == 0 ? ~std::uint64_t{0} : (std::uint64_t{1} << (size % 64)) - 1;
+        const auto word_count = [&](std::size_t w) -> std::size_t {
+            if (w >= words_.size()) {
+                return 0;
+            }
+            const std::uint64_t mask =
+                w + 1 == words_.size() ? last_mask : ~std::uint64_t{0};
+            return static_cast<std::size_t>(std::popcount(words_[w] & mask));
+        };
+
+        constexpr std::size_t block_words = detail::bitvector_block_bits / 64;
+        constexpr std::size_t sub_words = detail::bitvector_sub_bits / 64;
+        constexpr std::size_t sample = detail::bitvector_select_sample;
+        const std::size_t block_count =
+            (size + detail::bitvector_block_bits - 1) / detail::bitvector_block_bits;
+        blocks_.reserve(block_count + 1);
+        // The entry past the last block holds the total, so rank1(size()) needs no check.
+        for (std::size_t block = 0; block <= block_count; ++block) {
+            if (block % (std::size_t{1} << detail::bitvector_upper_shift) == 0) {
+                upper_.push_back(count_);
+            }
+            std::uint64_t entry = count_ - upper_.back();
+            const std::size_t first = block * detail::bitvector_block_bits;
+            const std::size_t length =
+                first < size ? (std::min)(size - first, detail::bitvector_block_bits) : 0;
+            std::size_t set = 0;
+            for (std::size_t w = 0; w < block_words; ++w) {
+                if (w % sub_words == 0 && w != 0) {
+                    entry |= std::uint64_t{set} << (20 + 11 * (w / sub_words));
+                }
+                set += word_count(block * block_words + w);
+            }
+            for (std::size_t next = samples_.size() * sample; next < count_ + set;
+                 next += sample) {
+                samples_.push_back(block);
+            }
+            const std::size_t zeros = first - count_;
+            for (std::size_t next = zero_samples_.size() * sample;
+                 next < zeros + length - set; next += sample) {
+                zero_samples_.push_back(block);
+            }
+            blocks_.push_back(entry);
+            count_ += set;
+        }
+        samples_.push_back(block_count);
+        zero_samples_.push_back(block_count);
+    }
+
+    // The number of bits.
+    [[nodiscard]] std::size_t size() const noexcept { return size_; }
+
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+
+    // The number of set bits.
+    [[nodiscard]] std::size_t count() const noexcept { return count_; }
+
+    // Requires pos < size().
+    [[nodiscard]] bool test(std::size_t pos) const noexcept {
+        return ((words_[pos / 64] >> (pos % 64)) & 1) != 0;
+    }
+
+    // The number of set bits before pos, which must be at most size().
+    [[nodiscard]] std::size_t rank1(std::size_t pos) const noexcept {
+        return detail::dispatch(detail::bitvector_rank_kernel{}, layout(), pos);
+    }
+
+    // The number of clear bits before pos, which must be at most size().
+    [[nodiscard]] std::size_t rank0(std::size_t pos) const noexcept {
+        return pos - rank1(pos);
+    }
+
+    // The position of the set bit with rank set bits before it, which must be less than
+    // count().
+    [[nodiscard]] std::size_t select1(std::size_t rank) const noexcept {
+        return detail::dispatch(detail::bitvector_select_kernel<true>{}, layout(), rank);
+    }
+
+    // The position of the clear bit with rank clear bits before it, which must be less
+    // than size() - count().
+    [[nodiscard]] std::size_t select0(std::size_t rank) const noexcept {
+        return detail::dispatch(detail::bitvector_select_kernel<false>{}, layout(), rank);
+    }
+
+    // The memory taken by the index, not counting the words it indexes.
+    [[nodiscard]] std::size_t index_bytes() const noexcept {
+        return (blocks_.size() + upper_.size()) * sizeof(std::uint64_t) +
+               (samples_.size() + zero_samples_.size()) * sizeof(std::size_t);
+    }
+
+  private:
+    [[nodiscard]] detail::bitvector_layout layout() const noexcept {
+        return {words_.data(), blocks_.data(), upper_.data(), samples_.data(),
+                zero_samples_.data()};
+    }
+
+    std::span<const std::uint64_t> words_;
+    std::vector<std::uint64_t> blocks_;
+    std::vector<std::uint64_t> upper_;
+    std::vector<std::size_t> samples_;
+    std::vector<std::size_t> zero_samples_;
+    std::size_t size_ = 0;
+    std::size_t count_ = 0;
+};
+
+namespace detail {
+
+struct elias_fano_layout {
+    const std::uint64_t* upper;
+    const std::uint64_t* lows;
+    unsigned low_bits;
+};
+
+// Decodes count values of an Elias-Fano sequence into out, starting with value first,
+// whose high bits are the first set bit of upper at or after bit. The high bits of the
+// batch are decoded before the low bits, so that neither loop waits on the other.
+struct elias_fano_decode_kernel {
+    template <typename Out>
+    STIPP_KERNEL static void highs(elias_fano_layout layout,
+                                   std::size_t first,
+                                   std::size_t bit,
+                                   Out* out,
+                                   std::size_t count) noexcept {
+        std::size_t word = bit / 64;
+        std::uint64_t bits = layout.upper[word] & (~std::uint64_t{0} << (bit % 64));
+        for (std::size_t i = 0; i < count; ++i) {
+            while (bits == 0) {
+                bits = layout.upper[++word];
+            }
+            const auto offset = static_cast<unsigned>(std::countr_zero(bits));
+            bits &= bits - 1;
+            out[i] = static_cast<Out>((word * 64 + offset - first - i) << layout.low_bits);
+        }
+    }
+
+    template <typename Out>
+    STIPP_KERNEL static void lows(elias_fano_layout layout,
+                                  std::size_t first,
+                                  Out* out,
+                                  std::size_t begin,
+                                  std::size_t end) noexcept {
+        const std::uint64_t mask = (std::uint64_t{1} << layout.low_bits) - 1;
+        for (std::size_t i = begin; i < end; ++i) {
+            const std::size_t bit = (first + i) * layout.low_bits;
+            const std::uint64_t* words = layout.lows + bit / 64;
+            const std::uint64_t low =
+                (words[0] >> (bit % 64)) | (words[1] << 1 << (63 - bit % 64));
+            out[i] |= static_cast<Out>(low & mask);
+        }
+    }
+
+    template <typename Out>
+    STIPP_KERNEL void operator()(elias_fano_layout layout,
+                                 std::size_t first,
+                                 std::size_t bit,
+                                 Out* out,
+                                 std::size_t count) const noexcept {
+        highs(layout, first, bit, out, count);
+        lows(layout, first, out, 0, count);
+    }
+
+#if STIPP_X86_DISPATCH
+    // Gathers the two words that hold the low bits of each of 4 values and shifts them
+    // into place with per-lane shifts.
+    template <typename Out>
+    STIPP_TARGET_AVX2 void avx2(elias_fano_layout layout,
+                                std::size_t first,
+                                std::size_t bit,
+                                Out* out,
+                                std::size_t count) const noexcept {
+        highs(layout, first, bit, out, count);
+        const auto low_bits = static_cast<long long>(layout.low_bits);
+        const std::uint64_t low_mask = (std::uint64_t{1} << layout.low_bits) - 1;
+        const __m256i mask = _mm256_set1_epi64x(static_cast<long long>(low_mask));
+        const __m256i step = _mm256_set1_epi64x(4 * low_bits);
+        const __m256i bit_mask = _mm256_set1_epi64x(63);
+        const auto start = static_cast<long long>(first) * low_bits;
+        __m256i bits = _mm256_setr_epi64x(start, start + low_bits, start + 2 * low_bits,
+                                          start + 3 * low_bits);
+        // NOLINTBEGIN(cppcoreguidelines-pro-type-reinterpret-cast)
+        const auto* words = reinterpret_cast<const long long*>(layout.lows);
+        std::size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            const __m256i index = _mm256_srli_epi64(bits, 6);
+            const __m256i shift = _mm256_and_si256(bits, bit_mask);
+            const __m256i lo = _mm256_i64gather_epi64(words, index, 8);
+            const __m256i hi = _mm256_i64gather_epi64(words + 1, index, 8);
+            const __m256i low = _mm256_and_si256(
+                _mm256_or_si256(_mm256_srlv_epi64(lo, shift),
+                                _mm256_sllv_epi64(_mm256_slli_epi64(hi, 1),
+                                                  _mm256_sub_epi64(bit_mask, shift))),
+                mask);
+            if constexpr (sizeof(Out) == 8) {
+                auto* dst = reinterpret_cast<__m256i*>(out + i);
+                _mm256_storeu_si256(dst, _mm256_or_si256(_mm256_loadu_si256(dst), low));
+            } else {
+                const __m128i packed = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(
+                    low, _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6)));
+                auto* dst = reinterpret_cast<__m128i*>(out + i);
+                _mm_storeu_si128(dst, _mm_or_si128(_mm_loadu_si128(dst), packed));
+            }
+            bits = _mm256_add_epi64(bits, step);
+        }
+        // NOLINTEND(cppcoreguidelines-pro-type-reinterpret-cast)
+        lows(layout, first, out, i, count);
+    }
+
+    // Wider gathers fetch no more words per cycle, so this uses the AVX2 loop.
+    template <typename Out>
+    STIPP_TARGET_AVX512 void avx512(elias_fano_layout layout,
+                                    std::size_t first,
+                                    std::size_t bit,
+                                    Out* out,
+                                    std::size_t count) const noexcept {
+        avx2(layout, first, bit, out, count);
+    }
+#endif
+};
+
+} // namespace detail
+
+// Non-decreasing sequence of u32 or u64 values in about 2 + log2(max / size) bits each.
+// Each value is split into low bits, which are packed, and high bits, which are kept in
+// unary in a bit vector: value i sets bit (value >> low bits) + i. access(i) finds that
+// bit with select1, next_geq finds the first value with given high bits with select0,
+// and iterators walk the set bits a word at a time.
+template <stipp_int T>
+    requires std::same_as<T, u32> || std::same_as<T, u64>
+class elias_fano {
+    using repr_type = detail::repr_t<T>;
+
+    class basic_iterator {
+      public:
+        using value_type = T;
+        using reference = T;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::forward_iterator_tag;
+
+        basic_iterator() = default;
+
+        T operator*() const noexcept { return static_cast<T>(value_); }
+
+        basic_iterator& operator++() noexcept {
+            low_bit_ += low_bits_;
+            if (++index_ < size_) {
+                decode();
+            }
+            return *this;
+        }
+
+        basic_iterator operator++(int) noexcept {
+            const basic_iterator ret = *this;
+            ++*this;
+            return ret;
+        }
+
+        // The position of the value in the sequence.
+        [[nodiscard]] std::size_t index() const noexcept { return index_; }
+
+        friend bool operator==(const basic_iterator& lhs,
+                               const basic_iterator& rhs) noexcept {
+            return lhs.index_ == rhs.index_;
+        }
+
+      private:
+        friend class elias_fano;
+
+        // Starts at value index, whose high bit is the first set bit at or after bit. The
+        // iterator keeps its own copy of what it reads of the sequence, which the
+        // compiler can then keep in registers while iterating.
+        basic_iterator(const elias_fano& sequence,
+                       std::size_t index,
+                       std::size_t bit) noexcept
+            : upper_(sequence.upper_.data()),
+              lows_(sequence.lows_.data()),
+              low_mask_(sequence.low_mask_),
+              low_bits_(sequence.low_bits_),
+              size_(sequence.size_),
+              index_(index),
+              low_bit_(index * sequence.low_bits_),
+              word_(bit / 64) {
+            if (index_ < size_) {
+                bits_ = upper_[word_] & (~std::uint64_t{0} << (bit % 64));
+                decode();
+            }
+        }
+
+        void decode() noexcept {
+            while (bits_ == 0) {
+                bits_ = upper_[++word_];
+            }
+            const auto offset = static_cast<unsigned>(std::countr_zero(bits_));
+            bits_ &= bits_ - 1;
+            const std::size_t high = word_ * 64 + offset - index_;
+            value_ = elias_fano::combine(high, lows_, low_bit_, low_bits_, low_mask_);
+        }
+
+        const std::uint64_t* upper_{};
+        const std::uint64_t* lows_{};
+        std::uint64_t low_mask_{};
+        unsigned low_bits_{};
+        std::size_t size_{};
+        std::size_t index_{};
+        std::size_t low_bit_{};
+        std::size_t word_{};
+        std::uint64_t bits_{};
+        repr_type value_{};
+    };
+
+  public:
+    using value_type = T;
+    using iterator = basic_iterator;
+    using const_iterator = basic_iterator;
+
+    elias_fano() = default;
+
+    explicit elias_fano(std::span<const T> sorted) : size_(sorted.size()) {
+        if (!std::is_sorted(sorted.begin(), sorted.end())) {
+            throw std::invalid_argument("elias_fano values are not sorted");
+        }
+        const auto values = as_repr_span(sorted);
+        max_ = size_ == 0 ? 0 : values.back();
+        const std::uint64_t ratio = size_ == 0 ? 0 : max_ / size_;
+        low_bits_ = ratio == 0 ? 0 : static_cast<unsigned>(std::bit_width(ratio)) - 1;
+        low_mask_ = (std::uint64_t{1} << low_bits_) - 1;
+        // A word of padding lets value() read two words without a check.
+        lows_.assign(size_ * low_bits_ / 64 + 2, 0);
+        const std::size_t upper_size =
+            size_ + static_cast<std::size_t>(max_ >> low_bits_) + 1;
+        upper_.assign((upper_size + 63) / 64, 0);
+        for (std::size_t i = 0; i < size_; ++i) {
+            const std::uint64_t low = values[i] & low_mask_;
+            const std::size_t bit = i * low_bits_;
+            lows_[bit / 64] |= low << (bit % 64);
+            lows_[bit / 64 + 1] |= low >> 1 >> (63 - bit % 64);
+            const std::size_t high = static_cast<std::size_t>(values[i] >> low_bits_) + i;
+            upper_[high / 64] |= std::uint64_t{1} << (high % 64);
+        }
+        index_ = rank_select_bitvector(upper_words(), upper_size);
+    }
+
+    // The index refers to the bits it indexes, so a copy indexes its own.
+    elias_fano(const elias_fano& other)
+        : size_(other.size_),
+          max_(other.max_),
+          low_bits_(other.low_bits_),
+          low_mask_(other.low_mask_),
+          lows_(other.lows_),
+          upper_(other.upper_),
+          index_(upper_words(), other.index_.size()) {}
+
+    elias_fano(elias_fano&&) noexcept = default;
+
+    elias_fano& operator=(const elias_fano& other) {
+        if (this != &other) {
+            *this = elias_fano(other);
+        }
+        return *this;
+    }
+
+    elias_fano& operator=(elias_fano&&) noexcept = default;
+
+    ~elias_fano() = default;
+
+    [[nodiscard]] std::size_t size() const noexcept { return size_; }
+
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+
+    // Value i, which must be less than size().
+    [[nodiscard]] T access(std::size_t i) const noexcept {
+        const std::size_t high = index_.select1(i) - i;
+        return static_cast<T>(
+            combine(high, lows_.data(), i * low_bits_, low_bits_, low_mask_));
+    }
+
+    [[nodiscard]] iterator begin() const noexcept { return {*this, 0, 0}; }
+
+    [[nodiscard]] iterator end() const noexcept { return {*this, size_, 0}; }
+
+    // The first value not less than value, or end() if there is none.
+    [[nodiscard]] iterator next_geq(T value) const noexcept {
+        const repr_type x = detail::to_repr(value);
+        if (size_ == 0 || x > max_) {
+            return end();
+        }
+        // The values with the high bits of x follow the clear bit that ends the values
+        // with lower ones, and there are few of them, so they are checked in order.
+        const auto high = static_cast<std::size_t>(x >> low_bits_);
+        const std::size_t bit = high == 0 ? 0 : index_.select0(high - 1) + 1;
+        iterator it{*this, bit - high, bit};
+        while (it.value_ < x) {
+            ++it;
+        }
+        return it;
+    }
+
+    // Writes values first, first + 1, ... to out until either ends, and returns how many
+    // it wrote. This decodes faster than iterating, as it decodes a batch in two passes.
+    std::size_t decode(std::size_t first, std::span<T> out) const noexcept {
+        if (first >= size_) {
+            return 0;
+        }
+        const std::size_t count = (std::min)(out.size(), size_ - first);
+        detail::dispatch(detail::elias_fano_decode_kernel{},
+                         detail::elias_fano_layout{upper_.data(), lows_.data(), low_bits_},
+                         first, index_.select1(first), as_repr_span(out).data(), count);
+        return count;
+    }
+
+    // The memory taken by the encoded values and their index.
+    [[nodiscard]] std::size_t memory_bytes() const noexcept {
+        return (lows_.size() + upper_.size()) * sizeof(std::uint64_t) +
+               index_.index_bytes();
+    }
+
+  private:
+    [[nodiscard]] std::span<const u64> upper_words() const noexcept {
+        return from_repr_span<u64>(std::span<const std::uint64_t>(upper_));
+    }
+
+    // The value with the given high bits and the low bits that start at bit of lows.
+    static repr_type combine(std::size_t high,
+                             const std::uint64_t* lows,
+                             std::size_t bit,
+                             unsigned low_bits,
+                             std::uint64_t low_mask) noexcept {
+        const std::uint64_t* words = lows + bit / 64;
+        const std::uint64_t low =
+            (words[0] >> (bit % 64)) | (words[1] << 1 << (63 - bit % 64));
+        return static_cast<repr_type>((std::uint64_t{high} << low_bits) | (low & low_mask));
+    }
+
+    std::size_t size_ = 0;
+    repr_type max_ = 0;
+    unsigned low_bits_ = 0;
+    std::uint64_t low_mask_ = 0;
+    std::vector<std::uint64_t> lows_;
+    std::vector<std::uint64_t> upper_;
+    rank_select_bitvector index_;
+};
+
+namespace detail {
+
+// The number of slots static_map gives N keys by default. With four slots per key, a
+// multiplier that sends every key to its own slot is quick to find for up to about 50
+// scattered keys, and for hundreds of keys that are close together.
+consteval std::size_t static_map_slots(std::size_t count) {
+    return std::bit_ceil((std::max)(count, std::size_t{1}) * 4);
+}
+
+inline constexpr std::size_t static_map_attempts = std::size_t{1} << 12;
+
+} // namespace detail
+
+// Read-only map with keys fixed at compile time, for constant lookup tables. The
+// constructor is consteval and searches for a multiplier under which key * multiplier
+// >> shift gives every key its own slot, so a lookup is one multiply, one shift and one
+// compare, and a constexpr map lives in read-only data with no startup cost. Each empty
+// slot holds a key that belongs to another slot, so no key ever matches it.
+template <detail::hashable K,
+          typename V,
+          std::size_t N,
+          std::size_t Slots = detail::static_map_slots(N)>
+    requires std::is_default_constructible_v<V>
+class static_map {
+    static_assert(std::has_single_bit(Slots) && Slots >= 2 && Slots >= N,
+                  "static_map slots must be a power of two no less than its size");
+
+    static constexpr int shift = 64 - std::countr_zero(Slots);
+
+  public:
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = std::pair<K, V>;
+
+    // Fails to compile if there are not exactly N entries, if a key repeats, or if no
+    // perfect hash was found, which more Slots makes likelier.
+    consteval static_map(std::initializer_list<value_type> entries) {
+        if (entries.size() != N) {
+            throw std::invalid_argument("static_map has the wrong number of entries");
+        }
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+            for (auto other = entries.begin(); other != it; ++other) {
+                if (other->first == it->first) {
+                    throw std::invalid_argument("static_map keys are not unique");
+                }
+            }
+        }
+        if constexpr (N == 0) {
+            return;
+        }
+        // The golden ratio spreads keys that are close together evenly, so it is tried
+        // first. Slots that an attempt fills are marked with the attempt number, so
+        // nothing needs to be cleared between attempts.
+        std::array<std::uint64_t, N> bits{};
+        for (std::size_t i = 0; i < N; ++i) {
+            bits[i] = detail::hash_bits(entries.begin()[i].first);
+        }
+        std::array<std::size_t, Slots> filled{};
+        for (std::size_t attempt = 1; attempt <= detail::static_map_attempts; ++attempt) {
+            const std::uint64_t multiplier =
+                attempt == 1 ? 0x9E37'79B9'7F4A'7C15ULL : detail::splitmix64(attempt) | 1;
+            std::size_t placed = 0;
+            while (placed < N) {
+                const std::uint64_t s = (bits[placed] * multiplier) >> shift;
+                if (filled[s] == attempt) {
+                    break;
+                }
+                filled[s] = attempt;
+                ++placed;
+            }
+            if (placed != N) {
+                continue;
+            }
+            multiplier_ = multiplier;
+            keys_.fill(entries.begin()->first);
+            for (const auto& [key, value] : entries) {
+                keys_[slot(multiplier, key)] = key;
+                values_[slot(multiplier, key)] = value;
+            }
+            return;
+        }
+        throw std::invalid_argument("static_map found no perfect hash; give it more slots");
+    }
+
+    [[nodiscard]] static constexpr std::size_t size() noexcept { return N; }
+
+    [[nodiscard]] static constexpr bool empty() noexcept { return N == 0; }
+
+    // The value of key, or null if there is none.
+    [[nodiscard]] constexpr const V* find(K key) const noexcept {
+        if constexpr (N == 0) {
+            return nullptr;
+        } else {
+            const std::size_t s = slot(multiplier_, key);
+            return keys_[s] == key ? &values_[s] : nullptr;
+        }
+    }
+
+    // Compares keys rather than testing find for null, which GCC cannot evaluate at
+    // compile time when sanitizers are enabled.
+    [[nodiscard]] constexpr bool contains(K key) const noexcept {
+        if constexpr (N == 0) {
+            return false;
+        } else {
+            return keys_[slot(multiplier_, key)] == key;
+        }
+    }
+
+    [[nodiscard]] constexpr const V& at(K key) const {
+        const V* value = find(key);
+        if (value == nullptr) {
+            throw std::out_of_range("static_map key not found");
+        }
+        return *value;
+    }
+
+  private:
+    static constexpr std::size_t slot(std::uint64_t multiplier, K key) noexcept {
+        return static_cast<std::size_t>((detail::hash_bits(key) * multiplier) >> shift);
+    }
+
+    std::uint64_t multiplier_ = 0;
+    std::array<K, Slots> keys_{};
+    std::array<V, Slots> values_{};
+};
+
+namespace detail {
+
+struct alignas(64) bloom_block {
+    std::array<std::uint64_t, 8> words;
+};
+
+// Each of the 8 words of a block gets one bit per key, picked by the top 6 bits of the
+// low half of the hash times a different odd constant.
+inline constexpr std::array<std::uint32_t, 8> bloom_salts{
+    0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+    0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+
+// The mean number of keys per block at which a blocked Bloom filter has the given false
+// positive rate. A block holding j keys has a word bit set with probability
+// 1 - (63/64)^j, and the keys per block follow a Poisson distribution.
+inline double bloom_keys_per_block(double false_positive_rate) {
+    const auto rate_at = [](double load) {
+        double term = std::exp(-load);
+        double clear = 1.0;
+        double rate = 0.0;
+        for (std::size_t j = 1; j < 1024; ++j) {
+            term *= load / static_cast<double>(j);
+            clear *= 63.0 / 64.0;
+            const double set = 1.0 - clear;
+            const double set2 = set * set;
+            const double set4 = set2 * set2;
+            rate += term * set4 * set4;
+        }
+        return rate;
+    };
+    double low = 0.0;
+    double high = 256.0;
+    for (int i = 0; i < 64; ++i) {
+        const double mid = (low + high) / 2;
+        if (rate_at(mid) <= false_positive_rate) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+struct bloom_kernel {
+    // The block is picked from the high half of the hash, so the low half is free for
+    // the bits within it.
+    STIPP_KERNEL static std::size_t block_of(std::uint64_t hashed,
+                                             std::size_t block_count) noexcept {
+        return static_cast<std::size_t>(((hashed >> 32) * block_count) >> 32);
+    }
+
+    STIPP_KERNEL static std::uint64_t bit_of(std::uint64_t hashed,
+                                             std::size_t word) noexcept {
+        const auto low = static_cast<std::uint32_t>(hashed);
+        const auto product = static_cast<std::uint32_t>(low * bloom_salts[word]);
+        return std::uint64_t{1} << (product >> 26);
+    }
+
+    STIPP_KERNEL static bool test(const bloom_block& block, std::uint64_t hashed) noexcept {
+        bool found = true;
+        for (std::size_t w = 0; w < block.words.size(); ++w) {
+            found &= (block.words[w] & bit_of(hashed, w)) != 0;
+        }
+        return found;
+    }
+
+#if STIPP_X86_DISPATCH
+    // The 8 bit positions of a key, one per 32-bit lane.
+    STIPP_TARGET_AVX2 static __m256i positions(std::uint64_t hashed) noexcept {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        const auto* salts = reinterpret_cast<const __m256i*>(bloom_salts.data());
+        const __m256i low = _mm256_set1_epi32(static_cast<int>(hashed & 0xffffffff));
+        return _mm256_srli_epi32(_mm256_mullo_epi32(low, _mm256_loadu_si256(salts)), 26);
+    }
+
+    STIPP_TARGET_AVX2 static bool test_avx2(const bloom_block& block,
+                                            std::uint64_t hashed) noexcept {
+        const __m256i lanes = positions(hashed);
+        const __m256i one = _mm256_set1_epi64x(1);
+        const __m128i first = _mm256_castsi256_si128(lanes);
+        const __m128i second = _mm256_extracti128_si256(lanes, 1);
+        const __m256i low = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(first));
+        const __m256i high = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(second));
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        const auto* words = reinterpret_cast<const __m256i*>(block.words.data());
+        return (_mm256_testc_si256(_mm256_load_si256(words), low) &
+                _mm256_testc_si256(_mm256_load_si256(words + 1), high)) != 0;
+    }
+
+    // One register holds the whole block. The maskz forms avoid false uninitialized
+    // warnings from GCC 12's unmasked ones.
+    STIPP_TARGET_AVX512 static bool test_avx512(const bloom_block& block,
+                                                std::uint64_t hashed) noexcept {
+        const __m512i lanes = _mm512_maskz_cvtepu32_epi64(0xff, positions(hashed));
+        const __m512i bits = _mm512_maskz_sllv_epi64(0xff, _mm512_set1_epi64(1), lanes);
+        const __m512i words = _mm512_load_si512(block.words.data());
+        return _mm512_test_epi64_mask(words, bits) == 0xff;
+    }
+#endif
+
+    // Hashes a batch of keys and prefetches their blocks before testing any of them, so
+    // the cache misses of independent lookups overlap.
+    template <cpu_level Level, typename T, typename Hash>
+    STIPP_KERNEL static std::size_t contains(std::span<const T> keys,
+                                             bool* out,
+                                             const bloom_block* blocks,
+                                             std::size_t block_count,
+                                             const Hash& hasher) noexcept {
+        constexpr std::size_t batch = 16;
+        std::array<std::uint64_t, batch> hashes{};
+        std::size_t found = 0;
+        for (std::size_t first = 0; first < keys.size(); first += batch) {
+            const std::size_t count = (std::min)(batch, keys.size() - first);
+            for (std::size_t i = 0; i < count; ++i) {
+                hashes[i] = static_cast<std::uint64_t>(hasher(keys[first + i]));
+                prefetch(blocks + block_of(hashes[i], block_count));
+            }
+            for (std::size_t i = 0; i < count; ++i) {
+                const bloom_block& block = blocks[block_of(hashes[i], block_count)];
+                bool hit = false;
+#if STIPP_X86_DISPATCH
+                if constexpr (Level >= cpu_level::avx512) {
+                    hit = test_avx512(block, hashes[i]);
+                } else if constexpr (Level >= cpu_level::avx2) {
+                    hit = test_avx2(block, hashes[i]);
+                } else {
+                    hit = test(block, hashes[i]);
+                }
+#else
+                hit = test(block, hashes[i]);
+#endif
+                out[first + i] = hit;
+                found += static_cast<std::size_t>(hit);
+            }
+        }
+        return found;
+    }
+
+    template <typename T, typename Hash>
+    STIPP_KERNEL std::size_t operator()(std::span<const T> keys,
+                                        bool* out,
+                                        const bloom_block* blocks,
+                                        std::size_t block_count,
+                                        Hash hasher) const noexcept {
+        return contains<cpu_level::baseline>(keys, out, blocks, block_count, hasher);
+    }
+
+#if STIPP_X86_DISPATCH
+    template <typename T, typename Hash>
+    STIPP_TARGET_AVX2 std::size_t avx2(std::span<const T> keys,
+                                       bool* out,
+                                       const bloom_block* blocks,
+                                       std::size_t block_count,
+                                       Hash hasher) const noexcept {
+        return contains<cpu_level::avx2>(keys, out, blocks, block_count, hasher);
+    }
+
+    template <typename T, typename Hash>
+    STIPP_TARGET_AVX512 std::size_t avx512(std::span<const T> keys,
+                                           bool* out,
+                                           const bloom_block* blocks,
+                                           std::size_t block_count,
+                                           Hash hasher) const noexcept {
+        return contains<cpu_level::avx512>(keys, out, blocks, block_count, hasher);
+    }
+#endif
+};
+
+} // namespace detail
+
+// Bloom filter whose probes for a key all fall in one 64-byte block: a key sets one bit
+// in each of the 8 words of its block, so a query costs one cache miss, and contains_n
+// tests the 8 bits at once with AVX2 or AVX-512. It is sized for an expected number of
+// keys and a false positive rate, and uses a little more space than a standard Bloom
+// filter for the same rate, about 10 bits per key for 1%.
+template <detail::hashable T, typename Hash = hash<T>>
+class blocked_bloom {
+  public:
+    using key_type = T;
+
+    blocked_bloom() : blocked_bloom(0) {}
+
+    // Throws std::invalid_argument unless false_positive_rate is between 0 and 1.
+    explicit blocked_bloom(std::size_t expected_count,
+                           double false_positive_rate = 0.01,
+                           const Hash& hash = {})
+        : hash_(hash) {
+        if (!(false_positive_rate > 0.0 && false_positive_rate < 1.0)) {
+            throw std::invalid_argument(
+                "blocked_bloom false positive rate is not between 0 and 1");
+        }
+        const double blocks = std::ceil(static_cast<double>(expected_count) /
+                                        detail::bloom_keys_per_block(false_positive_rate));
+        if (!(blocks < 0x1p32)) {
+            throw std::length_error("blocked_bloom size is too large");
+        }
+        blocks_.resize((std::max)(static_cast<std::size_t>(blocks), std::size_t{1}));
+    }
+
+    void insert(T key) noexcept {
+        const auto hashed = static_cast<std::uint64_t>(hash_(key));
+        detail::bloom_block& block = blocks_[block_of(hashed)];
+        for (std::size_t w = 0; w < block.words.size(); ++w) {
+            block.words[w] |= detail::bloom_kernel::bit_of(hashed, w);
+        }
+    }
+
+    // False only if key was never inserted.
+    [[nodiscard]] bool contains(T key) const noexcept {
+        const auto hashed = static_cast<std::uint64_t>(hash_(key));
+        return detail::bloom_kernel::test(blocks_[block_of(hashed)], hashed);
+    }
+
+    // Writes whether each key may have been inserted and returns how many may have been.
+    std::size_t contains_n(std::span<const T> keys, std::span<bool> out) const {
+        detail::check_output_size(
+            keys.size(), out.size(),
+            "blocked_bloom contains_n output span is smaller than its input");
+        return detail::dispatch(detail::bloom_kernel{}, keys, out.data(), blocks_.data(),
+                                blocks_.size(), hash_);
+    }
+
+    void clear() noexcept {
+        std::fill(blocks_.begin(), blocks_.end(), detail::bloom_block{});
+    }
+
+    [[nodiscard]] std::size_t block_count() const noexcept { return blocks_.size(); }
+
+    [[nodiscard]] std::size_t memory_bytes() const noexcept {
+        return blocks_.size() * sizeof(detail::bloom_block);
+    }
+
+  private:
+    std::size_t block_of(std::uint64_t hashed) const noexcept {
+        return detail::bloom_kernel::block_of(hashed, blocks_.size());
+    }
+
+    std::vector<detail::bloom_block> blocks_;
+    Hash hash_;
+};
+
+// Cuckoo filter, which unlike a Bloom filter can erase keys. A key is kept as a u8 or u16
+// fingerprint in one of two buckets of 4 slots, the second found from the first and the
+// fingerprint alone, so a fingerprint can be moved to its other bucket to make room. A
+// bucket is one 32 or 64-bit word whose 4 fingerprints are compared at once. The false
+// positive rate is set by the fingerprint size: at most about 3% for u8 and 0.012% for
+// u16, at 8 or 16 bits per slot. The filter holds up to about 95% of its slots.
+template <detail::hashable T, typename Fingerprint = u16, typename Hash = hash<T>>
+    requires std::same_as<Fingerprint, u8> || std::same_as<Fingerprint, u16>
+class cuckoo_filter {
+    using bucket_type =
+        std::conditional_t<std::same_as<Fingerprint, u8>, std::uint32_t, std::uint64_t>;
+
+    static constexpr unsigned bits = sizeof(Fingerprint) * 8;
+    static constexpr std::size_t slots = 4;
+    static constexpr std::size_t max_kicks = 500;
+    static constexpr bucket_type slot_mask = (bucket_type{1} << bits) - 1;
+    static constexpr bucket_type low_ones = ~bucket_type{0} / slot_mask;
+    static constexpr bucket_type high_ones = low_ones << (bits - 1);
+
+  public:
+    using key_type = T;
+
+    static constexpr double false_positive_rate =
+        2.0 * slots / static_cast<double>(slot_mask);
+
+    cuckoo_filter() : cuckoo_filter(0) {}
+
+    explicit cuckoo_filter(std::size_t capacity, const Hash& hash = {}) : hash_(hash) {
+        std::size_t buckets = std::bit_ceil((std::max)((capacity + slots - 1) / slots,
+                                                       std::size_t{1}));
+        if (capacity > buckets * slots / 20 * 19) {
+            buckets *= 2;
+        }
+        buckets_.resize(buckets);
+    }
+
+    // Returns false if the filter is too full to take key. A key that displaces another
+    // which then has nowhere to go is still added, and the displaced fingerprint is kept
+    // aside, but until an erase makes room every later insert fails.
+    bool insert(T key) {
+        if (victim_.fingerprint != 0) {
+            return false;
+        }
+        const auto hashed = static_cast<std::uint64_t>(hash_(key));
+        add(index_of(hashed), fingerprint_of(hashed));
+        ++size_;
+        return true;
+    }
+
+    // Removes one copy of key. Only keys that were inserted may be erased: erasing
+    // another key can remove the fingerprint of an inserted key that collides with it.
+    bool erase(T key) noexcept {
+        const auto hashed = static_cast<std::uint64_t>(hash_(key));
+        const std::size_t first = index_of(hashed);
+        const bucket_type fingerprint = fingerprint_of(hashed);
+        const std::size_t second = alternate(first, fingerprint);
+        if (remove(first, fingerprint) || remove(second, fingerprint)) {
+            --size_;
+            if (victim_.fingerprint != 0) {
+                const victim displaced = std::exchange(victim_, victim{});
+                add(displaced.index, displaced.fingerprint);
+            }
+            return true;
+        }
+        if (victim_.fingerprint == fingerprint &&
+            (victim_.index == first || victim_.index == second)) {
+            victim_ = victim{};
+            --size_;
+            return true;
+        }
+        return false;
+    }
+
+    // False only if key was never inserted, or has been erased as often as inserted.
+    [[nodiscard]] bool contains(T key) const noexcept {
+        const auto hashed = static_cast<std::uint64_t>(hash_(key));
+        return contains(index_of(hashed), fingerprint_of(hashed));
+    }
+
+    // Writes whether each key may be in the filter and returns how many may be. A batch
+    // of keys is hashed and both buckets of each prefetched before any is tested.
+    std::size_t contains_n(std::span<const T> keys, std::span<bool> out) const {
+        detail::check_output_size(
+            keys.size(), out.size(),
+            "cuckoo_filter contains_n output span is smaller than its input");
+        constexpr std::size_t batch = 16;
+        std::array<std::uint64_t, batch> hashes{};
+        std::size_t found = 0;
+        for (std::size_t first = 0; first < keys.size(); first += batch) {
+            const std::size_t count = (std::min)(batch, keys.size() - first);
+            for (std::size_t i = 0; i < count; ++i) {
+                hashes[i] = static_cast<std::uint64_t>(hash_(keys[first + i]));
+                const std::size_t index = index_of(hashes[i]);
+                detail::prefetch(buckets_.data() + index);
+                detail::prefetch(buckets_.data() +
+                                 alternate(index, fingerprint_of(hashes[i])));
+            }
+            for (std::size_t i = 0; i < count; ++i) {
+                const bool hit = contains(index_of(hashes[i]), fingerprint_of(hashes[i]));
+                out[first + i] = hit;
+                found += static_cast<std::size_t>(hit);
+            }
+        }
+        return found;
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept { return size_; }
+
+    [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+
+    [[nodiscard]] std::size_t capacity() const noexcept { return buckets_.size() * slots; }
+
+    void clear() noexcept {
+        std::fill(buckets_.begin(), buckets_.end(), bucket_type{0});
+        victim_ = victim{};
+        size_ = 0;
+    }
+
+    [[nodiscard]] std::size_t memory_bytes() const noexcept {
+        return buckets_.size() * sizeof(bucket_type);
+    }
+
+  private:
+    // A fingerprint that has no room in either of its buckets. Zero marks an empty slot,
+    // so no fingerprint is zero.
+    struct victim {
+        std::size_t index = 0;
+        bucket_type fingerprint = 0;
+    };
+
+    std::size_t index_of(std::uint64_t hashed) const noexcept {
+        return static_cast<std::size_t>(hashed) & (buckets_.size() - 1);
+    }
+
+    static bucket_type fingerprint_of(std::uint64_t hashed) noexcept {
+        const auto fingerprint = static_cast<bucket_type>(hashed >> (64 - bits));
+        return fingerprint == 0 ? 1 : fingerprint;
+    }
+
+    // The other bucket of a fingerprint in bucket index. Applied twice it gives index
+    // back, which is what lets a fingerprint move without its key.
+    std::size_t alternate(std::size_t index, bucket_type fingerprint) const noexcept {
+        const auto scrambled = static_cast<std::size_t>(fingerprint * 0x5bd1e995U);
+        return (index ^ scrambled) & (buckets_.size() - 1);
+    }
+
+    // Whether any slot of bucket holds fingerprint: XOR clears the matching slot, and a
+    // zero slot is the only one whose high bit borrowing leaves set.
+    static bool holds(bucket_type bucket, bucket_type fingerprint) noexcept {
+        const bucket_type x = bucket ^ (fingerprint * low_ones);
+        return ((x - low_ones) & ~x & high_ones) != 0;
+    }
+
+    bool contains(std::size_t index, bucket_type fingerprint) const noexcept {
+        return holds(buckets_[index], fingerprint) ||
+               holds(buckets_[alternate(index, fingerprint)], fingerprint) ||
+               (victim_.fingerprint == fingerprint &&
+                (victim_.index == index || victim_.index == alternate(index, fingerprint)));
+    }
+
+    bool place(std::size_t index, bucket_type fingerprint) noexcept {
+        bucket_type& bucket = buckets_[index];
+        for (std::size_t s = 0; s < slots; ++s) {
+            if (((bucket >> (s * bits)) & slot_mask) == 0) {
+                bucket |= fingerprint << (s * bits);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool remove(std::size_t index, bucket_type fingerprint) noexcept {
+        bucket_type& bucket = buckets_[index];
+        for (std::size_t s = 0; s < slots; ++s) {
+            if (((bucket >> (s * bits)) & slot_mask) == fingerprint) {
+                bucket &= ~(slot_mask << (s * bits));
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Places fingerprint in either of its buckets, or else evicts a random fingerprint
+    // from one to its other bucket, and so on. The last one evicted is kept aside.
+    void add(std::size_t index, bucket_type fingerprint) noexcept {
+        if (place(index, fingerprint)) {
+            return;
+        }
+        index = alternate(index, fingerprint);
+        if (place(index, fingerprint)) {
+            return;
+        }
+        if ((detail::splitmix64(++kicks_) & 1) != 0) {
+            index = alternate(index, fingerprint);
+        }
+        for (std::size_t kick = 0; kick < max_kicks; ++kick) {
+            const std::size_t shift = detail::splitmix64(++kicks_) % slots * bits;
+            bucket_type& bucket = buckets_[index];
+            const bucket_type evicted = (bucket >> shift) & slot_mask;
+            bucket = (bucket & ~(slot_mask << shift)) | (fingerprint << shift);
+            fingerprint = evicted;
+            index = alternate(index, fingerprint);
+            if (place(index, fingerprint)) {
+                return;
+            }
+        }
+        victim_ = victim{index, fingerprint};
+    }
+
+    std::vector<bucket_type> buckets_;
+    victim victim_;
+    std::size_t size_ = 0;
+    std::uint64_t kicks_ = 0;
+    Hash hash_;
+};
+
+} // namespace stipp
+
+template <typename Tag, typename Repr>
+struct std::hash<stipp::strong_id<Tag, Repr>> : std::hash<Repr> {
+    std::size_t operator()(stipp::strong_id<Tag, Repr> id) const noexcept {
+        return std::hash<Repr>::operator()(id.value());
+    }
+};
+
+#if __has_include(<format>)
+
+template <typename Tag, typename Repr>
+struct std::formatter<stipp::strong_id<Tag, Repr>> : std::formatter<Repr> {
+    template <typename FmtCtx>
+    constexpr auto format(stipp::strong_id<Tag, Repr> id, FmtCtx& ctx) const {
+        return std::formatter<Repr>::format(id.value(), ctx);
+    }
+};
+
+#endif
+
+#undef STIPP_ASSUME
+#undef STIPP_VECTOR_EXT
+#undef STIPP_KERNEL
+#undef STIPP_X86_DISPATCH
+#undef STIPP_TARGET_SSE4_2
+#undef STIPP_TARGET_AVX2
+#undef STIPP_TARGET_AVX512
+#undef STIPP_SSE2
+
 #endif
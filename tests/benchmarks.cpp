@@ -0,0 +1,956 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <stipp.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+using namespace stipp::types;
+using namespace stipp::literals;
+
+namespace {
+
+constexpr std::size_t bench_size = 1 << 16;
+
+template <typename T>
+std::vector<T> make_values(double scale) {
+    std::vector<T> ret{};
+    ret.reserve(bench_size);
+    for (std::size_t i = 0; i < bench_size; ++i) {
+        ret.emplace_back(static_cast<double>(i % 1000) * scale);
+    }
+    return ret;
+}
+
+template <typename T>
+T dot_ref(std::span<const T> lhs, std::span<const T> rhs) {
+    T acc{};
+    for (std::size_t i = 0; i < lhs.size(); ++i) {
+        acc += lhs[i] * rhs[i];
+    }
+    return acc;
+}
+
+template <typename T>
+void axpy_ref(std::span<T> acc, std::span<const T> x, T k) {
+    for (std::size_t i = 0; i < acc.size(); ++i) {
+        acc[i] += x[i] * k;
+    }
+}
+
+template <std::size_t N>
+u8 max_simd(std::span<const u8> values) {
+    using vec = stipp::simd<u8, N>;
+    vec acc{0_u8};
+    for (std::size_t i = 0; i + N <= values.size(); i += N) {
+        acc = max(acc, vec::load(values.subspan(i)));
+    }
+    return reduce_max(acc);
+}
+
+u8 max_scalar(std::span<const u8> values) {
+    u8 acc = 0_u8;
+    for (auto value : values) {
+        acc = value > acc ? value : acc;
+    }
+    return acc;
+}
+
+#ifdef __SSE2__
+std::uint8_t max_sse2(std::span<const std::uint8_t> values) {
+    __m128i acc = _mm_setzero_si128();
+    for (std::size_t i = 0; i + 16 <= values.size(); i += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&values[i]));
+        acc = _mm_max_epu8(acc, v);
+    }
+    std::uint8_t lanes[16];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc);
+    std::uint8_t ret = 0;
+    for (auto lane : lanes) {
+        ret = lane > ret ? lane : ret;
+    }
+    return ret;
+}
+#endif
+
+#ifdef __AVX2__
+std::uint8_t max_avx2(std::span<const std::uint8_t> values) {
+    __m256i acc = _mm256_setzero_si256();
+    for (std::size_t i = 0; i + 32 <= values.size(); i += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&values[i]));
+        acc = _mm256_max_epu8(acc, v);
+    }
+    std::uint8_t lanes[32];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), acc);
+    std::uint8_t ret = 0;
+    for (auto lane : lanes) {
+        ret = lane > ret ? lane : ret;
+    }
+    return ret;
+}
+#endif
+
+template <typename T>
+std::vector<T> make_column() {
+    std::vector<T> ret(bench_size);
+    for (std::size_t i = 0; i < bench_size; ++i) {
+        ret[i] = static_cast<T>(static_cast<stipp::detail::repr_t<T>>(i * 2654435761U));
+    }
+    return ret;
+}
+
+template <typename T>
+void bench_reductions(const char* name) {
+    using acc_type = stipp::sum_t<T>;
+    using acc_repr = stipp::detail::repr_t<acc_type>;
+    const auto column = make_column<T>();
+    const std::span<const T> values(column);
+
+    BENCHMARK(std::string("reduce_sum ") + name) { return stipp::reduce_sum(values); };
+    BENCHMARK(std::string("reduce_sum_checked ") + name) {
+        return stipp::reduce_sum_checked(values);
+    };
+    BENCHMARK(std::string("static_cast sum ") + name) {
+        acc_repr acc{0};
+        for (const T value : values) {
+            acc = static_cast<acc_repr>(acc + static_cast<acc_repr>(value));
+        }
+        return acc;
+    };
+    BENCHMARK(std::string("reduce_minmax ") + name) {
+        return stipp::reduce_minmax(values);
+    };
+    BENCHMARK(std::string("argmin ") + name) { return stipp::argmin(values); };
+    BENCHMARK(std::string("std::min_element ") + name) {
+        return std::min_element(values.begin(), values.end()) - values.begin();
+    };
+}
+
+template <typename Hash>
+std::size_t probe_table(std::span<const u64> keys, Hash hasher) {
+    const std::size_t mask = std::bit_ceil(keys.size() * 2) - 1;
+    std::vector<u64> slots(mask + 1, (std::numeric_limits<u64>::max)());
+    std::size_t probes = 0;
+    for (const auto key : keys) {
+        std::size_t slot = hasher(key) & mask;
+        while (slots[slot] != (std::numeric_limits<u64>::max)()) {
+            slot = (slot + 1) & mask;
+            ++probes;
+        }
+        slots[slot] = key;
+    }
+    return probes;
+}
+
+} // namespace
+
+TEST_CASE("fixed multiply-accumulate", "[fixed]") {
+    using q16 = stipp::fixed<i32, 16>;
+
+    const auto lhs_q16 = make_values<q16>(0.001);
+    const auto rhs_q16 = make_values<q16>(0.002);
+    auto acc_q16 = make_values<q16>(0.003);
+    const auto lhs_f = make_values<float>(0.001);
+    const auto rhs_f = make_values<float>(0.002);
+    auto acc_f = make_values<float>(0.003);
+    const auto lhs_d = make_values<double>(0.001);
+    const auto rhs_d = make_values<double>(0.002);
+    auto acc_d = make_values<double>(0.003);
+
+    BENCHMARK("dot fixed<i32, 16>") { return dot(lhs_q16, rhs_q16); };
+    BENCHMARK("dot float") { return dot_ref<float>(lhs_f, rhs_f); };
+    BENCHMARK("dot double") { return dot_ref<double>(lhs_d, rhs_d); };
+
+    BENCHMARK("axpy fixed<i32, 16>") {
+        axpy(acc_q16, lhs_q16, q16{0.5});
+        return acc_q16.front();
+    };
+    BENCHMARK("axpy float") {
+        axpy_ref<float>(acc_f, lhs_f, 0.5F);
+        return acc_f.front();
+    };
+    BENCHMARK("axpy double") {
+        axpy_ref<double>(acc_d, lhs_d, 0.5);
+        return acc_d.front();
+    };
+}
+
+TEST_CASE("simd 8-bit lanes", "[simd]") {
+    std::vector<u8> values(bench_size);
+    for (std::size_t i = 0; i < bench_size; ++i) {
+        values[i] = static_cast<u8>(static_cast<std::uint8_t>(i * 31 + 7));
+    }
+    std::vector<std::uint8_t> raw(bench_size);
+    std::memcpy(raw.data(), values.data(), bench_size);
+
+    BENCHMARK("max u8 scalar") { return max_scalar(values); };
+    BENCHMARK("max simd<u8, 16>") { return max_simd<16>(values); };
+#ifdef __SSE2__
+    BENCHMARK("max u8 SSE2 intrinsics") { return max_sse2(raw); };
+#endif
+#ifdef __AVX2__
+    BENCHMARK("max simd<u8, 32>") { return max_simd<32>(values); };
+    BENCHMARK("max u8 AVX2 intrinsics") { return max_avx2(raw); };
+#endif
+}
+
+TEST_CASE("span reductions", "[reduce]") {
+    bench_reductions<u8>("u8");
+    bench_reductions<u16>("u16");
+    bench_reductions<u32>("u32");
+    bench_reductions<u64>("u64");
+    bench_reductions<i16>("i16");
+    bench_reductions<i32>("i32");
+    bench_reductions<i64>("i64");
+}
+
+TEST_CASE("span conversions", "[convert]") {
+    const auto bytes = make_column<u8>();
+    std::vector<u64> words(bench_size);
+    for (std::size_t i = 0; i < bench_size; ++i) {
+        words[i] = u64{i * 1000};
+    }
+    std::vector<u32> out(bench_size);
+
+    BENCHMARK("convert u8 -> u32") {
+        stipp::convert(std::span<const u8>(bytes), std::span<u32>(out));
+        return out.back();
+    };
+    BENCHMARK("static_cast u8 -> u32") {
+        for (std::size_t i = 0; i < bench_size; ++i) {
+            out[i] = static_cast<u32>(static_cast<std::uint8_t>(bytes[i]));
+        }
+        return out.back();
+    };
+    BENCHMARK("narrow_checked u64 -> u32") {
+        return stipp::narrow_checked(std::span<const u64>(words), std::span<u32>(out));
+    };
+    BENCHMARK("narrow_saturating u64 -> u32") {
+        return stipp::narrow_saturating(std::span<const u64>(words), std::span<u32>(out));
+    };
+    BENCHMARK("static_cast u64 -> u32") {
+        for (std::size_t i = 0; i < bench_size; ++i) {
+            out[i] = static_cast<u32>(static_cast<std::uint32_t>(words[i]));
+        }
+        return out.back();
+    };
+}
+
+TEST_CASE("u8 x i8 dot products", "[dot]") {
+    constexpr std::size_t rows = 256;
+    constexpr std::size_t cols = 1024;
+    const auto x = make_column<u8>();
+    const auto weights = make_column<i8>();
+    std::vector<i8> matrix(rows * cols);
+    for (std::size_t i = 0; i < matrix.size(); ++i) {
+        matrix[i] = weights[i % weights.size()];
+    }
+    std::vector<i32> y(rows);
+
+    BENCHMARK("dot u8 x i8") { return stipp::dot(x, weights); };
+    BENCHMARK("dot u8 x i8 widening casts") {
+        std::int32_t acc = 0;
+        for (std::size_t i = 0; i < bench_size; ++i) {
+            acc += static_cast<std::int32_t>(static_cast<std::uint8_t>(x[i])) *
+                   static_cast<std::int32_t>(static_cast<std::int8_t>(weights[i]));
+        }
+        return acc;
+    };
+    BENCHMARK("gemv 256 x 1024 u8 x i8") {
+        stipp::gemv(matrix, std::span<const u8>(x).first(cols), y);
+        return y.front();
+    };
+}
+
+TEST_CASE("column selection", "[select]") {
+    const auto column = make_column<u32>();
+    const auto payload = make_column<i64>();
+    const std::span<const u32> values(column);
+    const u32 threshold{0x8000'0000U};
+    std::vector<u32> sel(bench_size);
+    std::vector<i64> out(bench_size);
+
+    BENCHMARK("select_indices u32 50%") {
+        return stipp::select_indices(values, stipp::compare_op::lt, threshold,
+                                     std::span(sel));
+    };
+    BENCHMARK("branching select u32 50%") {
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < bench_size; ++i) {
+            if (column[i] < threshold) {
+                sel[count++] = u32{static_cast<std::uint32_t>(i)};
+            }
+        }
+        return count;
+    };
+
+    const auto count =
+        stipp::select_indices(values, stipp::compare_op::lt, threshold, std::span(sel));
+    const std::span<const u32> selected = std::span<const u32>(sel).first(count);
+    BENCHMARK("gather i64 50%") {
+        stipp::gather(std::span<const i64>(payload), selected, std::span(out));
+        return out.front();
+    };
+}
+
+TEST_CASE("histograms", "[histogram]") {
+    constexpr std::size_t size = std::size_t{1} << 24;
+    std::vector<u8> random(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        random[i] = u8{static_cast<std::uint8_t>((i * 2654435761U) >> 13)};
+    }
+    const std::vector<u8> constant(size, 7_u8);
+    const auto words = make_column<u16>();
+
+    BENCHMARK("histogram u8 16 MiB random") { return stipp::histogram(random)[0]; };
+    BENCHMARK("histogram u8 16 MiB constant") { return stipp::histogram(constant)[7]; };
+    BENCHMARK("naive histogram u8 16 MiB constant") {
+        std::array<std::uint64_t, 256> counts{};
+        for (const auto byte : constant) {
+            ++counts[static_cast<std::uint8_t>(byte)];
+        }
+        return counts[7];
+    };
+    BENCHMARK("histogram u8 16 MiB constant all threads") {
+        return stipp::histogram(constant, 0)[7];
+    };
+    BENCHMARK("histogram u16") { return stipp::histogram(words)[0]; };
+}
+
+TEST_CASE("prefix sums", "[scan]") {
+    const auto lengths = make_column<u32>();
+    const std::span<const u32> src(lengths);
+    std::vector<u64> offsets(bench_size);
+    std::vector<u32> narrow(bench_size);
+
+    BENCHMARK("inclusive_scan u32 -> u64") {
+        return stipp::inclusive_scan(src, std::span(offsets));
+    };
+    BENCHMARK("inclusive_scan u32 -> u32") {
+        return stipp::inclusive_scan(src, std::span(narrow));
+    };
+    BENCHMARK("inclusive_scan_checked u32 -> u64") {
+        return stipp::inclusive_scan_checked(src, std::span(offsets));
+    };
+    BENCHMARK("std::partial_sum u32 -> u64") {
+        std::uint64_t acc = 0;
+        for (std::size_t i = 0; i < bench_size; ++i) {
+            acc += static_cast<std::uint32_t>(lengths[i]);
+            offsets[i] = u64{acc};
+        }
+        return acc;
+    };
+
+    constexpr std::size_t big_size = std::size_t{1} << 25;
+    const std::vector<u32> big(big_size, 3_u32);
+    std::vector<u64> big_offsets(big_size);
+    for (const std::size_t threads : {1U, 2U, 4U}) {
+        BENCHMARK("exclusive_scan 32 Mi u32 -> u64 threads " + std::to_string(threads)) {
+            return stipp::exclusive_scan(std::span<const u32>(big), std::span(big_offsets),
+                                         threads);
+        };
+    }
+}
+
+TEST_CASE("parallel scaling", "[parallel]") {
+    constexpr std::size_t size = std::size_t{1} << 25;
+    std::vector<u32> src(size);
+    std::vector<u64> dst(size);
+    const auto cores = (std::max)(std::thread::hardware_concurrency(), 1U);
+
+    for (std::size_t threads = 1; threads <= cores; threads *= 2) {
+        stipp::thread_pool pool(threads);
+        stipp::parallel_fill(std::span(src), 3_u32, pool);
+        stipp::parallel_fill(std::span(dst), 0_u64, pool);
+        const std::string suffix = " 32 Mi u32 threads " + std::to_string(threads);
+
+        BENCHMARK("parallel_reduce" + suffix) {
+            return stipp::parallel_reduce(
+                std::span<const u32>(src), 0_u64,
+                [](u64 acc, u32 x) { return acc + static_cast<u64>(x); },
+                [](u64 lhs, u64 rhs) { return lhs + rhs; }, pool);
+        };
+        BENCHMARK("parallel_transform to u64" + suffix) {
+            stipp::parallel_transform(std::span<const u32>(src), std::span(dst),
+                                      [](u32 x) { return static_cast<u64>(x); }, pool);
+            return dst.back();
+        };
+    }
+}
+
+TEST_CASE("hashing", "[hash]") {
+    const auto keys = make_column<u64>();
+    std::vector<u64> strided(bench_size);
+    for (std::size_t i = 0; i < bench_size; ++i) {
+        strided[i] = u64{i << 12};
+    }
+    std::vector<u64> hashes(bench_size);
+    const stipp::seeded_hash<u64> seeded;
+
+    BENCHMARK("hash_n u64") {
+        stipp::hash_n(std::span<const u64>(keys), std::span(hashes));
+        return hashes.back();
+    };
+    BENCHMARK("hash_n u64 seeded") {
+        stipp::hash_n(std::span<const u64>(keys), std::span(hashes), seeded);
+        return hashes.back();
+    };
+    BENCHMARK("std::hash u64 loop") {
+        for (std::size_t i = 0; i < bench_size; ++i) {
+            hashes[i] = u64{std::hash<u64>{}(keys[i])};
+        }
+        return hashes.back();
+    };
+
+    // Inserting multiples of 4096 into a linear probing table at load factor 0.5. The
+    // extra probes are part of the name, as the identity std::hash makes each insert
+    // probe past all the earlier keys.
+    const std::span<const u64> few = std::span<const u64>(strided).first(4096);
+    const auto name = [](const char* hash, std::size_t count, std::size_t probes) {
+        return "linear probing " + std::to_string(count) + " strided u64 " + hash + " (" +
+               std::to_string(probes) + " extra probes)";
+    };
+    BENCHMARK(name("stipp::hash", few.size(), probe_table(few, stipp::hash<u64>{}))) {
+        return probe_table(few, stipp::hash<u64>{});
+    };
+    BENCHMARK(name("std::hash", few.size(), probe_table(few, std::hash<u64>{}))) {
+        return probe_table(few, std::hash<u64>{});
+    };
+}
+
+TEST_CASE("flat hash tables", "[flat]") {
+    // A million entries keep every table well out of cache. Half of the looked up keys
+    // are missing.
+    constexpr std::size_t table_size = 1 << 20;
+    const auto key_at = [](std::size_t i) { return u64{stipp::detail::splitmix64(i)}; };
+    std::vector<u64> lookups(bench_size);
+    for (std::size_t i = 0; i < bench_size; ++i) {
+        lookups[i] = key_at(i * 2654435761U % (2 * table_size));
+    }
+
+    using sentinel_map =
+        stipp::flat_map<u64, u64, stipp::hash<u64>, stipp::empty_key<u64, 0_u64>>;
+    std::unordered_map<u64, u64> node_map;
+    stipp::flat_map<u64, u64> flat;
+    sentinel_map sentinel;
+    for (std::size_t i = 0; i < table_size; ++i) {
+        node_map.emplace(key_at(i), u64{i});
+        flat.try_emplace(key_at(i), u64{i});
+        sentinel.try_emplace(key_at(i), u64{i});
+    }
+
+    const auto sum_found = [&](const auto& map) {
+        std::uint64_t sum = 0;
+        for (const u64 key : lookups) {
+            const auto it = map.find(key);
+            if (it != map.end()) {
+                sum += stipp::detail::to_repr((*it).second);
+            }
+        }
+        return sum;
+    };
+    BENCHMARK("std::unordered_map find") { return sum_found(node_map); };
+    BENCHMARK("flat_map find") { return sum_found(flat); };
+    BENCHMARK("flat_map find (empty key)") { return sum_found(sentinel); };
+
+    std::vector<const u64*> found(bench_size);
+    BENCHMARK("flat_map find_n") {
+        std::as_const(flat).find_n(std::span<const u64>(lookups), std::span(found));
+        std::uint64_t sum = 0;
+        for (const u64* value : found) {
+            sum += value != nullptr ? stipp::detail::to_repr(*value) : 0;
+        }
+        return sum;
+    };
+
+    BENCHMARK("std::unordered_map insert 64Ki") {
+        std::unordered_map<u64, u64> map;
+        for (std::size_t i = 0; i < bench_size; ++i) {
+            map.emplace(key_at(i), u64{i});
+        }
+        return map.size();
+    };
+    BENCHMARK("flat_map insert 64Ki") {
+        stipp::flat_map<u64, u64> map;
+        for (std::size_t i = 0; i < bench_size; ++i) {
+            map.try_emplace(key_at(i), u64{i});
+        }
+        return map.size();
+    };
+}
+
+TEST_CASE("radix sort", "[sort]") {
+    // Each run copies the unsorted keys first, which both variants pay for.
+    const auto bench_sorts = [](const std::string& name, const std::vector<i64>& keys) {
+        std::vector<i64> work(keys.size());
+        const std::string suffix = std::to_string(keys.size()) + ' ' + name;
+        BENCHMARK("std::sort " + suffix) {
+            std::copy(keys.begin(), keys.end(), work.begin());
+            std::sort(work.begin(), work.end());
+            return work.front();
+        };
+        BENCHMARK("radix_sort " + suffix) {
+            std::copy(keys.begin(), keys.end(), work.begin());
+            stipp::radix_sort(std::span(work));
+            return work.front();
+        };
+        BENCHMARK("radix_sort parallel " + suffix) {
+            std::copy(keys.begin(), keys.end(), work.begin());
+            stipp::radix_sort(std::span(work), 0);
+            return work.front();
+        };
+    };
+    for (const std::size_t size : {std::size_t{1024}, bench_size, std::size_t{1} << 20}) {
+        std::vector<i64> uniform(size);
+        std::vector<i64> narrow(size);
+        std::vector<i64> sorted(size);
+        for (std::size_t i = 0; i < size; ++i) {
+            const std::uint64_t bits = stipp::detail::splitmix64(i);
+            uniform[i] = i64{static_cast<std::int64_t>(bits)};
+            narrow[i] = i64{static_cast<std::int64_t>(bits % 100000) - 50000};
+            sorted[i] = i64{static_cast<std::int64_t>(i)};
+        }
+        bench_sorts("uniform i64", uniform);
+        bench_sorts("i64 in +-50000", narrow);
+        bench_sorts("sorted i64", sorted);
+    }
+}
+
+TEST_CASE("static search index", "[search]") {
+    // 16M keys take 64 MiB, so std::lower_bound misses the cache on most of its steps.
+    constexpr std::size_t key_count = std::size_t{1} << 24;
+    std::vector<u32> keys(key_count);
+    for (std::size_t i = 0; i < key_count; ++i) {
+        keys[i] = u32{static_cast<std::uint32_t>(stipp::detail::splitmix64(i))};
+    }
+    std::sort(keys.begin(), keys.end());
+    const stipp::static_search_index<u32> index{std::span<const u32>(keys)};
+    const auto queries = make_column<u32>();
+    std::vector<std::size_t> positions(bench_size);
+
+    BENCHMARK("std::lower_bound u32") {
+        std::size_t sum = 0;
+        for (const u32 query : queries) {
+            const auto it = std::lower_bound(keys.begin(), keys.end(), query);
+            sum += static_cast<std::size_t>(it - keys.begin());
+        }
+        return sum;
+    };
+    BENCHMARK("static_search_index::lower_bound u32") {
+        std::size_t sum = 0;
+        for (const u32 query : queries) {
+            sum += index.lower_bound(query);
+        }
+        return sum;
+    };
+    BENCHMARK("static_search_index::lower_bound_n u32") {
+        index.lower_bound_n(std::span<const u32>(queries), std::span(positions));
+        return positions.back();
+    };
+}
+
+TEST_CASE("sorted set operations", "[set]") {
+    // Posting lists of u32 document ids: one list of 1M ids against lists from equally
+    // long to 1000 times shorter.
+    const auto make_list = [](std::size_t size, std::uint64_t seed) {
+        std::vector<u32> ret(size);
+        for (std::size_t i = 0; i < size; ++i) {
+            const std::uint64_t bits = stipp::detail::splitmix64(seed + i);
+            ret[i] = u32{static_cast<std::uint32_t>(bits >> 40)};
+        }
+        std::sort(ret.begin(), ret.end());
+        ret.erase(std::unique(ret.begin(), ret.end()), ret.end());
+        return ret;
+    };
+    const auto large = make_list(std::size_t{1} << 20, 0);
+    std::vector<u32> out(large.size() * 2);
+    const std::span<const u32> lhs(large);
+    for (const std::size_t ratio : {1U, 10U, 100U, 1000U}) {
+        const auto small = make_list(large.size() / ratio, ratio << 32);
+        const std::span<const u32> rhs(small);
+        const std::string suffix = "1:" + std::to_string(ratio);
+        BENCHMARK("std::set_intersection u32 " + suffix) {
+            return std::set_intersection(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+                                         out.begin()) -
+                   out.begin();
+        };
+        BENCHMARK("set_intersect u32 " + suffix) {
+            return stipp::set_intersect(lhs, rhs, std::span(out));
+        };
+        BENCHMARK("set_intersect_count u32 " + suffix) {
+            return stipp::set_intersect_count(lhs, rhs);
+        };
+        BENCHMARK("std::set_union u32 " + suffix) {
+            return std::set_union(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+                                  out.begin()) -
+                   out.begin();
+        };
+        BENCHMARK("set_union u32 " + suffix) {
+            return stipp::set_union(lhs, rhs, std::span(out));
+        };
+    }
+}
+
+TEST_CASE("roaring bitmaps", "[roaring]") {
+    // User segments over 16M u32 ids: two dense ones that are bitmaps and a sparse one
+    // that is arrays, against sorted vectors of the same ids.
+    const auto make_ids = [](std::size_t size, std::uint64_t seed) {
+        std::vector<u32> ret(size);
+        for (std::size_t i = 0; i < size; ++i) {
+            const std::uint64_t bits = stipp::detail::splitmix64(seed + i);
+            ret[i] = u32{static_cast<std::uint32_t>(bits >> 40)};
+        }
+        std::sort(ret.begin(), ret.end());
+        ret.erase(std::unique(ret.begin(), ret.end()), ret.end());
+        return ret;
+    };
+    const auto dense_ids = make_ids(std::size_t{1} << 21, 0);
+    const auto other_ids = make_ids(std::size_t{1} << 21, 1U << 30);
+    const auto sparse_ids = make_ids(std::size_t{1} << 17, 2U << 30);
+    const stipp::roaring<u32> dense{std::span<const u32>(dense_ids)};
+    const stipp::roaring<u32> other{std::span<const u32>(other_ids)};
+    const stipp::roaring<u32> sparse{std::span<const u32>(sparse_ids)};
+    std::vector<u32> out(dense_ids.size() * 2);
+
+    BENCHMARK("std::set_intersection dense & dense") {
+        return std::set_intersection(dense_ids.begin(), dense_ids.end(), other_ids.begin(),
+                                     other_ids.end(), out.begin()) -
+               out.begin();
+    };
+    BENCHMARK("roaring dense & dense") { return (dense & other).cardinality(); };
+    BENCHMARK("roaring dense | dense") { return (dense | other).cardinality(); };
+    BENCHMARK("roaring dense - dense") { return (dense - other).cardinality(); };
+    BENCHMARK("roaring dense & sparse") { return (dense & sparse).cardinality(); };
+    BENCHMARK("std::set_intersection dense & sparse") {
+        return std::set_intersection(dense_ids.begin(), dense_ids.end(), sparse_ids.begin(),
+                                     sparse_ids.end(), out.begin()) -
+               out.begin();
+    };
+    BENCHMARK("roaring read dense") {
+        auto reader = dense.reader();
+        return reader.next(std::span(out));
+    };
+
+    const auto previous = stipp::active_cpu_level();
+    for (const auto level : {stipp::cpu_level::baseline, stipp::cpu_level::sse4_2,
+                              stipp::cpu_level::avx2, stipp::cpu_level::avx512}) {
+        if (stipp::set_cpu_level(level) != level) {
+            continue;
+        }
+        const auto index = static_cast<std::size_t>(level);
+        const std::string name(stipp::detail::cpu_level_names[index]);
+        BENCHMARK("roaring set_intersect_count dense " + name) {
+            return stipp::set_intersect_count(dense, other);
+        };
+    }
+    stipp::set_cpu_level(previous);
+}
+
+TEST_CASE("rank select bit vectors", "[bitvector]") {
+    // 128M bits at half density take 16 MiB, against 512 MiB for the positions of the set
+    // bits, which answer select by indexing and rank by binary search.
+    constexpr std::size_t word_count = std::size_t{1} << 21;
+    std::vector<u64> words(word_count);
+    std::vector<u64> positions;
+    for (std::size_t i = 0; i < word_count; ++i) {
+        const std::uint64_t bits = stipp::detail::splitmix64(i);
+        words[i] = u64{bits};
+        for (std::uint64_t rest = bits; rest != 0; rest &= rest - 1) {
+            const auto bit = static_cast<unsigned>(std::countr_zero(rest));
+            positions.push_back(u64{i * 64 + bit});
+        }
+    }
+    const stipp::rank_select_bitvector bits{std::span<const u64>(words)};
+    std::vector<std::size_t> rank_queries(bench_size);
+    std::vector<std::size_t> select_queries(bench_size);
+    for (std::size_t i = 0; i < bench_size; ++i) {
+        const std::uint64_t random = stipp::detail::splitmix64(~i);
+        rank_queries[i] = static_cast<std::size_t>(random % bits.size());
+        select_queries[i] = static_cast<std::size_t>(random % bits.count());
+    }
+
+    BENCHMARK("std::lower_bound rank") {
+        std::size_t sum = 0;
+        for (const std::size_t query : rank_queries) {
+            const auto it =
+                std::lower_bound(positions.begin(), positions.end(), u64{query});
+            sum += static_cast<std::size_t>(it - positions.begin());
+        }
+        return sum;
+    };
+    BENCHMARK("positions select") {
+        std::uint64_t sum = 0;
+        for (const std::size_t query : select_queries) {
+            sum += stipp::detail::to_repr(positions[query]);
+        }
+        return sum;
+    };
+
+    const auto previous = stipp::active_cpu_level();
+    for (const auto level : {stipp::cpu_level::baseline, stipp::cpu_level::sse4_2,
+                              stipp::cpu_level::avx2, stipp::cpu_level::avx512}) {
+        if (stipp::set_cpu_level(level) != level) {
+            continue;
+        }
+        const auto index = static_cast<std::size_t>(level);
+        const std::string name(stipp::detail::cpu_level_names[index]);
+        BENCHMARK("rank_select_bitvector::rank1 " + name) {
+            std::size_t sum = 0;
+            for (const std::size_t query : rank_queries) {
+                sum += bits.rank1(query);
+            }
+            return sum;
+        };
+        BENCHMARK("rank_select_bitvector::select1 " + name) {
+            std::size_t sum = 0;
+            for (const std::size_t query : select_queries) {
+                sum += bits.select1(query);
+            }
+            return sum;
+        };
+    }
+    stipp::set_cpu_level(previous);
+}
+
+TEST_CASE("elias fano sequences", "[elias_fano]") {
+    // 4M sorted offsets into 1 TiB, as in an index of a large file. The space each
+    // representation takes per value is part of the names.
+    constexpr std::size_t count = std::size_t{1} << 22;
+    std::vector<u64> offsets(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        offsets[i] = u64{stipp::detail::splitmix64(i) >> 24};
+    }
+    std::sort(offsets.begin(), offsets.end());
+    const stipp::elias_fano<u64> encoded{std::span<const u64>(offsets)};
+    const auto bytes_per_value = [](std::size_t bytes) {
+        return " (" + std::to_string(static_cast<double>(bytes) / count).substr(0, 4) +
+               " bytes per value)";
+    };
+    const std::string raw_space = bytes_per_value(count * sizeof(u64));
+    const std::string encoded_space = bytes_per_value(encoded.memory_bytes());
+    std::vector<std::size_t> indices(bench_size);
+    std::vector<u64> targets(bench_size);
+    for (std::size_t i = 0; i < bench_size; ++i) {
+        const std::uint64_t random = stipp::detail::splitmix64(~i);
+        indices[i] = static_cast<std::size_t>(random % count);
+        targets[i] = u64{random >> 24};
+    }
+
+    BENCHMARK("std::vector sum" + raw_space) {
+        std::uint64_t sum = 0;
+        for (const u64 offset : offsets) {
+            sum += stipp::detail::to_repr(offset);
+        }
+        return sum;
+    };
+    BENCHMARK("elias_fano sum" + encoded_space) {
+        std::uint64_t sum = 0;
+        for (const u64 offset : encoded) {
+            sum += stipp::detail::to_repr(offset);
+        }
+        return sum;
+    };
+    BENCHMARK("elias_fano decode") {
+        std::uint64_t sum = 0;
+        std::array<u64, 1024> batch{};
+        for (std::size_t first = 0; first < count; first += batch.size()) {
+            const std::size_t decoded = encoded.decode(first, std::span(batch));
+            for (std::size_t i = 0; i < decoded; ++i) {
+                sum += stipp::detail::to_repr(batch[i]);
+            }
+        }
+        return sum;
+    };
+    BENCHMARK("std::vector access") {
+        std::uint64_t sum = 0;
+        for (const std::size_t i : indices) {
+            sum += stipp::detail::to_repr(offsets[i]);
+        }
+        return sum;
+    };
+    BENCHMARK("elias_fano access") {
+        std::uint64_t sum = 0;
+        for (const std::size_t i : indices) {
+            sum += stipp::detail::to_repr(encoded.access(i));
+        }
+        return sum;
+    };
+    BENCHMARK("std::lower_bound") {
+        std::size_t sum = 0;
+        for (const u64 target : targets) {
+            const auto it = std::lower_bound(offsets.begin(), offsets.end(), target);
+            sum += static_cast<std::size_t>(it - offsets.begin());
+        }
+        return sum;
+    };
+    BENCHMARK("elias_fano next_geq") {
+        std::size_t sum = 0;
+        for (const u64 target : targets) {
+            sum += encoded.next_geq(target).index();
+        }
+        return sum;
+    };
+}
+
+TEST_CASE("static maps", "[static_map]") {
+    // An opcode table: 200 keys spread over a few hundred values, looked up with a mix
+    // of hits and misses.
+    constexpr std::size_t key_count = 200;
+    static constexpr auto opcodes = []<std::size_t... I>(std::index_sequence<I...>) {
+        return stipp::static_map<u16, u16, sizeof...(I)>{
+            {u16{static_cast<std::uint16_t>(I * 3 + 0x100)}, u16{I}}...};
+    }(std::make_index_sequence<key_count>{});
+    std::unordered_map<u16, u16> node_map;
+    stipp::flat_map<u16, u16> flat;
+    for (std::size_t i = 0; i < key_count; ++i) {
+        const u16 key{static_cast<std::uint16_t>(i * 3 + 0x100)};
+        node_map.emplace(key, u16{static_cast<std::uint16_t>(i)});
+        flat.try_emplace(key, u16{static_cast<std::uint16_t>(i)});
+    }
+    std::vector<u16> lookups(bench_size);
+    for (std::size_t i = 0; i < bench_size; ++i) {
+        lookups[i] = u16{static_cast<std::uint16_t>(
+            0x100 + stipp::detail::splitmix64(i) % (key_count * 4))};
+    }
+
+    const auto sum_found = [&](const auto& map) {
+        std::uint64_t sum = 0;
+        for (const u16 key : lookups) {
+            const auto it = map.find(key);
+            if (it != map.end()) {
+                sum += stipp::detail::to_repr((*it).second);
+            }
+        }
+        return sum;
+    };
+    BENCHMARK("std::unordered_map find") { return sum_found(node_map); };
+    BENCHMARK("flat_map find") { return sum_found(flat); };
+    BENCHMARK("static_map find") {
+        std::uint64_t sum = 0;
+        for (const u16 key : lookups) {
+            const u16* value = opcodes.find(key);
+            sum += value != nullptr ? stipp::detail::to_repr(*value) : 0U;
+        }
+        return sum;
+    };
+}
+
+TEST_CASE("bloom and cuckoo filters", "[filter]") {
+    // Four million keys at 1% false positives keep every filter well out of cache. Half
+    // of the looked up keys were inserted.
+    constexpr std::size_t key_count = 1 << 22;
+    const auto key_at = [](std::size_t i) { return u64{stipp::detail::splitmix64(i)}; };
+    std::vector<u64> lookups(bench_size);
+    for (std::size_t i = 0; i < bench_size; ++i) {
+        lookups[i] = key_at(i * 2654435761U % (2 * key_count));
+    }
+
+    // A standard Bloom filter with 10 bits per key and 7 probes anywhere in its bits.
+    constexpr std::size_t probes = 7;
+    const std::size_t bit_count = key_count * 10;
+    std::vector<std::uint64_t> bits((bit_count + 63) / 64);
+    const auto hash_of = [](u64 key) {
+        return stipp::detail::fmix64(stipp::detail::to_repr(key));
+    };
+    const auto probe = [&](std::uint64_t hashed, std::size_t p) {
+        const std::uint64_t step = (hashed >> 32) | 1;
+        return static_cast<std::size_t>((hashed + p * step) % bit_count);
+    };
+    stipp::blocked_bloom<u64> bloom(key_count, 0.01);
+    stipp::cuckoo_filter<u64, u8> cuckoo(key_count);
+    for (std::size_t i = 0; i < key_count; ++i) {
+        const std::uint64_t hashed = hash_of(key_at(i));
+        for (std::size_t p = 0; p < probes; ++p) {
+            bits[probe(hashed, p) / 64] |= std::uint64_t{1} << (probe(hashed, p) % 64);
+        }
+        bloom.insert(key_at(i));
+        cuckoo.insert(key_at(i));
+    }
+    const std::string bloom_space =
+        " (" + std::to_string(bloom.memory_bytes() >> 20) + " MiB)";
+    const std::string cuckoo_space =
+        " (" + std::to_string(cuckoo.memory_bytes() >> 20) + " MiB)";
+
+    BENCHMARK("standard bloom contains (" + std::to_string(bit_count >> 23) + " MiB)") {
+        std::size_t found = 0;
+        for (const u64 key : lookups) {
+            const std::uint64_t hashed = hash_of(key);
+            bool hit = true;
+            for (std::size_t p = 0; p < probes && hit; ++p) {
+                hit = ((bits[probe(hashed, p) / 64] >> (probe(hashed, p) % 64)) & 1) != 0;
+            }
+            found += static_cast<std::size_t>(hit);
+        }
+        return found;
+    };
+    BENCHMARK("blocked_bloom contains" + bloom_space) {
+        std::size_t found = 0;
+        for (const u64 key : lookups) {
+            found += static_cast<std::size_t>(bloom.contains(key));
+        }
+        return found;
+    };
+    BENCHMARK("cuckoo_filter contains" + cuckoo_space) {
+        std::size_t found = 0;
+        for (const u64 key : lookups) {
+            found += static_cast<std::size_t>(cuckoo.contains(key));
+        }
+        return found;
+    };
+    const auto out = std::make_unique<bool[]>(lookups.size());
+    const std::span<bool> hits(out.get(), lookups.size());
+    BENCHMARK("cuckoo_filter contains_n") {
+        return cuckoo.contains_n(std::span<const u64>(lookups), hits);
+    };
+
+    const auto previous = stipp::active_cpu_level();
+    for (const auto level : {stipp::cpu_level::baseline, stipp::cpu_level::sse4_2,
+                              stipp::cpu_level::avx2, stipp::cpu_level::avx512}) {
+        if (stipp::set_cpu_level(level) != level) {
+            continue;
+        }
+        const auto index = static_cast<std::size_t>(level);
+        const std::string name(stipp::detail::cpu_level_names[index]);
+        BENCHMARK("blocked_bloom contains_n " + name) {
+            return bloom.contains_n(std::span<const u64>(lookups), hits);
+        };
+    }
+    stipp::set_cpu_level(previous);
+}
+
+TEST_CASE("cpu dispatch levels", "[dispatch]") {
+    const auto previous = stipp::active_cpu_level();
+    const auto column = make_column<u32>();
+    const auto x = make_column<u8>();
+    const auto weights = make_column<i8>();
+
+    for (const auto level : {stipp::cpu_level::baseline, stipp::cpu_level::sse4_2,
+                              stipp::cpu_level::avx2, stipp::cpu_level::avx512}) {
+        if (stipp::set_cpu_level(level) != level) {
+            continue;
+        }
+        const auto index = static_cast<std::size_t>(level);
+        const std::string name(stipp::detail::cpu_level_names[index]);
+        BENCHMARK("reduce_sum u32 " + name) {
+            return stipp::reduce_sum(std::span<const u32>(column));
+        };
+        BENCHMARK("dot u8 x i8 " + name) { return stipp::dot(x, weights); };
+    }
+    stipp::set_cpu_level(previous);
+}
@@ -3,7 +3,8 @@ set(_FMT_TAGS_DIR "${PROJECT_BINARY_DIR}/_fmt")
 
 find_program(CLANG_FORMAT clang-format)
 if(CLANG_FORMAT)
-    foreach(_CXX_FILE "${PROJECT_SOURCE_DIR}/../stipp.hpp" "${PROJECT_SOURCE_DIR}/tests.cpp")
+    foreach(_CXX_FILE "${PROJECT_SOURCE_DIR}/../stipp.hpp" "${PROJECT_SOURCE_DIR}/tests.cpp"
+                      "${PROJECT_SOURCE_DIR}/benchmarks.cpp")
         get_filename_component(_FMT_TAG_NAME "${_CXX_FILE}" NAME)
         set(_FMT_TAG "${_FMT_TAGS_DIR}/${_FMT_TAG_NAME}.tag")
         add_custom_command(
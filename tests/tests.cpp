@@ -1,12 +1,27 @@
 #include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
 #include <stipp.hpp> // IWYU pragma: associated
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
 #include <limits>
+#include <memory>
+#include <optional>
+#include <span>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #if __has_include(<format>)
 #include <format>
@@ -15,6 +30,34 @@
 using namespace stipp::types;
 using namespace stipp::literals;
 
+namespace {
+
+// Forces a dispatch level for the rest of a test case. Combined with GENERATE, this runs
+// a test case once per level, so every kernel path is covered on a capable machine.
+class cpu_level_guard {
+  public:
+    explicit cpu_level_guard(stipp::cpu_level level)
+        : previous_(stipp::active_cpu_level()) {
+        stipp::set_cpu_level(level);
+    }
+
+    cpu_level_guard(const cpu_level_guard&) = delete;
+    cpu_level_guard& operator=(const cpu_level_guard&) = delete;
+
+    ~cpu_level_guard() { stipp::set_cpu_level(previous_); }
+
+  private:
+    stipp::cpu_level previous_;
+};
+
+} // namespace
+
+#define FOR_EACH_CPU_LEVEL()                                                          \
+    const cpu_level_guard cpu_level_guard_(GENERATE(                                  \
+        stipp::cpu_level::baseline, stipp::cpu_level::sse4_2, stipp::cpu_level::avx2, \
+        stipp::cpu_level::avx512));                                                   \
+    INFO("cpu level " << static_cast<int>(stipp::active_cpu_level()))
+
 TEST_CASE("literals", "[literals]") {
     REQUIRE(0_u8 == u8{0});
     REQUIRE(0_u16 == u16{0});
@@ -1316,3 +1359,2065 @@ TEST_CASE("numeric_limits::digits", "[limits]") {
     STATIC_REQUIRE(std::numeric_limits<isize>::digits ==
                    std::numeric_limits<std::ptrdiff_t>::digits);
 }
+
+TEST_CASE("packed layout", "[packed]") {
+    STATIC_REQUIRE(sizeof(u24) == 3);
+    STATIC_REQUIRE(sizeof(u40) == 5);
+    STATIC_REQUIRE(sizeof(u48) == 6);
+    STATIC_REQUIRE(sizeof(i24) == 3);
+    STATIC_REQUIRE(sizeof(i40) == 5);
+    STATIC_REQUIRE(sizeof(i48) == 6);
+
+    STATIC_REQUIRE(alignof(u24) == 1);
+    STATIC_REQUIRE(alignof(u40) == 1);
+    STATIC_REQUIRE(alignof(u48) == 1);
+    STATIC_REQUIRE(alignof(i24) == 1);
+    STATIC_REQUIRE(alignof(i40) == 1);
+    STATIC_REQUIRE(alignof(i48) == 1);
+
+    STATIC_REQUIRE(std::is_trivially_copyable_v<u24>);
+    STATIC_REQUIRE(std::is_trivially_copyable_v<u40>);
+    STATIC_REQUIRE(std::is_trivially_copyable_v<u48>);
+    STATIC_REQUIRE(std::is_trivially_copyable_v<i24>);
+    STATIC_REQUIRE(std::is_trivially_copyable_v<i40>);
+    STATIC_REQUIRE(std::is_trivially_copyable_v<i48>);
+
+    STATIC_REQUIRE(sizeof(std::array<u24, 4>) == 12);
+
+    const u24 val = u24{0x123456_u32};
+    std::array<unsigned char, 3> bytes{};
+    std::memcpy(bytes.data(), &val, sizeof(val));
+    REQUIRE(bytes[0] == 0x56);
+    REQUIRE(bytes[1] == 0x34);
+    REQUIRE(bytes[2] == 0x12);
+}
+
+TEST_CASE("packed conversion", "[packed]") {
+    STATIC_REQUIRE(static_cast<u32>(u24{42_u32}) == 42_u32);
+    STATIC_REQUIRE(static_cast<u64>(u40{42_u64}) == 42_u64);
+    STATIC_REQUIRE(static_cast<u64>(u48{42_u64}) == 42_u64);
+    STATIC_REQUIRE(static_cast<i32>(i24{-42_i32}) == -42_i32);
+    STATIC_REQUIRE(static_cast<i64>(i40{-42_i64}) == -42_i64);
+    STATIC_REQUIRE(static_cast<i64>(i48{-42_i64}) == -42_i64);
+
+    STATIC_REQUIRE(static_cast<std::uint32_t>(u24{0x1234567U}) == 0x234567U);
+    STATIC_REQUIRE(static_cast<std::int32_t>(i24{0x800000}) == -0x800000);
+    STATIC_REQUIRE(static_cast<std::int64_t>(i48{-1}) == -1);
+    STATIC_REQUIRE(static_cast<std::uint64_t>(u40{~std::uint64_t{0}}) == 0xFFFFFFFFFFU);
+
+    STATIC_REQUIRE(static_cast<std::uint32_t>(u24{}) == 0);
+}
+
+TEST_CASE("packed ops", "[packed]") {
+    STATIC_REQUIRE(u24{40_u32} + u24{2_u32} == u24{42_u32});
+    STATIC_REQUIRE(u24{0xFFFFFF_u32} + u24{1_u32} == u24{0_u32});
+    STATIC_REQUIRE(u24{0_u32} - u24{1_u32} == u24{0xFFFFFF_u32});
+    STATIC_REQUIRE(u40{0x1000000_u64} * u40{0x1000_u64} == u40{0x1000000000_u64});
+    STATIC_REQUIRE(u48{84_u64} / u48{2_u64} == u48{42_u64});
+    STATIC_REQUIRE(u48{85_u64} % u48{43_u64} == u48{42_u64});
+    STATIC_REQUIRE((u24{0xF0F0F0_u32} & u24{0x0FFFF0_u32}) == u24{0x00F0F0_u32});
+    STATIC_REQUIRE((u24{0xF00000_u32} | u24{0x00000F_u32}) == u24{0xF0000F_u32});
+    STATIC_REQUIRE((u24{0xFF00FF_u32} ^ u24{0xFFFFFF_u32}) == u24{0x00FF00_u32});
+    STATIC_REQUIRE(~u24{0_u32} == u24{0xFFFFFF_u32});
+    STATIC_REQUIRE((u24{0x800001_u32} << 1) == u24{2_u32});
+    STATIC_REQUIRE((u24{0x800000_u32} >> 23) == u24{1_u32});
+
+    STATIC_REQUIRE(i24{0x7FFFFF_i32} + i24{1_i32} == i24{-0x800000_i32});
+    STATIC_REQUIRE(i24{0x7FFFFF_i32} * i24{0x7FFFFF_i32} == i24{1_i32});
+    STATIC_REQUIRE(-i40{42_i64} == i40{-42_i64});
+    STATIC_REQUIRE(i48{-84_i64} / i48{2_i64} == i48{-42_i64});
+    STATIC_REQUIRE((i24{-0x800000_i32} >> 23) == i24{-1_i32});
+    STATIC_REQUIRE(i24{-1_i32} < i24{0_i32});
+    STATIC_REQUIRE(u24{1_u32} < u24{0xFFFFFF_u32});
+
+    i24 val = i24{41_i32};
+    REQUIRE(++val == i24{42_i32});
+    REQUIRE(val++ == i24{42_i32});
+    REQUIRE(--val == i24{42_i32});
+    val += i24{8_i32};
+    REQUIRE(val == i24{50_i32});
+    val -= i24{8_i32};
+    REQUIRE(val == i24{42_i32});
+    val <<= 1_u8;
+    REQUIRE(val == i24{84_i32});
+    val >>= 1;
+    REQUIRE(val == i24{42_i32});
+}
+
+TEST_CASE("packed traits", "[packed]") {
+    STATIC_REQUIRE(stipp::is_stipp_int_v<u24>);
+    STATIC_REQUIRE(stipp::is_stipp_int_v<i48>);
+    STATIC_REQUIRE(stipp::unsigned_integral<u40>);
+    STATIC_REQUIRE(stipp::signed_integral<i40>);
+    STATIC_REQUIRE(std::is_same_v<stipp::make_signed_t<u24>, i24>);
+    STATIC_REQUIRE(std::is_same_v<stipp::make_signed_t<u48>, i48>);
+    STATIC_REQUIRE(std::is_same_v<stipp::make_unsigned_t<i24>, u24>);
+    STATIC_REQUIRE(std::is_same_v<stipp::make_unsigned_t<i40>, u40>);
+}
+
+TEST_CASE("packed numeric_limits", "[packed]") {
+    STATIC_REQUIRE(std::numeric_limits<u24>::digits == 24);
+    STATIC_REQUIRE(std::numeric_limits<u40>::digits == 40);
+    STATIC_REQUIRE(std::numeric_limits<u48>::digits == 48);
+    STATIC_REQUIRE(std::numeric_limits<i24>::digits == 23);
+    STATIC_REQUIRE(std::numeric_limits<i40>::digits == 39);
+    STATIC_REQUIRE(std::numeric_limits<i48>::digits == 47);
+
+    STATIC_REQUIRE(std::numeric_limits<u24>::digits10 == 7);
+    STATIC_REQUIRE(std::numeric_limits<i48>::digits10 == 14);
+
+    STATIC_REQUIRE(std::numeric_limits<u24>::max() == u24{0xFFFFFF_u32});
+    STATIC_REQUIRE(std::numeric_limits<u24>::min() == u24{0_u32});
+    STATIC_REQUIRE(std::numeric_limits<u48>::max() == u48{0xFFFFFFFFFFFF_u64});
+    STATIC_REQUIRE(std::numeric_limits<i24>::max() == i24{0x7FFFFF_i32});
+    STATIC_REQUIRE(std::numeric_limits<i24>::min() == i24{-0x800000_i32});
+    STATIC_REQUIRE(std::numeric_limits<i40>::lowest() == i40{-0x8000000000_i64});
+}
+
+TEST_CASE("packed format", "[packed]") {
+    std::stringstream ss;
+    ss << i24{-42_i32} << ' ' << u48{42_u64};
+    REQUIRE(ss.str() == "-42 42");
+
+    ss = std::stringstream("-42");
+    i40 val{};
+    ss >> val;
+    REQUIRE(val == i40{-42_i64});
+
+    REQUIRE(std::hash<u24>{}(u24{42_u32}) == std::hash<std::uint32_t>{}(42));
+
+#if __has_include(<format>)
+    REQUIRE(std::format("{}", u24{42_u32}) == "42");
+    REQUIRE(std::format("{}", i48{-42_i64}) == "-42");
+#endif
+}
+
+TEST_CASE("niche_optional", "[niche_optional]") {
+    using opt_u32 = stipp::niche_optional<u32>;
+    using opt_i16 = stipp::niche_optional<i16, -1_i16>;
+
+    STATIC_REQUIRE(sizeof(opt_u32) == sizeof(u32));
+    STATIC_REQUIRE(sizeof(opt_i16) == sizeof(i16));
+    STATIC_REQUIRE(std::is_trivially_copyable_v<opt_u32>);
+    STATIC_REQUIRE(opt_u32::sentinel == std::numeric_limits<u32>::max());
+
+    STATIC_REQUIRE(!opt_u32{}.has_value());
+    STATIC_REQUIRE(!opt_u32{std::nullopt}.has_value());
+    STATIC_REQUIRE(opt_u32{42_u32}.has_value());
+    STATIC_REQUIRE(*opt_u32{42_u32} == 42_u32);
+    STATIC_REQUIRE(opt_u32{}.value_or(7_u32) == 7_u32);
+    STATIC_REQUIRE(opt_u32{42_u32}.value_or(7_u32) == 42_u32);
+    STATIC_REQUIRE(!opt_u32{std::numeric_limits<u32>::max()}.has_value());
+    STATIC_REQUIRE(!opt_i16{-1_i16}.has_value());
+    STATIC_REQUIRE(opt_i16{std::numeric_limits<i16>::max()}.has_value());
+
+    opt_u32 val{};
+    REQUIRE(!val);
+    REQUIRE(val == std::nullopt);
+    REQUIRE_THROWS_AS(val.value(), std::bad_optional_access);
+    val = 42_u32;
+    REQUIRE(val);
+    REQUIRE(val == 42_u32);
+    REQUIRE(val.value() == 42_u32);
+    val.emplace(43_u32);
+    REQUIRE(val == opt_u32{43_u32});
+    val.reset();
+    REQUIRE(val == opt_u32{});
+
+    REQUIRE(opt_u32{} < opt_u32{0_u32});
+    REQUIRE(opt_u32{1_u32} < opt_u32{2_u32});
+    REQUIRE(opt_u32{} < 0_u32);
+    REQUIRE(opt_u32{1_u32} > std::nullopt);
+    REQUIRE(opt_u32{} != std::numeric_limits<u32>::max());
+
+    opt_u32 other{7_u32};
+    other.swap(val);
+    REQUIRE(!other);
+    REQUIRE(val == 7_u32);
+}
+
+TEST_CASE("niche_optional span helpers", "[niche_optional]") {
+    FOR_EACH_CPU_LEVEL();
+
+    using opt_u32 = stipp::niche_optional<u32>;
+
+    std::vector<opt_u32> values(1000);
+    for (std::size_t i = 0; i < values.size(); i += 3) {
+        values[i] = u32{static_cast<std::uint32_t>(i)};
+    }
+
+    REQUIRE(stipp::count_present(std::span<const opt_u32>(values)) == 334);
+    REQUIRE(stipp::count_present(std::span<const opt_u32>()) == 0);
+
+    std::vector<u32> out(values.size());
+    const std::size_t count = stipp::compact_present(std::span<const opt_u32>(values),
+                                                     std::span<u32>(out));
+    REQUIRE(count == 334);
+    for (std::size_t i = 0; i < count; ++i) {
+        REQUIRE(out[i] == u32{static_cast<std::uint32_t>(i * 3)});
+    }
+
+    std::vector<u32> small(10);
+    REQUIRE_THROWS_AS(stipp::compact_present(std::span<const opt_u32>(values),
+                                             std::span<u32>(small)),
+                      std::length_error);
+}
+
+TEST_CASE("bounded storage", "[bounded]") {
+    STATIC_REQUIRE(std::is_same_v<stipp::bounded<0, 100>::storage_type, u8>);
+    STATIC_REQUIRE(std::is_same_v<stipp::bounded<0, 65535>::storage_type, u16>);
+    STATIC_REQUIRE(std::is_same_v<stipp::bounded<-100, 100>::storage_type, i8>);
+    STATIC_REQUIRE(std::is_same_v<stipp::bounded<-1, 255>::storage_type, i16>);
+    STATIC_REQUIRE(std::is_same_v<stipp::bounded<0, 65536>::storage_type, u32>);
+    STATIC_REQUIRE(std::is_same_v<stipp::bounded<-1, 65536>::storage_type, i32>);
+    STATIC_REQUIRE(std::is_same_v<stipp::bounded<0, INT64_MAX>::storage_type, u64>);
+    STATIC_REQUIRE(std::is_same_v<stipp::bounded<INT64_MIN, 0>::storage_type, i64>);
+
+    STATIC_REQUIRE(sizeof(stipp::bounded<0, 65535>) == 2);
+    STATIC_REQUIRE(sizeof(stipp::bounded<1, 100>) == 1);
+}
+
+TEST_CASE("bounded construction", "[bounded]") {
+    using port = stipp::bounded<0, 65535>;
+    using percent = stipp::bounded<0, 100>;
+
+    STATIC_REQUIRE(port{8080_u32}.value() == 8080_u16);
+    STATIC_REQUIRE(percent{50_i64}.get() == 50);
+    STATIC_REQUIRE(percent{}.get() == 0);
+    STATIC_REQUIRE(percent::from_unchecked(42_u8).value() == 42_u8);
+    STATIC_REQUIRE(static_cast<u8>(percent{42_u8}) == 42_u8);
+
+    REQUIRE_THROWS_AS(port{65536_u32}, std::out_of_range);
+    REQUIRE_THROWS_AS(port{-1_i32}, std::out_of_range);
+    REQUIRE_THROWS_AS(percent{101_u64}, std::out_of_range);
+    REQUIRE_THROWS_AS((stipp::bounded<1, 10>{0_u8}), std::out_of_range);
+    REQUIRE_THROWS_AS((stipp::bounded<-10, -1>{std::numeric_limits<u64>::max()}),
+                      std::out_of_range);
+
+    const port widened = percent{99_u8};
+    REQUIRE(widened.value() == 99_u16);
+    STATIC_REQUIRE(std::is_convertible_v<percent, port>);
+    STATIC_REQUIRE(!std::is_convertible_v<port, percent>);
+}
+
+TEST_CASE("bounded arithmetic", "[bounded]") {
+    using digit = stipp::bounded<0, 9>;
+    using shard = stipp::bounded<1, 16>;
+
+    constexpr auto sum = digit{7_u8} + digit{8_u8};
+    STATIC_REQUIRE(std::is_same_v<decltype(sum), const stipp::bounded<0, 18>>);
+    STATIC_REQUIRE(sum.get() == 15);
+
+    constexpr auto diff = digit{3_u8} - digit{8_u8};
+    STATIC_REQUIRE(std::is_same_v<decltype(diff), const stipp::bounded<-9, 9>>);
+    STATIC_REQUIRE(diff.get() == -5);
+
+    constexpr auto prod = diff * digit{9_u8};
+    STATIC_REQUIRE(std::is_same_v<decltype(prod), const stipp::bounded<-81, 81>>);
+    STATIC_REQUIRE(prod.get() == -45);
+
+    constexpr auto quot = prod / shard{4_u8};
+    STATIC_REQUIRE(std::is_same_v<decltype(quot), const stipp::bounded<-81, 81>>);
+    STATIC_REQUIRE(quot.get() == -11);
+
+    STATIC_REQUIRE(digit{3_u8} == stipp::bounded<-5, 5>{3_i8});
+    STATIC_REQUIRE(digit{3_u8} < shard{4_u8});
+    STATIC_REQUIRE(diff < digit{0_u8});
+}
+
+TEST_CASE("fixed conversion", "[fixed]") {
+    using q16 = stipp::fixed<i32, 16>;
+    using uq8 = stipp::fixed<u16, 8>;
+
+    STATIC_REQUIRE(sizeof(q16) == sizeof(i32));
+    STATIC_REQUIRE(std::is_trivially_copyable_v<q16>);
+
+    STATIC_REQUIRE(q16{3_i32}.raw() == 0x30000_i32);
+    STATIC_REQUIRE(q16{-3_i32}.raw() == -0x30000_i32);
+    STATIC_REQUIRE(q16{1.5}.raw() == 0x18000_i32);
+    STATIC_REQUIRE(q16{-1.5F}.raw() == -0x18000_i32);
+    STATIC_REQUIRE(uq8{0.25}.raw() == 0x40_u16);
+    STATIC_REQUIRE(q16::from_raw(0x8000_i32) == q16{0.5});
+
+    STATIC_REQUIRE(static_cast<double>(q16{2.75}) == 2.75);
+    STATIC_REQUIRE(static_cast<float>(uq8{0.5}) == 0.5F);
+    STATIC_REQUIRE(static_cast<i32>(q16{2.75}) == 2_i32);
+    STATIC_REQUIRE(static_cast<i32>(q16{-2.75}) == -2_i32);
+
+    // nearest representable value, ties away from zero
+    STATIC_REQUIRE(q16{1.0 / 65536.0 * 0.5}.raw() == 1_i32);
+    STATIC_REQUIRE(q16{-1.0 / 65536.0 * 0.5}.raw() == -1_i32);
+    STATIC_REQUIRE(q16{1.0 / 65536.0 * 0.49}.raw() == 0_i32);
+}
+
+TEST_CASE("fixed arithmetic", "[fixed]") {
+    using q16 = stipp::fixed<i32, 16>;
+    using q4 = stipp::fixed<i8, 4>;
+
+    STATIC_REQUIRE(q16{1.5} + q16{2.25} == q16{3.75});
+    STATIC_REQUIRE(q16{1.5} - q16{2.25} == q16{-0.75});
+    STATIC_REQUIRE(-q16{1.5} == q16{-1.5});
+    STATIC_REQUIRE(q16{1.5} * q16{-2.5} == q16{-3.75});
+    STATIC_REQUIRE(q16{-3.75} / q16{1.5} == q16{-2.5});
+    STATIC_REQUIRE(q16{1.5} < q16{2.0});
+
+    // products and quotients round to nearest, ties away from zero
+    STATIC_REQUIRE(q4::from_raw(1_i8) * q4{0.5} == q4::from_raw(1_i8));
+    STATIC_REQUIRE(q4::from_raw(-1_i8) * q4{0.5} == q4::from_raw(-1_i8));
+    STATIC_REQUIRE(q4::from_raw(3_i8) * q4{0.25} == q4::from_raw(1_i8));
+    STATIC_REQUIRE(q4{1.0} / q4{3.0} == q4::from_raw(5_i8));
+    STATIC_REQUIRE(q4{-1.0} / q4{3.0} == q4::from_raw(-5_i8));
+    STATIC_REQUIRE(q4{2.0} / q4{3.0} == q4::from_raw(11_i8));
+
+    q16 val{1_i32};
+    val += q16{0.5};
+    val *= q16{2_i32};
+    val -= q16{1_i32};
+    val /= q16{4_i32};
+    REQUIRE(val == q16{0.5});
+}
+
+TEST_CASE("fixed saturating", "[fixed]") {
+    using q4 = stipp::fixed<i8, 4>;
+    using uq4 = stipp::fixed<u8, 4>;
+
+    constexpr q4 q4_max = q4::from_raw(std::numeric_limits<i8>::max());
+    constexpr q4 q4_min = q4::from_raw(std::numeric_limits<i8>::min());
+
+    STATIC_REQUIRE(add_sat(q4{7.0}, q4{7.0}) == q4_max);
+    STATIC_REQUIRE(sub_sat(q4{-7.0}, q4{7.0}) == q4_min);
+    STATIC_REQUIRE(mul_sat(q4{4.0}, q4{-4.0}) == q4_min);
+    STATIC_REQUIRE(div_sat(q4{7.0}, q4{0.0625}) == q4_max);
+    STATIC_REQUIRE(add_sat(q4{1.0}, q4{2.0}) == q4{3.0});
+    STATIC_REQUIRE(sub_sat(uq4{1.0}, uq4{2.0}) == uq4{0.0});
+    STATIC_REQUIRE(mul_sat(uq4{8.0}, uq4{2.0}) == uq4::from_raw(255_u8));
+}
+
+#if defined(__SIZEOF_INT128__)
+
+TEST_CASE("fixed 64-bit", "[fixed]") {
+    using q32 = stipp::fixed<i64, 32>;
+    using uq32 = stipp::fixed<u64, 32>;
+
+    STATIC_REQUIRE(q32{30000.5} * q32{-20000.25} == q32{-600017500.125});
+    STATIC_REQUIRE(q32{1_i64} / q32{3_i64} == q32::from_raw(1431655765_i64));
+    STATIC_REQUIRE(uq32{2_u64} / uq32{3_u64} == uq32::from_raw(2863311531_u64));
+    STATIC_REQUIRE(mul_sat(q32{2000000000_i64}, q32{2000000000_i64}) ==
+                   q32::from_raw(std::numeric_limits<i64>::max()));
+}
+
+#endif
+
+TEST_CASE("fixed bulk", "[fixed]") {
+    FOR_EACH_CPU_LEVEL();
+
+    using q16 = stipp::fixed<i32, 16>;
+
+    std::vector<q16> lhs{};
+    std::vector<q16> rhs{};
+    for (int i = 0; i < 100; ++i) {
+        lhs.emplace_back(static_cast<double>(i) * 0.25);
+        rhs.emplace_back(1.0 - static_cast<double>(i) * 0.125);
+    }
+
+    double expected = 0.0;
+    for (std::size_t i = 0; i < lhs.size(); ++i) {
+        expected += static_cast<double>(lhs[i]) * static_cast<double>(rhs[i]);
+    }
+    REQUIRE(static_cast<double>(dot(lhs, rhs)) == expected);
+
+    std::vector<q16> acc(lhs.size(), q16{1_i32});
+    axpy(acc, lhs, q16{-2.0});
+    for (std::size_t i = 0; i < acc.size(); ++i) {
+        REQUIRE(acc[i] == q16{1_i32} + lhs[i] * q16{-2.0});
+    }
+
+    // The sum of products wraps like the narrowed result: 2^62 + 2^62 is -2^63, which
+    // is -2^47 after the shift and 0 in 32 bits.
+    const std::vector<q16> lowest(2, q16::from_raw(std::numeric_limits<i32>::min()));
+    REQUIRE(dot(lowest, lowest) == q16::from_raw(0_i32));
+
+    REQUIRE_THROWS_AS(dot(lhs, std::span<const q16>(rhs).first(10)), std::invalid_argument);
+    REQUIRE_THROWS_AS(axpy(acc, std::span<const q16>(rhs).first(10), q16{}),
+                      std::invalid_argument);
+}
+
+TEST_CASE("strong_id", "[strong_id]") {
+    using node_id = stipp::strong_id<struct node_tag>;
+    using edge_id = stipp::strong_id<struct edge_tag, u16>;
+
+    STATIC_REQUIRE(sizeof(node_id) == sizeof(u32));
+    STATIC_REQUIRE(sizeof(edge_id) == sizeof(u16));
+    STATIC_REQUIRE(std::is_trivially_copyable_v<node_id>);
+    STATIC_REQUIRE(!std::is_convertible_v<node_id, edge_id>);
+    STATIC_REQUIRE(!std::is_convertible_v<u32, node_id>);
+    STATIC_REQUIRE(!std::is_convertible_v<node_id, u32>);
+    STATIC_REQUIRE(stipp::is_strong_id_v<node_id>);
+    STATIC_REQUIRE(!stipp::is_strong_id_v<u32>);
+
+    STATIC_REQUIRE(node_id{}.value() == 0_u32);
+    STATIC_REQUIRE(node_id{42_u32}.value() == 42_u32);
+    STATIC_REQUIRE(static_cast<u32>(node_id{42_u32}) == 42_u32);
+    STATIC_REQUIRE(node_id{40_u32} + 2_u32 == node_id{42_u32});
+    STATIC_REQUIRE(node_id{44_u32} - 2_u32 == node_id{42_u32});
+    STATIC_REQUIRE(node_id{44_u32} - node_id{2_u32} == 42_u32);
+    STATIC_REQUIRE(node_id{1_u32} < node_id{2_u32});
+
+    node_id id{41_u32};
+    REQUIRE(++id == node_id{42_u32});
+    REQUIRE(id++ == node_id{42_u32});
+    REQUIRE(--id == node_id{42_u32});
+    id += 8_u32;
+    id -= 8_u32;
+    REQUIRE(id == node_id{42_u32});
+
+    REQUIRE(std::hash<node_id>{}(id) == std::hash<u32>{}(42_u32));
+
+    std::stringstream ss;
+    ss << id;
+    REQUIRE(ss.str() == "42");
+
+#if __has_include(<format>)
+    REQUIRE(std::format("{}", id) == "42");
+#endif
+}
+
+TEST_CASE("index_vector", "[strong_id]") {
+    using node_id = stipp::strong_id<struct node_tag>;
+    using small_id = stipp::strong_id<struct small_tag, u8>;
+
+    stipp::index_vector<node_id, std::string> names{};
+    REQUIRE(names.empty());
+    REQUIRE(names.next_id() == node_id{0_u32});
+
+    const node_id a = names.push_back("a");
+    const node_id b = names.emplace_back("b");
+    REQUIRE(a == node_id{0_u32});
+    REQUIRE(b == node_id{1_u32});
+    REQUIRE(names.size() == 2);
+    REQUIRE(names[a] == "a");
+    REQUIRE(names.at(b) == "b");
+    REQUIRE(names.contains(b));
+    REQUIRE(!names.contains(node_id{2_u32}));
+    REQUIRE_THROWS_AS(names.at(node_id{2_u32}), std::out_of_range);
+
+    names[b] = std::string(1, 'c');
+    REQUIRE(names.values()[1] == "c");
+
+    std::size_t count = 0;
+    for (auto [id, name] : names) {
+        REQUIRE(id == node_id{u32{static_cast<std::uint32_t>(count)}});
+        name.push_back('!');
+        ++count;
+    }
+    REQUIRE(count == 2);
+    REQUIRE(names[a] == "a!");
+
+    const auto& const_names = names;
+    for (const auto& [id, name] : const_names) {
+        REQUIRE(const_names[id] == name);
+    }
+
+    stipp::index_vector<small_id, int> small(255);
+    REQUIRE(small.next_id() == small_id{255_u8});
+    REQUIRE_THROWS_AS(small.push_back(0), std::length_error);
+    REQUIRE_THROWS_AS((stipp::index_vector<small_id, int>(256)), std::length_error);
+
+    const stipp::index_vector<small_id, int> init{1, 2, 3};
+    REQUIRE(init[small_id{2_u8}] == 3);
+}
+
+TEST_CASE("repr span", "[span]") {
+    std::vector<u32> values{1_u32, 2_u32, 3_u32};
+
+    const std::span<std::uint32_t> raw = stipp::as_repr_span(std::span(values));
+    REQUIRE(raw.size() == 3);
+    REQUIRE(raw.data() == static_cast<void*>(values.data()));
+    REQUIRE(raw[1] == 2);
+    raw[1] = 42;
+    REQUIRE(values[1] == 42_u32);
+
+    const std::array fixed_values{-1_i16, 7_i16};
+    const std::span<const std::int16_t, 2> fixed_raw =
+        stipp::as_repr_span(std::span(fixed_values));
+    REQUIRE(fixed_raw[0] == -1);
+
+    std::array<std::uint64_t, 2> raw_values{5, 6};
+    const std::span<u64, 2> typed = stipp::from_repr_span<u64>(std::span(raw_values));
+    REQUIRE(typed[0] == 5_u64);
+    typed[1] = 7_u64;
+    REQUIRE(raw_values[1] == 7);
+
+    const std::vector<std::uint8_t> const_raw{1, 2};
+    const std::span<const u8> const_typed = stipp::from_repr_span<u8>(std::span(const_raw));
+    REQUIRE(const_typed[1] == 2_u8);
+
+    STATIC_REQUIRE(std::is_same_v<decltype(stipp::as_repr_span(std::span<const u8>())),
+                                  std::span<const std::uint8_t>>);
+}
+
+TEST_CASE("simd lanes", "[simd]") {
+    using u8x16 = stipp::simd<u8>;
+    using i16x8 = stipp::simd<i16>;
+
+    STATIC_REQUIRE(u8x16::size() == 16);
+    STATIC_REQUIRE(i16x8::size() == 8);
+    STATIC_REQUIRE(stipp::simd<u64, 4>::size() == 4);
+    STATIC_REQUIRE(sizeof(u8x16) == 16);
+
+    std::array<u8, 16> bytes{};
+    for (std::size_t i = 0; i < bytes.size(); ++i) {
+        bytes[i] = u8{static_cast<std::uint8_t>(i * 20)};
+    }
+
+    const auto x = u8x16::load(bytes);
+    const auto sum = x + u8x16{100_u8};
+    std::array<u8, 16> out{};
+    sum.store(out);
+    for (std::size_t i = 0; i < bytes.size(); ++i) {
+        REQUIRE(out[i] == bytes[i] + 100_u8);
+        REQUIRE(sum[i] == bytes[i] + 100_u8);
+        REQUIRE((x * u8x16{3_u8})[i] == bytes[i] * 3_u8);
+        REQUIRE((x << 2)[i] == bytes[i] << 2);
+        REQUIRE((x >> 1_u8)[i] == bytes[i] >> 1);
+        REQUIRE((~x)[i] == ~bytes[i]);
+        REQUIRE((-x)[i] == -bytes[i]);
+    }
+
+    const auto neg = i16x8{-1000_i16};
+    REQUIRE((neg * i16x8{40_i16})[0] == -1000_i16 * 40_i16);
+    REQUIRE((neg >> 2)[7] == -250_i16);
+
+    std::vector<u8> small(8);
+    REQUIRE_THROWS_AS(u8x16::load(small), std::out_of_range);
+    REQUIRE_THROWS_AS(x.store(small), std::out_of_range);
+}
+
+TEST_CASE("simd masks", "[simd]") {
+    using i32x4 = stipp::simd<i32>;
+
+    const std::array vals{-2_i32, 5_i32, 0_i32, 9_i32};
+    const auto x = i32x4::load(vals);
+    const auto mask = x > i32x4{0_i32};
+
+    REQUIRE(!mask[0]);
+    REQUIRE(mask[1]);
+    REQUIRE(!mask[2]);
+    REQUIRE(mask[3]);
+    REQUIRE(popcount(mask) == 2);
+    REQUIRE(any_of(mask));
+    REQUIRE(!all_of(mask));
+    REQUIRE(!none_of(mask));
+    REQUIRE(all_of(mask | !mask));
+    REQUIRE(none_of(mask & !mask));
+    REQUIRE(mask == (x >= i32x4{1_i32}));
+    REQUIRE(popcount(x == x) == 4);
+    REQUIRE(popcount(x != x) == 0);
+    REQUIRE(popcount(x <= i32x4{0_i32}) == 2);
+    REQUIRE(popcount(x < i32x4{0_i32}) == 1);
+
+    const auto clamped = select(mask, x, i32x4{0_i32});
+    REQUIRE(clamped[0] == 0_i32);
+    REQUIRE(clamped[1] == 5_i32);
+    REQUIRE(min(x, i32x4{1_i32})[3] == 1_i32);
+    REQUIRE(max(x, i32x4{1_i32})[0] == 1_i32);
+}
+
+TEST_CASE("simd reductions", "[simd]") {
+    using u8x32 = stipp::simd<u8, 32>;
+    using i64x2 = stipp::simd<i64, 2>;
+
+    std::array<u8, 32> bytes{};
+    u8 expected_sum{};
+    for (std::size_t i = 0; i < bytes.size(); ++i) {
+        bytes[i] = u8{static_cast<std::uint8_t>((i * 37) % 251)};
+        expected_sum += bytes[i];
+    }
+    const auto x = u8x32::load(bytes);
+
+    REQUIRE(reduce_add(x) == expected_sum);
+    REQUIRE(reduce_min(x) == 0_u8);
+    REQUIRE(reduce_max(x) == 0_u8 + u8{static_cast<std::uint8_t>((27 * 37) % 251)});
+    REQUIRE(reduce_and(x) == 0_u8);
+    REQUIRE(reduce_or(u8x32{0x0F_u8}) == 0x0F_u8);
+    REQUIRE(reduce_xor(u8x32{0xFF_u8}) == 0_u8);
+
+    const std::array wide{-5_i64, 3_i64};
+    REQUIRE(reduce_add(i64x2::load(wide)) == -2_i64);
+    REQUIRE(reduce_min(i64x2::load(wide)) == -5_i64);
+}
+
+TEST_CASE("span sums", "[reduce]") {
+    FOR_EACH_CPU_LEVEL();
+
+    std::vector<u32> big(3000, 0xFFFF'FFFF_u32);
+    big[1234] = 1_u32;
+    const std::span<const u32> big_span(big);
+    REQUIRE(stipp::reduce_sum(big_span) == 2999_u64 * 0xFFFF'FFFF_u64 + 1_u64);
+    REQUIRE(stipp::reduce_sum_checked(big_span) == 2999_u64 * 0xFFFF'FFFF_u64 + 1_u64);
+    REQUIRE(stipp::reduce_sum<u32>(big_span) == u32{static_cast<std::uint32_t>(-2998)});
+    REQUIRE_THROWS_AS(stipp::reduce_sum_checked<u32>(big_span), std::overflow_error);
+
+    const std::array small{-30000_i16, -30000_i16, 25000_i16, 5_i16};
+    const std::span<const i16> small_span(small);
+    static_assert(std::is_same_v<decltype(stipp::reduce_sum(small_span)), i64>);
+    REQUIRE(stipp::reduce_sum(small_span) == -34995_i64);
+    REQUIRE(stipp::reduce_sum<i32>(small_span) == -34995_i32);
+    REQUIRE(stipp::reduce_sum<i16>(small_span) == i16{static_cast<std::int16_t>(-34995)});
+    REQUIRE_THROWS_AS(stipp::reduce_sum_checked<i16>(small_span), std::overflow_error);
+    REQUIRE(stipp::reduce_sum_checked<i16>(small_span.subspan(1)) == -4995_i16);
+    REQUIRE_THROWS_AS(stipp::reduce_sum_checked<u64>(small_span), std::overflow_error);
+    REQUIRE(stipp::reduce_sum_checked<u64>(small_span.subspan(2)) == 25005_u64);
+
+    const std::array limits{(std::numeric_limits<i64>::max)(), 1_i64, -2_i64};
+    REQUIRE(stipp::reduce_sum_checked(std::span<const i64>(limits).subspan(1)) == -1_i64);
+    REQUIRE_THROWS_AS(stipp::reduce_sum_checked(std::span<const i64>(limits)),
+                      std::overflow_error);
+    REQUIRE(stipp::reduce_sum(std::span<const u8>()) == 0_u64);
+    REQUIRE(stipp::reduce_sum_checked(std::span<const u8>()) == 0_u64);
+}
+
+TEST_CASE("span min and max", "[reduce]") {
+    FOR_EACH_CPU_LEVEL();
+
+    std::vector<i32> values(5000);
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        values[i] = i32{static_cast<std::int32_t>((i * 7919) % 4001) - 2000};
+    }
+    values[3001] = -2500_i32;
+    values[4500] = -2500_i32;
+    values[17] = 2500_i32;
+    values[2048] = 2500_i32;
+    const std::span<const i32> span(values);
+
+    REQUIRE(stipp::reduce_min(span) == -2500_i32);
+    REQUIRE(stipp::reduce_max(span) == 2500_i32);
+    REQUIRE(stipp::reduce_minmax(span) == std::pair{-2500_i32, 2500_i32});
+    REQUIRE(stipp::argmin(span) == 3001);
+    REQUIRE(stipp::argmax(span) == 17);
+    REQUIRE(stipp::argmax(span.subspan(18)) == 2048 - 18);
+    for (std::size_t len : {1U, 1023U, 1024U, 1025U, 3001U}) {
+        const auto head = span.first(len);
+        const auto first_min = std::min_element(head.begin(), head.end()) - head.begin();
+        const auto first_max = std::max_element(head.begin(), head.end()) - head.begin();
+        REQUIRE(stipp::argmin(head) == static_cast<std::size_t>(first_min));
+        REQUIRE(stipp::argmax(head) == static_cast<std::size_t>(first_max));
+    }
+
+    const std::array bytes{200_u8, 3_u8, 255_u8, 3_u8};
+    REQUIRE(stipp::reduce_min(std::span<const u8>(bytes)) == 3_u8);
+    REQUIRE(stipp::reduce_max(std::span<const u8>(bytes)) == 255_u8);
+    REQUIRE(stipp::argmin(std::span<const u8>(bytes)) == 1);
+    REQUIRE(stipp::argmax(std::span<const u8>(bytes)) == 2);
+
+    REQUIRE_THROWS_AS(stipp::reduce_min(std::span<const u8>()), std::invalid_argument);
+    REQUIRE_THROWS_AS(stipp::reduce_max(std::span<const u8>()), std::invalid_argument);
+    REQUIRE_THROWS_AS(stipp::reduce_minmax(std::span<const u8>()), std::invalid_argument);
+    REQUIRE_THROWS_AS(stipp::argmin(std::span<const u8>()), std::invalid_argument);
+    REQUIRE_THROWS_AS(stipp::argmax(std::span<const u8>()), std::invalid_argument);
+}
+
+TEST_CASE("span conversions", "[convert]") {
+    FOR_EACH_CPU_LEVEL();
+
+    const std::array bytes{0_u8, 1_u8, 200_u8, 255_u8};
+    std::array<u32, 5> words{};
+    stipp::convert(std::span<const u8>(bytes), std::span<u32>(words));
+    REQUIRE(words == std::array{0_u32, 1_u32, 200_u32, 255_u32, 0_u32});
+
+    const std::array small{-1_i16, 2_i16, (std::numeric_limits<i16>::min)()};
+    std::array<i64, 3> wide{};
+    stipp::convert(std::span<const i16>(small), std::span<i64>(wide));
+    REQUIRE(wide == std::array{-1_i64, 2_i64, -32768_i64});
+
+    std::array<u64, 3> sign_extended{};
+    stipp::convert(std::span<const i16>(small), std::span<u64>(sign_extended));
+    REQUIRE(sign_extended[0] == (std::numeric_limits<u64>::max)());
+
+    using unsigned_t = stipp::make_unsigned_t<i32>;
+    const std::array signed_words{-1_i32, 7_i32};
+    std::array<unsigned_t, 2> unsigned_words{};
+    const std::span<const i32> signed_span(signed_words);
+    stipp::convert(signed_span, std::span<unsigned_t>(unsigned_words));
+    REQUIRE(unsigned_words == std::array{0xFFFF'FFFF_u32, 7_u32});
+
+    REQUIRE_THROWS_AS(
+        stipp::convert(std::span<const u8>(bytes), std::span<u32>(words).first(3)),
+        std::length_error);
+}
+
+TEST_CASE("span narrowing", "[convert]") {
+    FOR_EACH_CPU_LEVEL();
+
+    std::vector<u64> values(3000);
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        values[i] = u64{i * 1000};
+    }
+    std::vector<u32> out(values.size());
+    const std::span<const u64> src(values);
+
+    REQUIRE(stipp::narrow_checked(src, std::span<u32>(out)) == std::nullopt);
+    REQUIRE(out[2999] == 2999000_u32);
+    values[2500] = 0x1'0000'0000_u64;
+    values[2700] = 0x1'0000'0000_u64;
+    REQUIRE(stipp::narrow_checked(src, std::span<u32>(out)) == 2500);
+    REQUIRE(out[2499] == 2499000_u32);
+
+    REQUIRE(stipp::narrow_saturating(src, std::span<u32>(out)) == 2500);
+    REQUIRE(out[2500] == 0xFFFF'FFFF_u32);
+    REQUIRE(out[2700] == 0xFFFF'FFFF_u32);
+    REQUIRE(out[2999] == 2999000_u32);
+
+    // Saturating converts every block, not just those up to the first out of range value.
+    std::vector<u64> wide(4096);
+    for (std::size_t i = 0; i < wide.size(); ++i) {
+        wide[i] = u64{i};
+    }
+    wide[10] = 0x1'0000'0000_u64;
+    wide[4000] = 0x1'0000'0000_u64;
+    std::vector<u32> fresh(wide.size());
+    const std::span<const u64> wide_src(wide);
+    REQUIRE(stipp::narrow_saturating(wide_src, std::span<u32>(fresh)) == 10);
+    REQUIRE(fresh[10] == 0xFFFF'FFFF_u32);
+    REQUIRE(fresh[2000] == 2000_u32);
+    REQUIRE(fresh[4000] == 0xFFFF'FFFF_u32);
+    REQUIRE(fresh[4095] == 4095_u32);
+
+    const std::array signed_values{-300_i32, -5_i32, 100_i32, 300_i32};
+    const std::span<const i32> signed_span(signed_values);
+    std::array<u8, 4> bytes{};
+    REQUIRE(stipp::narrow_saturating(signed_span, std::span<u8>(bytes)) == 0);
+    REQUIRE(bytes == std::array{0_u8, 0_u8, 100_u8, 255_u8});
+    std::array<i8, 4> signed_bytes{};
+    REQUIRE(stipp::narrow_saturating(signed_span, std::span<i8>(signed_bytes)) == 0);
+    REQUIRE(signed_bytes ==
+            std::array{(std::numeric_limits<i8>::min)(), -5_i8, 100_i8, 127_i8});
+    REQUIRE(stipp::narrow_checked(signed_span.subspan(1), std::span<i8>(signed_bytes)) ==
+            2);
+
+    const std::array unsigned_words{7_u32, 0x8000'0000_u32};
+    std::array<i32, 2> signed_words{};
+    REQUIRE(stipp::narrow_saturating(std::span<const u32>(unsigned_words),
+                                     std::span<i32>(signed_words)) == 1);
+    REQUIRE(signed_words == std::array{7_i32, (std::numeric_limits<i32>::max)()});
+
+    REQUIRE(!stipp::narrow_checked(std::span<const u64>(), std::span<u32>()).has_value());
+    REQUIRE_THROWS_AS(stipp::narrow_checked(src, std::span<u32>(out).first(10)),
+                      std::length_error);
+    REQUIRE_THROWS_AS(stipp::narrow_saturating(src, std::span<u32>(out).first(10)),
+                      std::length_error);
+}
+
+TEST_CASE("u8 x i8 dot products", "[dot]") {
+    FOR_EACH_CPU_LEVEL();
+
+    const auto dot_ref = [](std::span<const u8> lhs, std::span<const i8> rhs) {
+        std::int64_t acc = 0;
+        for (std::size_t i = 0; i < lhs.size(); ++i) {
+            acc += std::int64_t{static_cast<std::uint8_t>(lhs[i])} *
+                   std::int64_t{static_cast<std::int8_t>(rhs[i])};
+        }
+        return i32{static_cast<std::int32_t>(acc)};
+    };
+
+    std::vector<u8> lhs(300);
+    std::vector<i8> rhs(300);
+    for (std::size_t i = 0; i < lhs.size(); ++i) {
+        lhs[i] = u8{static_cast<std::uint8_t>(i * 97 + 13)};
+        rhs[i] = i8{static_cast<std::int8_t>(static_cast<std::uint8_t>(i * 61 + 7))};
+    }
+    for (std::size_t size : {0U, 1U, 31U, 32U, 33U, 63U, 64U, 65U, 200U, 300U}) {
+        const std::span<const u8> a(lhs.data(), size);
+        const std::span<const i8> b(rhs.data(), size);
+        REQUIRE(stipp::dot(a, b) == dot_ref(a, b));
+    }
+
+    const std::vector<u8> max_lhs(256, 255_u8);
+    const std::vector<i8> min_rhs(256, (std::numeric_limits<i8>::min)());
+    const std::vector<i8> max_rhs(256, 127_i8);
+    REQUIRE(stipp::dot(max_lhs, min_rhs) == i32{256 * 255 * -128});
+    REQUIRE(stipp::dot(max_lhs, max_rhs) == i32{256 * 255 * 127});
+
+    REQUIRE_THROWS_AS(stipp::dot(std::span<const u8>(lhs).first(3),
+                                 std::span<const i8>(rhs).first(4)),
+                      std::invalid_argument);
+}
+
+TEST_CASE("u8 x i8 gemv", "[dot]") {
+    FOR_EACH_CPU_LEVEL();
+
+    constexpr std::size_t rows = 5;
+    constexpr std::size_t cols = 70;
+    std::vector<i8> matrix(rows * cols);
+    std::vector<u8> x(cols);
+    for (std::size_t i = 0; i < matrix.size(); ++i) {
+        matrix[i] = i8{static_cast<std::int8_t>(static_cast<std::uint8_t>(i * 37 + 11))};
+    }
+    for (std::size_t i = 0; i < cols; ++i) {
+        x[i] = u8{static_cast<std::uint8_t>(i * 53 + 5)};
+    }
+
+    std::array<i32, rows> y{};
+    stipp::gemv(matrix, x, y);
+    for (std::size_t row = 0; row < rows; ++row) {
+        std::int32_t expected = 0;
+        for (std::size_t col = 0; col < cols; ++col) {
+            expected += std::int32_t{static_cast<std::uint8_t>(x[col])} *
+                        std::int32_t{static_cast<std::int8_t>(matrix[row * cols + col])};
+        }
+        REQUIRE(y[row] == i32{expected});
+    }
+
+    REQUIRE_THROWS_AS(stipp::gemv(std::span<const i8>(matrix).first(10), x, y),
+                      std::invalid_argument);
+}
+
+namespace {
+
+template <typename T>
+void check_select_indices() {
+    using repr_type = stipp::detail::repr_t<T>;
+    std::vector<T> col(100);
+    for (std::size_t i = 0; i < col.size(); ++i) {
+        const auto bits = static_cast<std::uint64_t>(i * 0x9E3779B97F4A7C15ULL);
+        col[i] = static_cast<T>(static_cast<repr_type>(bits >> 61));
+    }
+    col[7] = (std::numeric_limits<T>::min)();
+    col[8] = (std::numeric_limits<T>::max)();
+
+    constexpr std::array ops{stipp::compare_op::eq, stipp::compare_op::ne,
+                             stipp::compare_op::lt, stipp::compare_op::le,
+                             stipp::compare_op::gt, stipp::compare_op::ge};
+    const auto matches = [](repr_type lhs, stipp::compare_op op, repr_type rhs) {
+        switch (op) {
+            case stipp::compare_op::eq:
+                return lhs == rhs;
+            case stipp::compare_op::ne:
+                return lhs != rhs;
+            case stipp::compare_op::lt:
+                return lhs < rhs;
+            case stipp::compare_op::le:
+                return lhs <= rhs;
+            case stipp::compare_op::gt:
+                return lhs > rhs;
+            case stipp::compare_op::ge:
+                break;
+        }
+        return lhs >= rhs;
+    };
+
+    const T values[] = {static_cast<T>(repr_type{3}),
+                               (std::numeric_limits<T>::min)(),
+                               (std::numeric_limits<T>::max)()};
+    std::vector<u32> out(col.size());
+    for (std::size_t size : {0U, 7U, 16U, 33U, 100U}) {
+        const std::span<const T> in(col.data(), size);
+        for (const auto op : ops) {
+            for (const auto value : values) {
+                std::vector<u32> expected;
+                for (std::size_t i = 0; i < size; ++i) {
+                    if (matches(stipp::detail::to_repr(col[i]), op,
+                                stipp::detail::to_repr(value))) {
+                        expected.push_back(u32{static_cast<std::uint32_t>(i)});
+                    }
+                }
+                const auto count = stipp::select_indices(in, op, value, std::span(out));
+                const auto selected = std::span<const u32>(out).first(count);
+                REQUIRE(std::vector<u32>(selected.begin(), selected.end()) == expected);
+            }
+        }
+    }
+
+    REQUIRE_THROWS_AS(stipp::select_indices(std::span<const T>(col),
+                                            stipp::compare_op::eq, values[0],
+                                            std::span(out).first(10)),
+                      std::length_error);
+}
+
+template <typename T>
+void check_gather() {
+    using repr_type = stipp::detail::repr_t<T>;
+    std::vector<T> col(50);
+    for (std::size_t i = 0; i < col.size(); ++i) {
+        col[i] = static_cast<T>(static_cast<repr_type>(i * 3 + 1));
+    }
+    std::vector<u32> sel(37);
+    for (std::size_t i = 0; i < sel.size(); ++i) {
+        sel[i] = u32{static_cast<std::uint32_t>((i * 17) % col.size())};
+    }
+
+    std::vector<T> out(sel.size());
+    stipp::gather(std::span<const T>(col), std::span<const u32>(sel), std::span(out));
+    for (std::size_t i = 0; i < sel.size(); ++i) {
+        REQUIRE(out[i] == col[static_cast<std::uint32_t>(sel[i])]);
+    }
+
+    sel.back() = u32{50};
+    REQUIRE_THROWS_AS(stipp::gather(std::span<const T>(col),
+                                    std::span<const u32>(sel), std::span(out)),
+                      std::out_of_range);
+    REQUIRE_THROWS_AS(stipp::gather(std::span<const T>(col),
+                                    std::span<const u32>(sel).first(5),
+                                    std::span(out).first(4)),
+                      std::length_error);
+}
+
+} // namespace
+
+TEST_CASE("select indices", "[select]") {
+    FOR_EACH_CPU_LEVEL();
+
+    check_select_indices<u8>();
+    check_select_indices<i8>();
+    check_select_indices<u16>();
+    check_select_indices<i16>();
+    check_select_indices<u32>();
+    check_select_indices<i32>();
+    check_select_indices<u64>();
+    check_select_indices<i64>();
+}
+
+TEST_CASE("gather", "[select]") {
+    FOR_EACH_CPU_LEVEL();
+
+    check_gather<u8>();
+    check_gather<i16>();
+    check_gather<u32>();
+    check_gather<i64>();
+}
+
+TEST_CASE("histograms", "[histogram]") {
+    std::vector<u8> bytes(1 << 19);
+    for (std::size_t i = 0; i < bytes.size(); ++i) {
+        bytes[i] = u8{static_cast<std::uint8_t>(i < 1000 ? 42 : (i * i) >> 7)};
+    }
+    std::array<u64, 256> expected_bytes{};
+    for (const auto byte : bytes) {
+        ++expected_bytes[static_cast<std::uint8_t>(byte)];
+    }
+    REQUIRE(stipp::histogram(bytes) == expected_bytes);
+    REQUIRE(stipp::histogram(bytes, 4) == expected_bytes);
+    REQUIRE(stipp::histogram(bytes, 0) == expected_bytes);
+    REQUIRE(stipp::histogram(std::span<const u8>(bytes).first(7))[42] == 7_u64);
+    REQUIRE(stipp::histogram(std::span<const u8>()) == std::array<u64, 256>{});
+
+    std::vector<u16> words(1 << 19);
+    for (std::size_t i = 0; i < words.size(); ++i) {
+        words[i] = u16{static_cast<std::uint16_t>(i % 3 == 0 ? 7 : i * 2654435761U)};
+    }
+    std::vector<u64> expected_words(65536);
+    for (const auto word : words) {
+        ++expected_words[static_cast<std::uint16_t>(word)];
+    }
+    REQUIRE(stipp::histogram(words) == expected_words);
+    REQUIRE(stipp::histogram(words, 3) == expected_words);
+}
+
+TEST_CASE("prefix sums", "[scan]") {
+    FOR_EACH_CPU_LEVEL();
+
+    std::vector<u32> lengths((std::size_t{1} << 18) + 37);
+    for (std::size_t i = 0; i < lengths.size(); ++i) {
+        lengths[i] = u32{static_cast<std::uint32_t>((i * 2654435761U) >> 4)};
+    }
+    const std::span<const u32> src(lengths);
+    std::vector<u64> expected(lengths.size());
+    std::uint64_t running = 0;
+    for (std::size_t i = 0; i < lengths.size(); ++i) {
+        running += static_cast<std::uint32_t>(lengths[i]);
+        expected[i] = u64{running};
+    }
+
+    for (std::size_t threads : {1U, 3U, 0U}) {
+        std::vector<u64> offsets(lengths.size());
+        REQUIRE(stipp::inclusive_scan(src, std::span(offsets), threads) == u64{running});
+        REQUIRE(offsets == expected);
+        REQUIRE(stipp::exclusive_scan(src, std::span(offsets), threads) == u64{running});
+        REQUIRE(offsets.front() == 0_u64);
+        REQUIRE(std::equal(offsets.begin() + 1, offsets.end(), expected.begin()));
+        REQUIRE(!stipp::inclusive_scan_checked(src, std::span(offsets), threads));
+        REQUIRE(offsets == expected);
+    }
+
+    for (std::size_t size : {0U, 1U, 7U, 8U, 9U, 33U}) {
+        std::vector<i8> small(size);
+        for (std::size_t i = 0; i < size; ++i) {
+            small[i] = i8{static_cast<std::int8_t>(static_cast<std::uint8_t>(i * 77))};
+        }
+        std::vector<i32> out(size);
+        std::vector<i64> wide(size);
+        stipp::inclusive_scan(std::span<const i8>(small), std::span(out));
+        stipp::exclusive_scan(std::span<const i8>(small), std::span(wide));
+        std::int32_t sum = 0;
+        for (std::size_t i = 0; i < size; ++i) {
+            REQUIRE(wide[i] == i64{sum});
+            sum += static_cast<std::int8_t>(small[i]);
+            REQUIRE(out[i] == i32{sum});
+        }
+    }
+
+    std::vector<u32> in_place(lengths);
+    std::vector<u32> wrapped(lengths.size());
+    for (std::size_t i = 0; i < lengths.size(); ++i) {
+        const auto bits = static_cast<std::uint64_t>(expected[i]);
+        wrapped[i] = u32{static_cast<std::uint32_t>(bits)};
+    }
+    stipp::inclusive_scan(std::span<const u32>(in_place), std::span(in_place), 4);
+    REQUIRE(in_place == wrapped);
+
+    std::vector<u32> narrow(lengths.size());
+    const auto overflow = stipp::inclusive_scan_checked(src, std::span(narrow));
+    REQUIRE(overflow.has_value());
+    REQUIRE(static_cast<std::uint64_t>(expected[*overflow]) > 0xFFFF'FFFFU);
+    REQUIRE(static_cast<std::uint64_t>(expected[*overflow - 1]) <= 0xFFFF'FFFFU);
+    REQUIRE(stipp::inclusive_scan_checked(src, std::span(narrow), 4) == overflow);
+    REQUIRE(stipp::exclusive_scan_checked(src, std::span(narrow), 4) == overflow);
+
+    const std::array negative{-100_i8, -28_i8, -1_i8, 5_i8};
+    std::array<i8, 4> negative_out{};
+    REQUIRE(stipp::inclusive_scan_checked(std::span<const i8>(negative),
+                                          std::span<i8>(negative_out)) == std::size_t{2});
+    REQUIRE(negative_out[1] == (std::numeric_limits<i8>::min)());
+
+    REQUIRE_THROWS_AS(stipp::inclusive_scan(src, std::span(narrow).first(3)),
+                      std::length_error);
+}
+
+TEST_CASE("thread pool", "[parallel]") {
+    stipp::thread_pool pool(4);
+    REQUIRE(pool.size() == 4);
+
+    std::vector<std::atomic<int>> hits(1000);
+    pool.run(hits.size(), [&](std::size_t task) { ++hits[task]; });
+    REQUIRE(std::all_of(hits.begin(), hits.end(),
+                        [](const std::atomic<int>& hit) { return hit == 1; }));
+
+    std::atomic<std::size_t> inner{0};
+    pool.run(8, [&](std::size_t) { pool.run(10, [&](std::size_t) { ++inner; }); });
+    REQUIRE(inner == 80);
+
+    REQUIRE_THROWS_AS(pool.run(100,
+                               [](std::size_t task) {
+                                   if (task == 42) {
+                                       throw std::runtime_error("task failed");
+                                   }
+                               }),
+                      std::runtime_error);
+    std::atomic<std::size_t> after{0};
+    pool.run(100, [&](std::size_t) { ++after; });
+    REQUIRE(after == 100);
+
+    stipp::thread_pool serial(1);
+    std::size_t count = 0;
+    serial.run(5, [&](std::size_t) { ++count; });
+    REQUIRE(count == 5);
+    REQUIRE(stipp::thread_pool::global().size() >= 1);
+}
+
+TEST_CASE("parallel span operations", "[parallel]") {
+    stipp::thread_pool pool(3);
+    std::vector<u32> values(200'003);
+    stipp::parallel_fill(std::span(values), 5_u32, pool);
+    REQUIRE(std::all_of(values.begin(), values.end(), [](u32 x) { return x == 5_u32; }));
+
+    std::size_t i = 0;
+    for (auto& value : values) {
+        value = u32{static_cast<std::uint32_t>(i++ * 2654435761U)};
+    }
+    // Odd offsets make the first chunk end before the first cache line boundary.
+    for (std::size_t offset : {0U, 1U, 3U}) {
+        const std::span<u32> span = std::span(values).subspan(offset);
+        std::vector<u32> doubled(span.begin(), span.end());
+        stipp::parallel_for(std::span(doubled), [](u32& x) { x = x + x; }, pool);
+        std::vector<u64> widened(span.size());
+        stipp::parallel_transform(std::span<const u32>(doubled), std::span(widened),
+                                  [](u32 x) { return static_cast<u64>(x); }, pool);
+        std::vector<u64> expected(span.size());
+        for (std::size_t j = 0; j < span.size(); ++j) {
+            expected[j] = u64{static_cast<std::uint32_t>(span[j] + span[j])};
+        }
+        REQUIRE(widened == expected);
+        const auto sum = stipp::parallel_reduce(
+            std::span<const u32>(span), 0_u64,
+            [](u64 acc, u32 x) { return acc + static_cast<u64>(x); },
+            [](u64 lhs, u64 rhs) { return lhs + rhs; }, pool);
+        REQUIRE(sum == stipp::reduce_sum(std::span<const u32>(span)));
+    }
+
+    const auto largest = stipp::parallel_reduce(
+        std::span<const u32>(values), 0_u32,
+        [](u32 lhs, u32 rhs) { return (std::max)(lhs, rhs); }, pool);
+    REQUIRE(largest == stipp::reduce_max(std::span<const u32>(values)));
+    REQUIRE(stipp::parallel_reduce(std::span<const u32>(), 7_u32, std::plus<>{}, pool) ==
+            7_u32);
+
+    std::vector<u64> small(3);
+    REQUIRE_THROWS_AS(stipp::parallel_transform(std::span<const u32>(values),
+                                                std::span(small),
+                                                [](u32 x) { return static_cast<u64>(x); }),
+                      std::length_error);
+}
+
+namespace {
+
+// The value at index i of a fixed pseudo-random sequence (SplitMix64), so that test data
+// is the same on every run.
+constexpr std::uint64_t random_at(std::uint64_t i) {
+    std::uint64_t x = i + 0x9E37'79B9'7F4A'7C15ULL;
+    x = (x ^ (x >> 33)) * 0xFF51'AFD7'ED55'8CCDULL;
+    x = (x ^ (x >> 33)) * 0xC4CE'B9FE'1A85'EC53ULL;
+    return x ^ (x >> 33);
+}
+
+// The T holding the low bits of `bits`, cast through the built-in integer of its size.
+template <typename T>
+T from_bits(std::uint64_t bits) {
+    using Wide = std::conditional_t<sizeof(T) <= 4, std::uint32_t, std::uint64_t>;
+    using Narrow = std::conditional_t<sizeof(T) == 1, std::uint8_t, std::uint16_t>;
+    using Unsigned = std::conditional_t<sizeof(T) <= 2, Narrow, Wide>;
+    using Builtin =
+        std::conditional_t<stipp::is_signed_v<T>, std::make_signed_t<Unsigned>, Unsigned>;
+    return static_cast<T>(static_cast<Builtin>(static_cast<Unsigned>(bits)));
+}
+
+// The average number of slots a linear probing table of twice the key count looks at to
+// insert each key.
+template <typename Hash>
+double average_probe_length(std::span<const u64> keys, Hash hasher) {
+    const std::size_t mask = std::bit_ceil(keys.size() * 2) - 1;
+    std::vector<bool> used(mask + 1);
+    std::size_t probes = 0;
+    for (const auto key : keys) {
+        std::size_t slot = hasher(key) & mask;
+        while (used[slot]) {
+            slot = (slot + 1) & mask;
+            ++probes;
+        }
+        used[slot] = true;
+        ++probes;
+    }
+    return static_cast<double>(probes) / static_cast<double>(keys.size());
+}
+
+// Applies a pseudo-random mix of inserts, erases and lookups to a flat_map and to an
+// std::unordered_map, and counts the operations on which they disagree.
+template <typename Map>
+std::size_t flat_map_mismatches(Map& map, std::size_t ops, std::uint64_t key_range) {
+    std::unordered_map<u64, std::string> expected;
+    std::size_t mismatches = 0;
+    for (std::size_t i = 0; i < ops; ++i) {
+        const std::uint64_t random = random_at(i);
+        const u64 key{random % key_range + 1};
+        switch ((random >> 32) % 3) {
+        case 0:
+            mismatches += map.try_emplace(key, std::to_string(i)).second !=
+                          expected.try_emplace(key, std::to_string(i)).second;
+            break;
+        case 1:
+            mismatches += map.erase(key) != expected.erase(key);
+            break;
+        default: {
+            const auto found = map.find(key);
+            const auto it = expected.find(key);
+            mismatches += it == expected.end() ? found != map.end()
+                                               : (*found).second != it->second;
+            break;
+        }
+        }
+        mismatches += map.size() != expected.size();
+    }
+    for (const auto [key, value] : map) {
+        const auto it = expected.find(key);
+        mismatches += it == expected.end() || it->second != value;
+    }
+    return mismatches;
+}
+
+template <typename Map>
+void check_flat_map() {
+    Map map;
+    REQUIRE(map.empty());
+    REQUIRE(map.begin() == map.end());
+    REQUIRE(!map.contains(1_u64));
+
+    REQUIRE(flat_map_mismatches(map, 50000, 2000) == 0);
+    REQUIRE(map.size() <= map.capacity() * 7 / 8);
+
+    const Map copy = map;
+    REQUIRE(copy == map);
+    Map moved = std::move(map);
+    REQUIRE(moved == copy);
+
+    moved.clear();
+    REQUIRE(moved.empty());
+    REQUIRE(moved.begin() == moved.end());
+    moved[5_u64] = "five";
+    moved.insert({6_u64, "six"});
+    REQUIRE(!moved.insert({6_u64, "other"}).second);
+    REQUIRE(!moved.insert_or_assign(6_u64, "six!").second);
+    REQUIRE(moved.at(6_u64) == "six!");
+    REQUIRE_THROWS_AS(moved.at(7_u64), std::out_of_range);
+
+    // Heterogeneous lookups convert the key without narrowing.
+    REQUIRE(moved.contains(5));
+    REQUIRE(moved.contains(5_u8));
+    REQUIRE(!moved.contains(-5));
+    REQUIRE(moved.count(std::uint64_t{6}) == 1);
+
+    const std::array keys{5_u64, 7_u64, 6_u64};
+    std::array<std::string*, 3> found{};
+    moved.find_n(std::span<const u64>(keys), std::span(found));
+    REQUIRE(found[0] == &moved.at(5_u64));
+    REQUIRE(found[1] == nullptr);
+    REQUIRE(found[2] == &moved.at(6_u64));
+    REQUIRE_THROWS_AS(moved.find_n(std::span<const u64>(keys), std::span(found).first(2)),
+                      std::length_error);
+
+    moved.erase(moved.find(5_u64));
+    REQUIRE(moved.size() == 1);
+    REQUIRE(moved.find(5_u64) == moved.end());
+}
+
+// Compares radix_sort and radix_sort_by_key against std::stable_sort on pseudo-random keys
+// below `range`. Sorting the original positions along shows whether the sort is stable.
+template <typename T>
+void check_radix_sort(std::size_t size, std::size_t threads, std::uint64_t range) {
+    std::vector<T> keys(size);
+    std::vector<std::pair<T, std::size_t>> expected(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        const auto bits = random_at(i) % range;
+        keys[i] = from_bits<T>(bits);
+        expected[i] = {keys[i], i};
+    }
+    const auto by_first = [](const auto& lhs, const auto& rhs) {
+        return lhs.first < rhs.first;
+    };
+    std::stable_sort(expected.begin(), expected.end(), by_first);
+
+    std::vector<T> sorted = keys;
+    stipp::radix_sort(std::span(sorted), threads);
+    std::vector<std::size_t> positions(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        positions[i] = i;
+    }
+    stipp::radix_sort_by_key(std::span(keys), std::span(positions), threads);
+
+    std::vector<std::pair<T, std::size_t>> by_key(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        by_key[i] = {keys[i], positions[i]};
+    }
+    REQUIRE(sorted == keys);
+    REQUIRE(by_key == expected);
+}
+
+// Checks lower_bound and lower_bound_n of an index over sorted pseudo-random keys below
+// `range` against std::lower_bound, for queries inside and just outside that range.
+template <typename T>
+void check_search_index(std::size_t size, std::uint64_t range) {
+    const auto make_key = [](std::uint64_t bits) {
+        return from_bits<T>(bits);
+    };
+    std::vector<T> keys(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        keys[i] = make_key(random_at(i) % range);
+    }
+    std::sort(keys.begin(), keys.end());
+    const stipp::static_search_index<T> index{std::span<const T>(keys)};
+    REQUIRE(index.size() == size);
+
+    std::vector<T> queries{(std::numeric_limits<T>::min)(),
+                           (std::numeric_limits<T>::max)()};
+    for (std::size_t i = 0; i < 1000; ++i) {
+        queries.push_back(make_key(random_at(size + i) % (range + 2)));
+    }
+    std::vector<std::size_t> expected;
+    std::vector<std::size_t> single;
+    for (const T query : queries) {
+        const auto it = std::lower_bound(keys.begin(), keys.end(), query);
+        expected.push_back(static_cast<std::size_t>(it - keys.begin()));
+        single.push_back(index.lower_bound(query));
+    }
+    std::vector<std::size_t> batched(queries.size());
+    index.lower_bound_n(std::span<const T>(queries), std::span(batched));
+    REQUIRE(single == expected);
+    REQUIRE(batched == expected);
+}
+
+template <typename T>
+std::vector<T> make_sorted_set(std::size_t size, std::uint64_t range, std::uint64_t seed) {
+    std::vector<T> ret(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        const auto bits = random_at(seed * size + i) % range;
+        ret[i] = from_bits<T>(bits);
+    }
+    std::sort(ret.begin(), ret.end());
+    ret.erase(std::unique(ret.begin(), ret.end()), ret.end());
+    return ret;
+}
+
+// Checks each set operation and its count against the standard algorithm, with output
+// spans of exactly the documented minimum size.
+template <typename T>
+void check_set_operations(std::size_t lhs_size, std::size_t rhs_size, std::uint64_t range) {
+    const auto lhs = make_sorted_set<T>(lhs_size, range, 1);
+    const auto rhs = make_sorted_set<T>(rhs_size, range, 2);
+    const std::span<const T> a(lhs);
+    const std::span<const T> b(rhs);
+
+    std::vector<T> expected;
+    const auto into_expected = std::back_inserter(expected);
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), into_expected);
+    std::vector<T> out((std::min)(a.size(), b.size()));
+    out.resize(stipp::set_intersect(a, b, std::span(out)));
+    REQUIRE(out == expected);
+    REQUIRE(stipp::set_intersect_count(a, b) == expected.size());
+
+    expected.clear();
+    std::set_difference(a.begin(), a.end(), b.begin(), b.end(), into_expected);
+    out.resize(a.size());
+    out.resize(stipp::set_difference(a, b, std::span(out)));
+    REQUIRE(out == expected);
+    REQUIRE(stipp::set_difference_count(a, b) == expected.size());
+
+    expected.clear();
+    std::set_union(a.begin(), a.end(), b.begin(), b.end(), into_expected);
+    out.resize(a.size() + b.size());
+    out.resize(stipp::set_union(a, b, std::span(out)));
+    REQUIRE(out == expected);
+    REQUIRE(stipp::set_union_count(a, b) == expected.size());
+}
+
+// IDs from base up in three bands: sparse values that become arrays, a dense block that
+// becomes a bitmap, and a range that run_optimize() turns into runs.
+template <typename T>
+std::vector<T> make_roaring_values(std::uint64_t seed, std::uint64_t base) {
+    std::vector<T> ret;
+    const auto push = [&](std::uint64_t offset) {
+        ret.push_back(from_bits<T>(base + offset));
+    };
+    for (std::uint64_t i = 0; i < 3000; ++i) {
+        push(random_at(seed * 3000 + i) % (1U << 20));
+    }
+    for (std::uint64_t i = 0; i < 20000; ++i) {
+        push((1U << 20) + random_at(seed * 20000 + i) % 65536);
+    }
+    for (std::uint64_t i = 0; i < 90000; ++i) {
+        push((3U << 20) + seed * 1000 + i);
+    }
+    return ret;
+}
+
+template <typename Set>
+std::vector<typename Set::value_type> read_roaring(const Set& set) {
+    std::vector<typename Set::value_type> ret;
+    std::array<typename Set::value_type, 100> batch{};
+    auto reader = set.reader();
+    while (const std::size_t count = reader.next(batch)) {
+        ret.insert(ret.end(), batch.begin(),
+                   batch.begin() + static_cast<std::ptrdiff_t>(count));
+    }
+    return ret;
+}
+
+// The offset of the descriptor of the first container of `kind` (0 for arrays, 1 for
+// bitmaps, 2 for runs) and at least `size` values or runs in a serialized roaring, or 0 if
+// there is none. The layout is 16 bytes of header with the container count at 8, the
+// 8-byte keys, then a 16-byte descriptor per container with the payload offset at 0, the
+// cardinality at 8, the size at 12 and the kind at 14.
+inline std::size_t find_descriptor(std::span<const std::byte> bytes,
+                                   std::uint8_t kind,
+                                   std::uint16_t size) {
+    const auto load = [&](std::size_t at, auto value) {
+        std::memcpy(&value, bytes.subspan(at).data(), sizeof(value));
+        return value;
+    };
+    const std::size_t count = load(8, std::uint64_t{});
+    for (std::size_t i = 0; i < count; ++i) {
+        const std::size_t descriptor = 16 + 8 * count + 16 * i;
+        if (load(descriptor + 14, std::uint8_t{}) == kind &&
+            load(descriptor + 12, std::uint16_t{}) >= size) {
+            return descriptor;
+        }
+    }
+    return 0;
+}
+
+// Swaps the first two values of an array container (kind 0), or the first two runs of a
+// run container (kind 2), in a serialized roaring. Returns whether there was one.
+inline bool swap_in_payload(std::span<std::byte> bytes, std::uint8_t kind) {
+    const std::size_t descriptor = find_descriptor(bytes, kind, 2);
+    if (descriptor == 0) {
+        return false;
+    }
+    std::uint64_t offset = 0;
+    std::memcpy(&offset, bytes.subspan(descriptor).data(), sizeof(offset));
+    const std::size_t width = kind == 0 ? 2 : 4;
+    const auto payload = bytes.subspan(offset, 2 * width);
+    const auto first = payload.first(width);
+    std::swap_ranges(first.begin(), first.end(), payload.subspan(width).begin());
+    return true;
+}
+
+// Checks the set operations of roarings and their serialized views against the standard
+// algorithms on sorted vectors.
+template <typename T>
+void check_roaring(std::uint64_t base) {
+    auto a = make_roaring_values<T>(1, base);
+    auto b = make_roaring_values<T>(2, base);
+    stipp::roaring<T> lhs{std::span<const T>(a)};
+    stipp::roaring<T> rhs{std::span<const T>(b)};
+    for (auto* values : {&a, &b}) {
+        std::sort(values->begin(), values->end());
+        values->erase(std::unique(values->begin(), values->end()), values->end());
+    }
+    REQUIRE(read_roaring(lhs) == a);
+    REQUIRE(lhs.cardinality() == a.size());
+    REQUIRE(lhs.contains(a[100]));
+    REQUIRE_FALSE(lhs.contains(a.back() + T{1}));
+
+    std::vector<T> expected;
+    const auto into_expected = std::back_inserter(expected);
+    const auto check = [&](const stipp::roaring<T>& x, const stipp::roaring<T>& y) {
+        expected.clear();
+        std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), into_expected);
+        REQUIRE(read_roaring(x & y) == expected);
+        REQUIRE(stipp::set_intersect_count(x, y) == expected.size());
+        expected.clear();
+        std::set_union(a.begin(), a.end(), b.begin(), b.end(), into_expected);
+        REQUIRE(read_roaring(x | y) == expected);
+        expected.clear();
+        std::set_difference(a.begin(), a.end(), b.begin(), b.end(), into_expected);
+        REQUIRE(read_roaring(x - y) == expected);
+    };
+    check(lhs, rhs);
+    const std::size_t size = rhs.serialized_size();
+    rhs.run_optimize();
+    REQUIRE(rhs.serialized_size() < size);
+    REQUIRE(read_roaring(rhs) == b);
+    check(lhs, rhs);
+    lhs.run_optimize();
+    check(lhs, rhs);
+
+    // The view reads from 8-byte aligned storage, as a mapped file would be.
+    std::vector<std::uint64_t> storage((rhs.serialized_size() + 7) / 8);
+    const auto bytes = std::as_writable_bytes(std::span(storage));
+    REQUIRE(rhs.serialize(bytes) == rhs.serialized_size());
+    const stipp::roaring_view<T> view(bytes);
+    REQUIRE(view.cardinality() == b.size());
+    REQUIRE(view.contains(b[100]));
+    REQUIRE(read_roaring(view) == b);
+    REQUIRE(view == rhs);
+    REQUIRE(stipp::roaring<T>(view) == rhs);
+    REQUIRE((lhs & view) == (lhs & rhs));
+    REQUIRE((view - lhs) == (rhs - lhs));
+    REQUIRE_THROWS_AS(rhs.serialize(bytes.first(8)), std::length_error);
+    REQUIRE_THROWS_AS(stipp::roaring_view<T>(bytes.subspan(8)), std::invalid_argument);
+    REQUIRE_THROWS_AS(stipp::roaring_view<T>(bytes.first(rhs.serialized_size() - 1)),
+                      std::invalid_argument);
+
+    // Values or runs out of order in a payload are rejected rather than trusted.
+    std::vector<std::uint64_t> tampered = storage;
+    REQUIRE(swap_in_payload(std::as_writable_bytes(std::span(tampered)), 0));
+    REQUIRE_THROWS_AS(stipp::roaring_view<T>(std::as_bytes(std::span(tampered))),
+                      std::invalid_argument);
+    stipp::roaring<T> runs;
+    runs.add_range(from_bits<T>(base + 100), from_bits<T>(base + 5000));
+    runs.add_range(from_bits<T>(base + 8000), from_bits<T>(base + 20000));
+    tampered.assign((runs.serialized_size() + 7) / 8, 0);
+    runs.serialize(std::as_writable_bytes(std::span(tampered)));
+    REQUIRE_NOTHROW(stipp::roaring_view<T>(std::as_bytes(std::span(tampered))));
+    REQUIRE(swap_in_payload(std::as_writable_bytes(std::span(tampered)), 2));
+    REQUIRE_THROWS_AS(stipp::roaring_view<T>(std::as_bytes(std::span(tampered))),
+                      std::invalid_argument);
+
+    // So is a bitmap whose cardinality does not match its bits, here that of a full one.
+    tampered = storage;
+    const auto tampered_bytes = std::as_writable_bytes(std::span(tampered));
+    const std::size_t bitmap = find_descriptor(tampered_bytes, 1, 0);
+    REQUIRE(bitmap != 0);
+    const std::uint32_t full = 65536;
+    std::memcpy(tampered_bytes.subspan(bitmap + 8).data(), &full, sizeof(full));
+    REQUIRE_THROWS_AS(stipp::roaring_view<T>(std::as_bytes(std::span(tampered))),
+                      std::invalid_argument);
+
+    bytes[0] = std::byte{0};
+    REQUIRE_THROWS_AS(stipp::roaring_view<T>(bytes), std::invalid_argument);
+
+    // Removing values takes the bitmap back to an array, and adding them back a bitmap.
+    stipp::roaring<T> copy = lhs;
+    std::size_t changed = 0;
+    for (const T value : a) {
+        changed += static_cast<std::size_t>(copy.remove(value));
+    }
+    REQUIRE(changed == a.size());
+    REQUIRE(copy.empty());
+    REQUIRE_FALSE(copy.remove(a[0]));
+    for (const T value : a) {
+        changed -= static_cast<std::size_t>(copy.add(value));
+    }
+    REQUIRE(changed == 0);
+    REQUIRE_FALSE(copy.add(a[0]));
+    REQUIRE(copy == lhs);
+}
+
+// Checks every rank, select and bit of a bit vector against a plain count.
+void check_bitvector(const std::vector<u64>& words, std::size_t size) {
+    const stipp::rank_select_bitvector bits(std::span<const u64>(words), size);
+    std::size_t rank = 0;
+    std::size_t wrong = 0;
+    for (std::size_t i = 0; i < size; ++i) {
+        const bool set = ((static_cast<std::uint64_t>(words[i / 64]) >> (i % 64)) & 1) != 0;
+        wrong += static_cast<std::size_t>(bits.test(i) != set);
+        wrong += static_cast<std::size_t>(bits.rank1(i) != rank);
+        wrong += static_cast<std::size_t>(bits.rank0(i) != i - rank);
+        if (set) {
+            wrong += static_cast<std::size_t>(bits.select1(rank) != i);
+            ++rank;
+        } else {
+            wrong += static_cast<std::size_t>(bits.select0(i - rank) != i);
+        }
+    }
+    REQUIRE(wrong == 0);
+    REQUIRE(bits.size() == size);
+    REQUIRE(bits.count() == rank);
+    REQUIRE(bits.rank1(size) == rank);
+}
+
+// Checks a round trip through elias_fano, and next_geq against std::lower_bound.
+template <typename T>
+void check_elias_fano(const std::vector<T>& values) {
+    const stipp::elias_fano<T> sequence{std::span<const T>(values)};
+    REQUIRE(sequence.size() == values.size());
+    REQUIRE(std::vector<T>(sequence.begin(), sequence.end()) == values);
+    std::vector<T> decoded(values.size() + 1);
+    REQUIRE(sequence.decode(0, std::span(decoded)) == values.size());
+    decoded.pop_back();
+    REQUIRE(decoded == values);
+    std::size_t wrong = 0;
+    for (std::size_t first = 0; first < values.size(); first += 1001) {
+        const auto batch = std::span(decoded).first(first % 37);
+        const std::size_t count = sequence.decode(first, batch);
+        const auto expected = std::span(values).subspan(first, count);
+        const bool same = std::ranges::equal(batch.first(count), expected);
+        wrong += static_cast<std::size_t>(!same);
+    }
+    REQUIRE(sequence.decode(values.size(), std::span(decoded)) == 0);
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        wrong += static_cast<std::size_t>(sequence.access(i) != values[i]);
+    }
+    const auto check_geq = [&](std::uint64_t query) {
+        const auto x = static_cast<T>(query);
+        const auto it = sequence.next_geq(x);
+        const auto expected = std::lower_bound(values.begin(), values.end(), x);
+        const auto index = static_cast<std::size_t>(expected - values.begin());
+        wrong += static_cast<std::size_t>(it.index() != index);
+        wrong += static_cast<std::size_t>(it != sequence.end() && *it != *expected);
+    };
+    for (std::size_t i = 0; i < values.size(); i += 7) {
+        const auto value = static_cast<std::uint64_t>(values[i]);
+        check_geq(value);
+        check_geq(value + 1);
+        check_geq(value - 1);
+        check_geq(random_at(i));
+    }
+    check_geq(0);
+    REQUIRE(wrong == 0);
+
+    stipp::elias_fano<T> copy = sequence;
+    REQUIRE(std::equal(copy.begin(), copy.end(), values.begin(), values.end()));
+    copy = stipp::elias_fano<T>();
+    REQUIRE(copy.begin() == copy.end());
+    copy = sequence;
+    REQUIRE((values.empty() || copy.access(values.size() - 1) == values.back()));
+}
+
+} // namespace
+
+TEST_CASE("hashing", "[hash]") {
+    FOR_EACH_CPU_LEVEL();
+
+    const stipp::hash<u64> hasher;
+    REQUIRE(hasher(1_u64) != hasher(2_u64));
+    REQUIRE(stipp::hash<i8>{}(-1_i8) == stipp::hash<u8>{}(255_u8));
+    REQUIRE(stipp::hash<u24>{}(u24{7_u32}) == stipp::hash<u32>{}(7_u32));
+
+    // Flipping one input bit should flip about half of the output bits.
+    std::size_t flipped = 0;
+    for (std::size_t bit = 0; bit < 64; ++bit) {
+        const auto x = static_cast<std::uint64_t>(bit * 0x9E37'79B9'7F4A'7C15ULL);
+        const auto h0 = hasher(u64{x});
+        const auto h1 = hasher(u64{x ^ (std::uint64_t{1} << bit)});
+        flipped += static_cast<std::size_t>(std::popcount(h0 ^ h1));
+    }
+    REQUIRE(flipped > 64 * 24);
+    REQUIRE(flipped < 64 * 40);
+
+    const stipp::seeded_hash<u64> seeded_a(1);
+    const stipp::seeded_hash<u64> seeded_b(2);
+    REQUIRE(seeded_a(5_u64) == stipp::seeded_hash<u64>(1)(5_u64));
+    REQUIRE(seeded_a(5_u64) != seeded_b(5_u64));
+    REQUIRE(stipp::seeded_hash<u64>{}(5_u64) == stipp::seeded_hash<u64>{}(5_u64));
+
+    std::vector<u64> strided(4096);
+    for (std::size_t i = 0; i < strided.size(); ++i) {
+        strided[i] = u64{i << 13};
+    }
+    REQUIRE(average_probe_length<stipp::hash<u64>>(strided, hasher) < 2.0);
+    REQUIRE(average_probe_length<stipp::seeded_hash<u64>>(strided, seeded_a) < 2.0);
+    REQUIRE(average_probe_length<std::hash<u64>>(strided, std::hash<u64>{}) > 100.0);
+
+    for (std::size_t size : {0U, 1U, 7U, 4096U}) {
+        const auto keys = std::span<const u64>(strided).first(size);
+        std::vector<u64> expected(size);
+        std::vector<u64> expected_seeded(size);
+        for (std::size_t i = 0; i < size; ++i) {
+            expected[i] = u64{hasher(keys[i])};
+            expected_seeded[i] = u64{seeded_b(keys[i])};
+        }
+        std::vector<u64> hashes(size);
+        stipp::hash_n(keys, std::span(hashes));
+        REQUIRE(hashes == expected);
+        stipp::hash_n(keys, std::span(hashes), seeded_b);
+        REQUIRE(hashes == expected_seeded);
+    }
+
+    using id_type = stipp::strong_id<struct hash_tag>;
+    const std::array ids{id_type(3_u32)};
+    std::array<u64, 1> id_hash{};
+    stipp::hash_n(std::span<const id_type>(ids), std::span(id_hash));
+    REQUIRE(id_hash[0] == u64{stipp::hash<u32>{}(3_u32)});
+    REQUIRE_THROWS_AS(stipp::hash_n(std::span<const u64>(strided), std::span(id_hash)),
+                      std::length_error);
+}
+
+TEST_CASE("flat hash tables", "[flat]") {
+    check_flat_map<stipp::flat_map<u64, std::string>>();
+    check_flat_map<stipp::flat_map<u64, std::string, stipp::seeded_hash<u64>>>();
+    check_flat_map<stipp::flat_map<u64, std::string, stipp::hash<u64>,
+                                   stipp::empty_key<u64, STIPP_U64_MAX>>>();
+
+    using sentinel_map =
+        stipp::flat_map<u64, int, stipp::hash<u64>, stipp::empty_key<u64, STIPP_U64_MAX>>;
+    sentinel_map sentinel;
+    REQUIRE_THROWS_AS(sentinel[STIPP_U64_MAX], std::invalid_argument);
+    REQUIRE(sentinel.empty());
+    REQUIRE(!sentinel.contains(STIPP_U64_MAX));
+
+    stipp::flat_set<i32> set{1_i32, -2_i32, 3_i32, 1_i32};
+    REQUIRE(set.size() == 3);
+    REQUIRE(set.contains(-2));
+    REQUIRE(!set.contains(std::int64_t{1} << 40));
+    REQUIRE(!set.insert(3_i32).second);
+    REQUIRE(set.erase(1_i32) == 1);
+    std::vector<i32> members(set.begin(), set.end());
+    std::sort(members.begin(), members.end());
+    REQUIRE(members == std::vector{-2_i32, 3_i32});
+
+    const std::array keys{3_i32, 4_i32};
+    std::array<const i32*, 2> found{};
+    set.find_n(std::span<const i32>(keys), std::span(found));
+    REQUIRE(*found[0] == 3_i32);
+    REQUIRE(found[1] == nullptr);
+
+    // Filling and draining repeatedly leaves tombstones that must not grow the table.
+    stipp::flat_set<u32> churn;
+    for (std::uint32_t round = 0; round < 64; ++round) {
+        for (std::uint32_t i = 0; i < 100; ++i) {
+            churn.insert(u32{round * 100 + i});
+        }
+        for (std::uint32_t i = 0; i < 100; ++i) {
+            churn.erase(u32{round * 100 + i});
+        }
+    }
+    REQUIRE(churn.empty());
+    REQUIRE(churn.capacity() <= 256);
+
+    using id_type = stipp::strong_id<struct flat_tag>;
+    stipp::flat_map<id_type, int> by_id;
+    by_id[id_type(4_u32)] = 1;
+    REQUIRE(by_id.contains(id_type(4_u32)));
+}
+
+TEST_CASE("radix sort", "[sort]") {
+    constexpr auto all_bits = (std::numeric_limits<std::uint64_t>::max)();
+    for (const std::size_t threads : {1U, 4U}) {
+        for (const std::size_t size : {0U, 1U, 64U, 65U, 5000U, 300000U}) {
+            check_radix_sort<i64>(size, threads, all_bits);
+            check_radix_sort<i64>(size, threads, 1000);
+            check_radix_sort<u32>(size, threads, all_bits);
+            check_radix_sort<i16>(size, threads, all_bits);
+            check_radix_sort<i8>(size, threads, all_bits);
+            check_radix_sort<u8>(size, threads, 3);
+        }
+    }
+    check_radix_sort<i24>(5000, 1, all_bits);
+
+    // Keys alone on several threads, where the value spans of every bucket are empty.
+    std::vector<u32> alone(1U << 20);
+    for (std::size_t i = 0; i < alone.size(); ++i) {
+        alone[i] = u32{static_cast<std::uint32_t>(random_at(i))};
+    }
+    stipp::radix_sort(std::span(alone), 4);
+    REQUIRE(std::is_sorted(alone.begin(), alone.end()));
+
+    std::vector<i64> equal(100000, -7_i64);
+    stipp::radix_sort(std::span(equal), 4);
+    REQUIRE(std::all_of(equal.begin(), equal.end(), [](i64 x) { return x == -7_i64; }));
+
+    std::vector<u32> keys(3);
+    std::vector<int> values(2);
+    REQUIRE_THROWS_AS(stipp::radix_sort_by_key(std::span(keys), std::span(values)),
+                      std::length_error);
+}
+
+TEST_CASE("static search index", "[search]") {
+    FOR_EACH_CPU_LEVEL();
+
+    constexpr auto all_bits = (std::numeric_limits<std::uint64_t>::max)();
+    // 16 and 8 keys fill a node of u32 and u64 keys, so these sizes cover partial and
+    // full leaves and trees of one to three layers.
+    for (const std::size_t size : {0U, 1U, 8U, 9U, 16U, 17U, 272U, 273U, 5000U, 70000U}) {
+        check_search_index<u32>(size, all_bits);
+        check_search_index<u32>(size, 50);
+        check_search_index<i32>(size, all_bits);
+        check_search_index<u64>(size, all_bits);
+        check_search_index<u64>(size, 3);
+        check_search_index<i64>(size, all_bits);
+        check_search_index<i16>(size, all_bits);
+    }
+
+    const std::array keys{2_u32, 4_u32, 4_u32, STIPP_U32_MAX};
+    const stipp::static_search_index<u32> index{std::span<const u32>(keys)};
+    REQUIRE(index.lower_bound(4_u32) == 1);
+    REQUIRE(index.lower_bound(5_u32) == 3);
+    REQUIRE(index.lower_bound(STIPP_U32_MAX) == 3);
+    REQUIRE(index.contains(STIPP_U32_MAX));
+    REQUIRE(!index.contains(3_u32));
+
+    const std::array unsorted{2_u32, 1_u32};
+    REQUIRE_THROWS_AS(stipp::static_search_index<u32>(std::span<const u32>(unsorted)),
+                      std::invalid_argument);
+    std::array<std::size_t, 1> out{};
+    REQUIRE_THROWS_AS(index.lower_bound_n(std::span<const u32>(keys), std::span(out)),
+                      std::length_error);
+}
+
+TEST_CASE("sorted set operations", "[set]") {
+    FOR_EACH_CPU_LEVEL();
+
+    // Sizes with a ratio beyond 32 take the galloping paths, and the rest the block
+    // compares. Narrow ranges make most elements shared.
+    constexpr auto all_bits = (std::numeric_limits<std::uint64_t>::max)();
+    for (const auto& [lhs_size, rhs_size] : {std::pair<std::size_t, std::size_t>{0, 100},
+                                             {1, 1},
+                                             {9, 17},
+                                             {1000, 1000},
+                                             {3000, 700},
+                                             {40, 20000},
+                                             {20000, 40}}) {
+        for (const std::uint64_t range : {std::uint64_t{3000}, all_bits}) {
+            check_set_operations<u32>(lhs_size, rhs_size, range);
+            check_set_operations<i32>(lhs_size, rhs_size, range);
+            check_set_operations<u64>(lhs_size, rhs_size, range);
+            check_set_operations<i64>(lhs_size, rhs_size, range);
+            check_set_operations<u16>(lhs_size, rhs_size, range);
+        }
+    }
+
+    const std::array lhs{1_u32, 2_u32, 3_u32};
+    const std::array rhs{2_u32};
+    std::array<u32, 3> out{};
+    REQUIRE_THROWS_AS(stipp::set_union(std::span<const u32>(lhs), std::span<const u32>(rhs),
+                                       std::span<u32>(out)),
+                      std::length_error);
+    REQUIRE_THROWS_AS(stipp::set_difference(std::span<const u32>(lhs),
+                                            std::span<const u32>(rhs),
+                                            std::span<u32>(out).first(2)),
+                      std::length_error);
+}
+
+TEST_CASE("roaring bitmaps", "[roaring]") {
+    FOR_EACH_CPU_LEVEL();
+
+    check_roaring<u32>(0);
+    check_roaring<u32>(0xff000000);
+    check_roaring<u64>(std::uint64_t{1} << 40);
+
+    stipp::roaring<u32> ids;
+    ids.add_range(100_u32, 200000_u32);
+    ids.add(7_u32);
+    ids.add_range(150000_u32, 300000_u32);
+    REQUIRE(ids.cardinality() == 299902);
+    REQUIRE(ids.contains(7_u32));
+    REQUIRE(ids.contains(300000_u32));
+    REQUIRE_FALSE(ids.contains(99_u32));
+    REQUIRE(ids.serialized_size() < 256);
+    REQUIRE(ids.remove(65536_u32));
+    REQUIRE_FALSE(ids.contains(65536_u32));
+    REQUIRE(ids.cardinality() == 299901);
+
+    std::vector<std::uint64_t> storage((ids.serialized_size() + 7) / 8);
+    ids.serialize(std::as_writable_bytes(std::span(storage)));
+    REQUIRE_THROWS_AS(stipp::roaring_view<u64>(std::as_bytes(std::span(storage))),
+                      std::invalid_argument);
+}
+
+TEST_CASE("rank select bit vectors", "[bitvector]") {
+    FOR_EACH_CPU_LEVEL();
+
+    // Random bits with a varying density, so that some blocks are empty and some full.
+    std::vector<u64> words(1500);
+    for (std::size_t i = 0; i < words.size(); ++i) {
+        const std::size_t band = i / 100 % 4;
+        std::uint64_t word = random_at(i);
+        if (band == 1) {
+            word &= random_at(~i) & (word >> 7);
+        } else if (band == 2) {
+            word = i % 37 == 0 ? word : 0;
+        } else if (band == 3) {
+            word = ~std::uint64_t{0};
+        }
+        words[i] = u64{word};
+    }
+    check_bitvector(words, words.size() * 64);
+    check_bitvector(words, words.size() * 64 - 23);
+    check_bitvector(words, 2048 * 3);
+    check_bitvector(words, 0);
+    check_bitvector(std::vector<u64>(700, u64{~std::uint64_t{0}}), 700 * 64);
+    check_bitvector(std::vector<u64>(300), 300 * 64 - 1);
+
+    // A few set bits far apart, so select searches many blocks between samples.
+    std::vector<u64> sparse(1U << 16);
+    for (std::size_t i = 0; i < sparse.size(); i += 997) {
+        sparse[i] = u64{std::uint64_t{1} << (i % 64)};
+    }
+    check_bitvector(sparse, sparse.size() * 64);
+
+    const stipp::rank_select_bitvector dense(std::span<const u64>(words).first(1024));
+    REQUIRE(dense.index_bytes() * 100 <= dense.size() / 8 * 6);
+    REQUIRE(stipp::rank_select_bitvector().rank1(0) == 0);
+    REQUIRE_THROWS_AS(stipp::rank_select_bitvector(std::span<const u64>(words), 96001),
+                      std::length_error);
+}
+
+TEST_CASE("elias fano sequences", "[elias_fano]") {
+    FOR_EACH_CPU_LEVEL();
+
+    // Offsets spread over 2^32 with repeats, which take about 2 bytes each.
+    std::vector<u64> offsets(100000);
+    for (std::size_t i = 0; i < offsets.size(); ++i) {
+        offsets[i] = u64{random_at(i / 3) >> 32};
+    }
+    std::sort(offsets.begin(), offsets.end());
+    check_elias_fano(offsets);
+    const stipp::elias_fano<u64> encoded{std::span<const u64>(offsets)};
+    REQUIRE(encoded.memory_bytes() < offsets.size() * 3);
+
+    // Values at the top of the range, consecutive values with no low bits, and a few
+    // values far apart.
+    std::vector<u64> high(5000);
+    for (std::size_t i = 0; i < high.size(); ++i) {
+        high[i] = u64{~std::uint64_t{0} - (random_at(i) >> 20)};
+    }
+    std::sort(high.begin(), high.end());
+    check_elias_fano(high);
+    std::vector<u32> dense(70000);
+    for (std::size_t i = 0; i < dense.size(); ++i) {
+        dense[i] = u32{static_cast<std::uint32_t>(i + i / 5)};
+    }
+    check_elias_fano(dense);
+    check_elias_fano(std::vector<u32>{0_u32, 5_u32, 1000000_u32, 0xffffffff_u32});
+    check_elias_fano(std::vector<u32>{0_u32});
+    // A single value over 2^63 keeps 63 low bits.
+    check_elias_fano(std::vector<u64>{0x8000'0000'0000'0001_u64});
+    check_elias_fano(std::vector<u64>{});
+
+    const stipp::elias_fano<u32> none;
+    REQUIRE(none.next_geq(0_u32) == none.end());
+    const std::vector<u32> unsorted{2_u32, 1_u32};
+    REQUIRE_THROWS_AS(stipp::elias_fano<u32>(std::span<const u32>(unsorted)),
+                      std::invalid_argument);
+}
+
+TEST_CASE("static maps", "[static_map]") {
+    static constexpr stipp::static_map<u16, int, 4> opcodes{
+        {0x01_u16, 1}, {0x20_u16, 2}, {0x300_u16, 3}, {0xffff_u16, 4}};
+    static_assert(*opcodes.find(0x300_u16) == 3);
+    static_assert(opcodes.find(0x02_u16) == nullptr);
+    static_assert(opcodes.contains(0xffff_u16) && !opcodes.contains(0_u16));
+    static_assert(opcodes.size() == 4 && !opcodes.empty());
+    REQUIRE(opcodes.at(0x01_u16) == 1);
+    REQUIRE(opcodes.at(0x20_u16) == 2);
+    REQUIRE_THROWS_AS(opcodes.at(0x21_u16), std::out_of_range);
+
+    // Keys close together, negative keys and strong ids.
+    static constexpr auto dense = []<std::size_t... I>(std::index_sequence<I...>) {
+        return stipp::static_map<u32, u32, sizeof...(I)>{
+            {u32{I * 3 + 0x100}, u32{I}}...};
+    }(std::make_index_sequence<200>{});
+    for (std::uint32_t i = 0; i < 1000; ++i) {
+        const u32* value = dense.find(u32{i});
+        if (i >= 0x100 && (i - 0x100) % 3 == 0 && i < 0x100 + 600) {
+            REQUIRE(value != nullptr);
+            REQUIRE(*value == u32{(i - 0x100) / 3});
+        } else {
+            REQUIRE(value == nullptr);
+        }
+    }
+    static constexpr stipp::static_map<i32, char, 3> signs{
+        {-1_i32, 'n'}, {0_i32, 'z'}, {1_i32, 'p'}};
+    REQUIRE(signs.at(-1_i32) == 'n');
+    REQUIRE(signs.at(1_i32) == 'p');
+    REQUIRE(!signs.contains(-2_i32));
+    using port_id = stipp::strong_id<struct port_tag, u16>;
+    static constexpr stipp::static_map<port_id, u16, 2> ports{
+        {port_id{80_u16}, 1_u16}, {port_id{443_u16}, 2_u16}};
+    REQUIRE(ports.at(port_id{443_u16}) == 2_u16);
+    REQUIRE(!ports.contains(port_id{8080_u16}));
+
+    static constexpr stipp::static_map<u64, int, 0> none{};
+    static_assert(none.empty() && none.find(0_u64) == nullptr);
+}
+
+TEST_CASE("bloom and cuckoo filters", "[filter]") {
+    FOR_EACH_CPU_LEVEL();
+
+    const auto key_at = [](std::size_t i) { return u64{random_at(i)}; };
+    constexpr std::size_t count = 20000;
+    std::vector<u64> inserted(count);
+    std::vector<u64> missing(100000);
+    for (std::size_t i = 0; i < inserted.size(); ++i) {
+        inserted[i] = key_at(i);
+    }
+    for (std::size_t i = 0; i < missing.size(); ++i) {
+        missing[i] = key_at(count + i);
+    }
+    const auto contains_n = [](const auto& filter, const std::vector<u64>& keys) {
+        const auto out = std::make_unique<bool[]>(keys.size());
+        const std::span<bool> hit(out.get(), keys.size());
+        const std::size_t found = filter.contains_n(std::span<const u64>(keys), hit);
+        std::size_t hits = 0;
+        std::size_t differ = 0;
+        for (std::size_t i = 0; i < keys.size(); ++i) {
+            differ += static_cast<std::size_t>(out[i] != filter.contains(keys[i]));
+            hits += static_cast<std::size_t>(out[i]);
+        }
+        REQUIRE(differ == 0);
+        REQUIRE(found == hits);
+        return found;
+    };
+
+    for (const double rate : {0.05, 0.01, 0.001}) {
+        stipp::blocked_bloom<u64> bloom(count, rate);
+        for (const u64 key : inserted) {
+            bloom.insert(key);
+        }
+        REQUIRE(contains_n(bloom, inserted) == count);
+        const auto false_positives = static_cast<double>(contains_n(bloom, missing));
+        REQUIRE(false_positives < rate * 1.5 * static_cast<double>(missing.size()));
+        bloom.clear();
+        REQUIRE(contains_n(bloom, inserted) == 0);
+    }
+    stipp::blocked_bloom<u64, stipp::seeded_hash<u64>> seeded(
+        100, 0.01, stipp::seeded_hash<u64>(7));
+    seeded.insert(42_u64);
+    REQUIRE(seeded.contains(42_u64));
+    const stipp::blocked_bloom<u32> empty_bloom;
+    REQUIRE(empty_bloom.block_count() == 1);
+    REQUIRE(!empty_bloom.contains(0_u32));
+    REQUIRE_THROWS_AS(stipp::blocked_bloom<u64>(10, 0.0), std::invalid_argument);
+    REQUIRE_THROWS_AS(stipp::blocked_bloom<u64>(10, 1.0), std::invalid_argument);
+    REQUIRE_THROWS_AS(
+        stipp::blocked_bloom<u64>(10, std::numeric_limits<double>::quiet_NaN()),
+        std::invalid_argument);
+    const std::vector<u32> two(2);
+    std::array<bool, 1> one{};
+    REQUIRE_THROWS_AS(empty_bloom.contains_n(std::span<const u32>(two), std::span(one)),
+                      std::length_error);
+
+    stipp::cuckoo_filter<u64> cuckoo(count);
+    stipp::cuckoo_filter<u64, u8> small_cuckoo(count);
+    for (const u64 key : inserted) {
+        cuckoo.insert(key);
+        small_cuckoo.insert(key);
+    }
+    REQUIRE(cuckoo.size() == count);
+    REQUIRE(small_cuckoo.size() == count);
+    REQUIRE(contains_n(cuckoo, inserted) == count);
+    REQUIRE(contains_n(small_cuckoo, inserted) == count);
+    const auto missing_count = static_cast<double>(missing.size());
+    REQUIRE(static_cast<double>(contains_n(cuckoo, missing)) <
+            cuckoo.false_positive_rate * missing_count);
+    REQUIRE(static_cast<double>(contains_n(small_cuckoo, missing)) <
+            small_cuckoo.false_positive_rate * missing_count);
+
+    // Erasing half of the keys keeps the other half, and a key inserted twice stays
+    // until it is erased twice.
+    std::size_t erased = 0;
+    for (std::size_t i = 0; i < count; i += 2) {
+        erased += static_cast<std::size_t>(cuckoo.erase(inserted[i]));
+    }
+    REQUIRE(erased == count / 2);
+    REQUIRE(cuckoo.size() == count / 2);
+    std::size_t kept = 0;
+    for (std::size_t i = 1; i < count; i += 2) {
+        kept += static_cast<std::size_t>(cuckoo.contains(inserted[i]));
+    }
+    REQUIRE(kept == count / 2);
+    REQUIRE(contains_n(cuckoo, inserted) < count / 2 + 10);
+    REQUIRE(cuckoo.insert(inserted[1]));
+    REQUIRE(cuckoo.erase(inserted[1]));
+    REQUIRE(cuckoo.contains(inserted[1]));
+    cuckoo.clear();
+    REQUIRE(cuckoo.empty());
+    REQUIRE(!cuckoo.contains(inserted[1]));
+
+    // Inserts fail once the filter is full, without losing any key, and erases make
+    // room again.
+    stipp::cuckoo_filter<u64> full(1000);
+    std::size_t stored = 0;
+    while (full.insert(key_at(stored))) {
+        ++stored;
+    }
+    REQUIRE(stored > full.capacity() * 9 / 10);
+    REQUIRE(full.size() == stored);
+    const auto count_kept = [&](std::size_t first) {
+        std::size_t found = 0;
+        for (std::size_t i = first; i < stored; ++i) {
+            found += static_cast<std::size_t>(full.contains(key_at(i)));
+        }
+        return found;
+    };
+    REQUIRE(count_kept(0) == stored);
+    for (std::size_t i = 0; i < 100; ++i) {
+        full.erase(key_at(i));
+    }
+    REQUIRE(full.size() == stored - 100);
+    REQUIRE(full.insert(key_at(0)));
+    REQUIRE(count_kept(100) == stored - 100);
+
+    using session_id = stipp::strong_id<struct session_tag>;
+    stipp::cuckoo_filter<session_id> sessions(10);
+    REQUIRE(sessions.insert(session_id{5_u32}));
+    REQUIRE(sessions.contains(session_id{5_u32}));
+    REQUIRE(!sessions.erase(session_id{6_u32}));
+}
+
+TEST_CASE("cpu dispatch levels", "[dispatch]") {
+    const auto detected = stipp::detected_cpu_level();
+    REQUIRE(stipp::active_cpu_level() <= detected);
+    {
+        const cpu_level_guard guard(stipp::cpu_level::baseline);
+        REQUIRE(stipp::active_cpu_level() == stipp::cpu_level::baseline);
+    }
+    REQUIRE(stipp::set_cpu_level(stipp::cpu_level::avx512) == detected);
+    REQUIRE(stipp::active_cpu_level() == detected);
+
+    REQUIRE(stipp::detail::parse_cpu_level("baseline") == stipp::cpu_level::baseline);
+    REQUIRE(stipp::detail::parse_cpu_level("sse4.2") == stipp::cpu_level::sse4_2);
+    REQUIRE(stipp::detail::parse_cpu_level("avx2") == stipp::cpu_level::avx2);
+    REQUIRE(stipp::detail::parse_cpu_level("avx512") == stipp::cpu_level::avx512);
+    REQUIRE(!stipp::detail::parse_cpu_level("avx3").has_value());
+    REQUIRE(stipp::detail::initial_cpu_level(stipp::cpu_level::baseline) ==
+            stipp::cpu_level::baseline);
+}